@@ -0,0 +1,131 @@
+//
+//  AnalysisRateScheduler.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef AnalysisRateScheduler_hpp
+#define AnalysisRateScheduler_hpp
+
+#include <math.h>
+#include <algorithm>
+
+// Chooses a rate at which frames arriving from a source can be analyzed sustainably, and decimates the frames uniformly
+// to it, instead of dropping whichever frames happen to arrive while the pipeline is busy. Every n-th frame is analyzed,
+// where n (the decimation) is chosen from a moving average of the per-frame cost in the slowest pipeline stage. Frames
+// are assigned to slots of n source frame intervals, aligned to the presentation time of the first frame, so that
+// arrival jitter does not make the sampling irregular. The decimation is only changed after it has settled, with a dead
+// band between increasing and decreasing it so that it doesn't oscillate. Not thread-safe.
+class AnalysisRateScheduler {
+public:
+    enum {
+        MaximumDecimation = 30,
+        SettlingFrameCount = 15         // analyzed frames between changes
+    };
+
+    AnalysisRateScheduler()
+        : _decimation(1), _sourceFrameInterval(0), _lastArrivalTime(NAN), _nextSlotTime(NAN),
+          _meanCost(0), _costSampleCount(0), _framesSinceChange(0)
+    {
+    }
+
+    // Returns true if the frame should be analyzed. Must be called for every frame the source delivers, in order.
+    bool shouldAnalyzeFrame(double presentationTime)
+    {
+        // Estimate the source frame interval, ignoring gaps (e.g. from a stalled source)
+        double delta = presentationTime - _lastArrivalTime;
+        if (delta > 0 && delta < MaximumSourceFrameInterval) {
+            _sourceFrameInterval = _sourceFrameInterval > 0 ? _sourceFrameInterval + (delta - _sourceFrameInterval) * SourceIntervalSmoothing : delta;
+        }
+        _lastArrivalTime = presentationTime;
+
+        if (_decimation == 1 || _sourceFrameInterval <= 0 || isnan(_nextSlotTime)) {
+            _nextSlotTime = presentationTime + slotInterval();
+            return true;
+        }
+
+        // Accept the first frame within half a source frame interval of the slot
+        if (presentationTime < _nextSlotTime - _sourceFrameInterval / 2) {
+            return false;
+        }
+        // Stay aligned to the slots, unless the source skipped ahead by more than a slot
+        double slotTime = presentationTime - _nextSlotTime > slotInterval() ? presentationTime : _nextSlotTime;
+        _nextSlotTime = slotTime + slotInterval();
+        return true;
+    }
+
+    // Adds the time an analyzed frame spent being processed in the slowest pipeline stage. Returns true if the
+    // decimation changed as a result.
+    bool addFrameCost(double seconds)
+    {
+        _meanCost = _costSampleCount > 0 ? _meanCost + (seconds - _meanCost) * CostSmoothing : seconds;
+        _costSampleCount++;
+        if (++_framesSinceChange < SettlingFrameCount || _sourceFrameInterval <= 0) {
+            return false;
+        }
+
+        // Increase the decimation as soon as the cost would saturate the pipeline, but only decrease it once the cost
+        // is well under the next higher rate
+        double costInFrames = _meanCost / _sourceFrameInterval;
+        int increasedDecimation = clampDecimation(ceil(costInFrames * IncreaseHeadroom));
+        int decreasedDecimation = clampDecimation(ceil(costInFrames * DecreaseHeadroom));
+        int decimation = _decimation;
+        if (increasedDecimation > _decimation) {
+            decimation = increasedDecimation;
+        } else if (decreasedDecimation < _decimation) {
+            decimation = decreasedDecimation;
+        }
+        if (decimation == _decimation) {
+            return false;
+        }
+        _decimation = decimation;
+        _framesSinceChange = 0;
+        return true;
+    }
+
+    int decimation() const
+    {
+        return _decimation;
+    }
+
+    // 0 until two frames have arrived
+    double sourceFrameInterval() const
+    {
+        return _sourceFrameInterval;
+    }
+
+    // Frames per second, or 0 if unknown
+    double analysisRate() const
+    {
+        return _sourceFrameInterval > 0 ? 1.0 / slotInterval() : 0.0;
+    }
+
+private:
+    static constexpr double MaximumSourceFrameInterval = 1.0;
+    static constexpr double SourceIntervalSmoothing = 0.05;
+    static constexpr double CostSmoothing = 0.1;
+    static constexpr double IncreaseHeadroom = 1.1;
+    static constexpr double DecreaseHeadroom = 1.4;
+
+    double slotInterval() const
+    {
+        return _decimation * _sourceFrameInterval;
+    }
+
+    static int clampDecimation(double decimation)
+    {
+        return (int)std::min(std::max(decimation, 1.0), (double)MaximumDecimation);
+    }
+
+    int _decimation;
+    double _sourceFrameInterval;
+    double _lastArrivalTime;
+    double _nextSlotTime;
+    double _meanCost;
+    int _costSampleCount;
+    int _framesSinceChange;
+};
+
+#endif
@@ -9,6 +9,8 @@
 #import <Foundation/Foundation.h>
 #import <opencv2/core/core_c.h>
 #import "VideoProcessorController.h"        // for run log
+#import "AssayAnalyzer.h"
+#import "VideoFrame.h"
 
 static NSString *const IgnoreFramesPostMovementTimeIntervalKey = @"IgnoreFramesPostMovementTimeInterval";
 
@@ -21,9 +23,19 @@ NSTimeInterval IgnoreFramesPostMovementTimeInterval()
         if (val) {
             RunLog(@"Using custom frame hysteresis threshold of %g seconds set via IgnoreFramesPostMovementTimeInterval user default,", val);
         } else {
-            val = 2.0;
+            val = DefaultIgnoreFramesPostMovementTimeInterval;
         }
     });
     
     return val;
 }
+
+AnalysisFrameRef AnalysisFrameForVideoFrame(VideoFrame *videoFrame)
+{
+    CFTypeRef retainedFrame = CFBridgingRetain(videoFrame);
+    return AnalysisFrameRef(new AnalysisFrame([videoFrame image], [videoFrame presentationTime]),
+                            [retainedFrame](const AnalysisFrame *frame) {
+                                delete frame;
+                                CFRelease(retainedFrame);
+                            });
+}
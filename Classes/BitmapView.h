@@ -8,12 +8,16 @@
 
 #import <AppKit/AppKit.h>
 
-@class VideoFrame;
+@class DebugFrame;
 
 @interface BitmapView : NSView {
-    VideoFrame *_image;
+    DebugFrame *_image;
+    BOOL _visible;
 }
 
-- (void)renderImage:(VideoFrame *)image;    // thread-safe
+- (void)renderImage:(DebugFrame *)image;    // thread-safe
+
+// NO if the view is not in a window or its window is hidden or fully occluded, i.e. rendered images would not be seen.
+@property(readonly, getter=isVisible) BOOL visible;     // thread-safe
 
 @end
@@ -9,11 +9,12 @@
 #import "BitmapView.h"
 #import <CoreGraphics/CoreGraphics.h>
 #import <opencv2/core/core_c.h>
-#import "VideoFrame.h"
+#import "DebugFrame.h"
 
 @interface BitmapView ()
 
-@property VideoFrame *image;        // atomic
+@property DebugFrame *image;        // atomic
+@property(readwrite, getter=isVisible) BOOL visible;       // atomic
 
 @end
 
@@ -28,9 +29,32 @@
     return self;
 }
 
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+- (void)viewDidMoveToWindow
+{
+    [super viewDidMoveToWindow];
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:NSWindowDidChangeOcclusionStateNotification object:nil];
+    if ([self window]) {
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                                 selector:@selector(windowDidChangeOcclusionState:)
+                                                     name:NSWindowDidChangeOcclusionStateNotification
+                                                   object:[self window]];
+    }
+    [self windowDidChangeOcclusionState:nil];
+}
+
+- (void)windowDidChangeOcclusionState:(NSNotification *)notification
+{
+    [self setVisible:([[self window] occlusionState] & NSWindowOcclusionStateVisible) != 0];
+}
+
 - (void)drawRect:(NSRect)dirtyRect      // will be called on an arbitrary thread
 {
-    VideoFrame *image = [self image];
+    DebugFrame *image = [self image];
     
     if (image) {
         CGImageRef cgImage =  [image createCGImage];     // no need to copy since this is the end of the line
@@ -44,7 +68,7 @@
     }
 }
 
-- (void)renderImage:(VideoFrame *)image
+- (void)renderImage:(DebugFrame *)image
 {
     [self setImage:image];
     [[NSOperationQueue mainQueue] addOperationWithBlock:^{
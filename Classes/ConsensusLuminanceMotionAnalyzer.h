@@ -9,11 +9,8 @@
 #import <Foundation/Foundation.h>
 #import "AssayAnalyzer.h"
 
-@interface ConsensusLuminanceMotionAnalyzer : NSObject <AssayAnalyzer> {
-    NSMutableArray *_lastFrames;
-    IplImage* _pixelwiseVotes;
-    NSTimeInterval _lastMovementThresholdPresentationTime;
-}
+// The analysis itself is in ConsensusLuminancePlateAnalyzer.hpp
+@interface ConsensusLuminanceMotionAnalyzer : NSObject <AssayAnalyzer>
 
 @property NSUInteger numberOfVotingFrames;
 @property NSUInteger quorum;
@@ -0,0 +1,262 @@
+//
+//  ConsensusLuminancePlateAnalyzer.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#include "ConsensusLuminancePlateAnalyzer.hpp"
+#include "PlateResults.hpp"
+#include "CvUtilities.hpp"
+#include "DebugOverlay.hpp"
+#include "ScratchArena.hpp"
+#include "FrameBufferPool.hpp"
+#include <opencv2/imgproc/types_c.h>
+#include <opencv2/imgproc/imgproc_c.h>
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <mutex>
+#include <random>
+
+static const double WellEdgeFindingInsetProportion = 0.7;
+static const double PlateMovingProportionAboveThresholdLimit = 0.06;
+static const double PlateMovingProportionAboveThresholdLimitFullPlate = 0.20;
+static const int MinimumVotingTileRows = 64;
+static const int VotingBlurRadius = 9;        // of the 19x19 kernel that cvSmooth() uses for a sigma of 3 on 8 bit images
+static const char* WellOccupancyID = "Well Occupancy";
+
+ConsensusLuminancePlateAnalyzer::ConsensusLuminancePlateAnalyzer(double ignoreFramesPostMovementTimeInterval)
+    : numberOfVotingFrames(5), quorum(3), evaluateFramesAmongLastSeconds(1.0), deltaThresholdCutoff(10),
+      _ignoreFramesPostMovementTimeInterval(ignoreFramesPostMovementTimeInterval), _pixelwiseVotes(NULL),
+      _lastMovementThresholdPresentationTime(0)
+{
+}
+
+ConsensusLuminancePlateAnalyzer::~ConsensusLuminancePlateAnalyzer()
+{
+    FrameBufferPool::sharedPool().releaseImage(&_pixelwiseVotes);
+}
+
+bool ConsensusLuminancePlateAnalyzer::canProcessInParallel() const
+{
+    return true;
+}
+
+void ConsensusLuminancePlateAnalyzer::willBeginPlateTracking(PlateResults &results)
+{
+    results.setReportingStyle(ReportingStyleMean | ReportingStyleStdDev | ReportingStylePercent, WellOccupancyID);
+}
+
+bool ConsensusLuminancePlateAnalyzer::willBeginFrameProcessing(const AnalysisFrameRef &frame, unsigned maximumConcurrency, DebugOverlay &debugOverlay, PlateResults & /* results */)
+{
+    if (_lastFrames.size() < numberOfVotingFrames) {
+        if (debugOverlay.enabled()) {
+            CvSize size = debugOverlay.size();
+            CvFont wellFont = fontForNormalizedScale(3.5, size);
+            debugOverlay.drawText("ACQUIRING IMAGES",
+                                  cvPoint(size.width * 0.2, size.height * 0.55),
+                                  wellFont,
+                                  CV_RGBA(232, 0, 217, 255));
+        }
+        return false;
+    }
+
+    // Remove frames that are too old to consider
+    while (_lastFrames.size() > numberOfVotingFrames) {
+        if (_lastFrames.front()->presentationTime < frame->presentationTime - evaluateFramesAmongLastSeconds) {
+            _lastFrames.pop_front();
+        } else {
+            break;
+        }
+    }
+
+    // Randomly choose a subset of numberOfVotingFrames recent images. We choose the subset once per place to minimize inter-well noise.
+    // The vectors are members so that their storage is reused from frame to frame, and are cleared before returning.
+    std::vector<AnalysisFrameRef> &frameChoices = _frameChoices;
+    std::vector<AnalysisFrameRef> &randomlyChosenFrames = _randomlyChosenFrames;
+    frameChoices.assign(_lastFrames.begin(), _lastFrames.end());
+    std::minstd_rand generator(randomSeedForFrame(frame->presentationTime, -1));
+    for (size_t i = 0; i < numberOfVotingFrames && frameChoices.size() > 0; i++) {
+        size_t randomIndex = generator() % frameChoices.size();
+        randomlyChosenFrames.push_back(frameChoices[randomIndex]);
+        frameChoices.erase(frameChoices.begin() + randomIndex);
+    }
+
+    // ===== Plate movement and illumination change detection =====
+
+    assert(!_pixelwiseVotes);       // _pixelwiseVotes already exists
+    assert(randomlyChosenFrames.size() > 0);
+    CvSize frameSize = cvGetSize(frame->image);
+    _pixelwiseVotes = FrameBufferPool::sharedPool().createImage(frameSize, IPL_DEPTH_8U, 1);
+    fastZeroImage(_pixelwiseVotes);
+
+    // Each voting frame's comparison can be split into bands of rows, so that the stage uses each of the plate's cores
+    // even with few voting frames. The bands give the same votes as whole frames, since the blur reads the rows of the
+    // frames within its radius of each band, and the other steps are pixelwise. Each band's votes are added while they
+    // are in cache. The sums are of integers, so they don't depend on the order in which the bands finish.
+    ScratchArena::Scope frameScratchScope;
+    int *movedPixelCounts = frameScratchScope.arena().allocateArray<int>(randomlyChosenFrames.size());
+    std::fill(movedPixelCounts, movedPixelCounts + randomlyChosenFrames.size(), 0);
+    std::mutex criticalSection;
+    _votingWorkDecomposer.run(randomlyChosenFrames.size(), maximumConcurrency, std::max(frameSize.height / MinimumVotingTileRows, 1),
+                              [&](size_t i, int tile, int tileCount) {
+        // The band's temporaries are released at the end of the band
+        ScratchArena::Scope scratchScope;
+        ScratchArena &scratch = scratchScope.arena();
+        const AnalysisFrameRef &pastFrame = randomlyChosenFrames[i];
+        int firstRow, rowCount;
+        WorkDecomposer::rowsForTile(frameSize.height, tile, tileCount, firstRow, rowCount);
+        int firstBlurredRow = std::max(firstRow - VotingBlurRadius, 0);
+        int blurredRowCount = std::min(firstRow + rowCount + VotingBlurRadius, frameSize.height) - firstBlurredRow;
+        CvRect blurredRect = cvRect(0, firstBlurredRow, frameSize.width, blurredRowCount);
+        IplImage frameImage = *frame->image, pastFrameImage = *pastFrame->image;
+        IplROI frameROI, pastFrameROI;
+        setImageHeaderROI(&frameImage, &frameROI, blurredRect);
+        setImageHeaderROI(&pastFrameImage, &pastFrameROI, blurredRect);
+
+        // Subtract the plate images channelwise
+        IplImage* plateDelta = scratch.createImage(cvSize(frameSize.width, blurredRowCount), IPL_DEPTH_8U, 4);
+        cvAbsDiff(&frameImage, &pastFrameImage, plateDelta);
+
+        // Gaussian blur the delta
+        cvSmooth(plateDelta, plateDelta, CV_GAUSSIAN, 0, 0, 3, 3);
+
+        // Convert the delta to luminance, leaving out the rows beyond the band
+        IplImage* deltaLuminance = scratch.createImage(cvSize(frameSize.width, rowCount), IPL_DEPTH_8U, 1);
+        IplROI plateDeltaROI;
+        setImageHeaderROI(plateDelta, &plateDeltaROI, cvRect(0, firstRow - firstBlurredRow, frameSize.width, rowCount));
+        cvCvtColor(plateDelta, deltaLuminance, CV_BGR2GRAY);
+
+        // Threshold the image to isolate difference pixels corresponding to movement as opposed to noise,
+        // setting each pixel that passes the threshold to 1 (for ease in summing below)
+        IplImage* deltaThresholdedImage = scratch.createImage(cvGetSize(deltaLuminance), IPL_DEPTH_8U, 1);
+        cvThreshold(deltaLuminance, deltaThresholdedImage, deltaThresholdCutoff, 1, CV_THRESH_BINARY);
+        int movedPixelCount = cvCountNonZero(deltaThresholdedImage);
+
+        {
+            std::lock_guard<std::mutex> lock(criticalSection);
+            // Sum the threshold subimages from the random set delta from the current frame. The luminance sum at each
+            // pixel will equal the number of votes, since we set the pixels that passed the threshold to 1.
+            IplImage votesBand = *_pixelwiseVotes;
+            IplROI votesBandROI;
+            setImageHeaderROI(&votesBand, &votesBandROI, cvRect(0, firstRow, frameSize.width, rowCount));
+            cvAdd(&votesBand, deltaThresholdedImage, &votesBand);
+            movedPixelCounts[i] += movedPixelCount;
+        }
+    });
+
+    // Calculate the mean for plate movement/lighting change determination
+    double meanProportionPlateMoved = 0.0;
+    for (size_t i = 0; i < randomlyChosenFrames.size(); i++) {
+        meanProportionPlateMoved += (double)movedPixelCounts[i] / (frameSize.width * frameSize.height);
+    }
+    meanProportionPlateMoved /= randomlyChosenFrames.size();
+    frameChoices.clear();
+    randomlyChosenFrames.clear();
+
+    // If the average luminance delta across the set of entire plate images is more than about 6% (20% in full plate/single well), the entire plate is likely moving.
+    // Note that PlateData's well count was never set (i.e. was always 0) when this analyzer was written against it, so
+    // every plate has been held to the full plate limit. That is kept so that scores remain comparable with past runs.
+    bool fullPlate = true;      // rather than results.wellCount() <= 1
+    bool overThreshold = meanProportionPlateMoved > (fullPlate ? PlateMovingProportionAboveThresholdLimitFullPlate : PlateMovingProportionAboveThresholdLimit);
+    if (overThreshold || _lastMovementThresholdPresentationTime == 0) {     // start in moved mode
+        _lastMovementThresholdPresentationTime = frame->presentationTime;
+    }
+
+    if (overThreshold || _lastMovementThresholdPresentationTime + _ignoreFramesPostMovementTimeInterval > frame->presentationTime) {
+        // Draw the movement text
+        if (debugOverlay.enabled()) {
+            CvSize size = debugOverlay.size();
+            CvFont wellFont = fontForNormalizedScale(3.5, size);
+            debugOverlay.drawText("PLATE OR LIGHTING MOVING",
+                                  cvPoint(size.width * 0.075, size.height * 0.55),
+                                  wellFont,
+                                  CV_RGBA(232, 0, 217, 255));
+        }
+        return false;
+    }
+
+    return true;
+}
+
+void ConsensusLuminancePlateAnalyzer::processWell(IplImage *wellImage, int well, DebugOverlay &debugOverlay, double /* presentationTime */, PlateResults &results)
+{
+    // The temporaries are released at the end of the well
+    ScratchArena::Scope scratchScope;
+    ScratchArena &scratch = scratchScope.arena();
+
+    // ======= Contour finding ========
+
+    // Create a circle mask with all bits on in the circle using only a portion of the circle to conservatively avoid taking the well walls.
+    int radius = cvGetSize(wellImage).width / 2;
+    IplImage *insetCircleMask = NULL;
+    if (well >= 0) {
+        insetCircleMask = scratch.createImage(cvGetSize(wellImage), IPL_DEPTH_8U, 1);
+        fastZeroImage(insetCircleMask);
+        cvCircle(insetCircleMask, cvPoint(insetCircleMask->width / 2, insetCircleMask->height / 2), radius * WellEdgeFindingInsetProportion, cvRealScalar(255), CV_FILLED);
+    }
+
+    // Find edges in the image
+    IplImage* cannyEdges = scratch.createImage(cvGetSize(wellImage), IPL_DEPTH_8U, 1);
+    cvCanny(wellImage, cannyEdges, 50, 150);
+
+    // Mask off the edge pixels that correspond to the wells
+    if (insetCircleMask) {
+        cvAnd(cannyEdges, insetCircleMask, cannyEdges);
+    }
+
+    // Dilate the edge image
+    IplImage* dilatedEdges = scratch.createImage(cvGetSize(cannyEdges), IPL_DEPTH_8U, 1);
+    cvDilate(cannyEdges, dilatedEdges);
+
+    // Store the pixel counts and draw debugging images
+    double occupancyFraction = (double)cvCountNonZero(dilatedEdges) / (dilatedEdges->width * dilatedEdges->height);
+    results.stageResult(occupancyFraction, WellOccupancyID, well);
+    debugOverlay.fillMask(dilatedEdges, CV_RGBA(0, 0, 255, 255));
+
+    // ======== Motion measurement =========
+
+    // Create an circle mask with all bits on in the circle (but not inset)
+    IplImage *circleMask = NULL;
+    if (well >= 0) {
+        circleMask = scratch.createImage(cvGetSize(wellImage), IPL_DEPTH_8U, 1);
+        fastZeroImage(circleMask);
+        cvCircle(circleMask, cvPoint(circleMask->width / 2, circleMask->height / 2), radius, cvRealScalar(255), CV_FILLED);
+    }
+
+    // Mask the pixelwise votes (using a local stack copy of the header for threadsafety)
+    IplImage wellPixelwiseVotes = *_pixelwiseVotes;
+    IplROI wellROI;
+    setImageHeaderROI(&wellPixelwiseVotes, &wellROI, cvGetImageROI(wellImage));
+    if (circleMask) {
+        cvAnd(&wellPixelwiseVotes, circleMask, &wellPixelwiseVotes);
+    }
+
+    // Keep the pixels that have a quorum
+    IplImage *quorumPixels = scratch.createImage(cvGetSize(wellImage), IPL_DEPTH_8U, 1);
+    cvThreshold(&wellPixelwiseVotes, quorumPixels, quorum - 0.5, 255, CV_THRESH_BINARY);
+    double movedFraction = (double)cvCountNonZero(quorumPixels) / (M_PI * radius * radius) * 1000.0;  // use milli-fractions for readability
+
+    // Count pixels and draw onto the debugging image
+    results.stageMovementUnit(movedFraction, well);
+    debugOverlay.fillMask(quorumPixels, CV_RGBA(255, 0, 0, 255));
+}
+
+void ConsensusLuminancePlateAnalyzer::didEndFrameProcessing(const AnalysisFrameRef &frame, PlateResults & /* results */)
+{
+    _lastFrames.push_back(frame);
+    FrameBufferPool::sharedPool().releaseImage(&_pixelwiseVotes);
+}
+
+double ConsensusLuminancePlateAnalyzer::minimumTimeIntervalProcessedToReportData() const
+{
+    return 5.0;
+}
+
+size_t ConsensusLuminancePlateAnalyzer::minimumSamplesProcessedToReportData() const
+{
+    return 5;
+}
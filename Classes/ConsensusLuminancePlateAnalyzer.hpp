@@ -0,0 +1,48 @@
+//
+//  ConsensusLuminancePlateAnalyzer.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef ConsensusLuminancePlateAnalyzer_hpp
+#define ConsensusLuminancePlateAnalyzer_hpp
+
+#include <deque>
+#include "PlateAnalyzer.hpp"
+
+// The analysis behind ConsensusLuminanceMotionAnalyzer. Each frame is compared to a random subset of the recent frames,
+// and pixels whose luminance differs from a quorum of them are counted as moving.
+class ConsensusLuminancePlateAnalyzer : public PlateAnalyzer {
+public:
+    explicit ConsensusLuminancePlateAnalyzer(double ignoreFramesPostMovementTimeInterval = DefaultIgnoreFramesPostMovementTimeInterval);
+    virtual ~ConsensusLuminancePlateAnalyzer();
+
+    size_t numberOfVotingFrames;
+    size_t quorum;
+    double evaluateFramesAmongLastSeconds;
+    size_t deltaThresholdCutoff;
+
+    virtual bool canProcessInParallel() const;
+    virtual void willBeginPlateTracking(PlateResults &results);
+    virtual bool willBeginFrameProcessing(const AnalysisFrameRef &frame, unsigned maximumConcurrency, DebugOverlay &debugOverlay, PlateResults &results);
+    virtual void processWell(IplImage *wellImage, int well, DebugOverlay &debugOverlay, double presentationTime, PlateResults &results);
+    virtual void didEndFrameProcessing(const AnalysisFrameRef &frame, PlateResults &results);
+    virtual double minimumTimeIntervalProcessedToReportData() const;
+    virtual size_t minimumSamplesProcessedToReportData() const;
+
+private:
+    ConsensusLuminancePlateAnalyzer(const ConsensusLuminancePlateAnalyzer &);      // not copyable
+    ConsensusLuminancePlateAnalyzer &operator=(const ConsensusLuminancePlateAnalyzer &);
+
+    double _ignoreFramesPostMovementTimeInterval;
+    std::deque<AnalysisFrameRef> _lastFrames;
+    IplImage* _pixelwiseVotes;
+    double _lastMovementThresholdPresentationTime;
+    WorkDecomposer _votingWorkDecomposer;       // for the plate movement votes of each frame
+    std::vector<AnalysisFrameRef> _frameChoices;
+    std::vector<AnalysisFrameRef> _randomlyChosenFrames;
+};
+
+#endif
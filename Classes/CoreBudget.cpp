@@ -0,0 +1,90 @@
+//
+//  CoreBudget.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#include "CoreBudget.hpp"
+#include <algorithm>
+#include <thread>
+
+CoreBudget::CoreBudget(unsigned cores)
+    : _cores(std::max(cores, 1U)), _backgroundTaskCount(0)
+{
+}
+
+static unsigned sharedBudgetCores = 0;         // 0 for a core per hardware thread
+
+CoreBudget &CoreBudget::sharedBudget()
+{
+    static CoreBudget *sharedBudget = new CoreBudget(sharedBudgetCores > 0 ? sharedBudgetCores : std::thread::hardware_concurrency());      // never destroyed
+    return *sharedBudget;
+}
+
+void CoreBudget::setSharedBudgetCores(unsigned cores)
+{
+    sharedBudgetCores = cores;
+}
+
+void CoreBudget::addClient(const void *client)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (std::find(_clients.begin(), _clients.end(), client) == _clients.end()) {
+        _clients.push_back(client);
+    }
+}
+
+void CoreBudget::removeClient(const void *client)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _clients.erase(std::remove(_clients.begin(), _clients.end(), client), _clients.end());
+}
+
+size_t CoreBudget::clientCount() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _clients.size();
+}
+
+unsigned CoreBudget::shareForClientAtIndex(size_t index, size_t clientCount) const
+{
+    unsigned share = (unsigned)(_cores / clientCount) + (index < _cores % clientCount ? 1 : 0);
+    return std::max(share, 1U);
+}
+
+unsigned CoreBudget::shareForClient(const void *client) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<const void *>::const_iterator it = std::find(_clients.begin(), _clients.end(), client);
+    if (it == _clients.end()) {
+        return shareForClientAtIndex(_clients.size(), _clients.size() + 1);
+    }
+    return shareForClientAtIndex(it - _clients.begin(), _clients.size());
+}
+
+unsigned CoreBudget::backgroundShare() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return shareForClientAtIndex(_clients.size(), _clients.size() + 1);
+}
+
+bool CoreBudget::tryBeginBackgroundTask()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    // Background work is one more share, e.g. all of the cores when no plates are being tracked
+    if (_backgroundTaskCount >= shareForClientAtIndex(_clients.size(), _clients.size() + 1)) {
+        return false;
+    }
+    _backgroundTaskCount++;
+    return true;
+}
+
+void CoreBudget::endBackgroundTask()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_backgroundTaskCount > 0) {
+        _backgroundTaskCount--;
+    }
+}
@@ -0,0 +1,62 @@
+//
+//  CoreBudget.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef CoreBudget_hpp
+#define CoreBudget_hpp
+
+#include <stddef.h>
+#include <mutex>
+#include <vector>
+
+// Apportions the cores among the plates that are being tracked at once (e.g. by several cameras on one station), so that
+// each gets a fair share of the CPU rather than every plate spreading its per-well work over all of the cores. Each
+// tracked plate is a client, and the cores are divided evenly among the clients, with any remainder going to the
+// earliest. Background work (well finding and barcode reading) is collectively given one more share, and is deferred
+// rather than queued when that share is in use, since it is repeated periodically anyway. Thread-safe.
+class CoreBudget {
+public:
+    explicit CoreBudget(unsigned cores);
+
+    // Shared by every processor, with a core per hardware thread unless another number of cores is set before it is first
+    // used (e.g. to check that the results don't depend on the number of cores)
+    static CoreBudget &sharedBudget();
+    static void setSharedBudgetCores(unsigned cores);
+
+    unsigned cores() const { return _cores; }
+
+    // Clients are identified by an opaque pointer (e.g. the processor). Adding an existing client or removing an unknown
+    // one has no effect.
+    void addClient(const void *client);
+    void removeClient(const void *client);
+    size_t clientCount() const;
+
+    // The number of cores the client's per-well work should be spread over, at least 1. Those that aren't clients get
+    // the share that they would as a new one.
+    unsigned shareForClient(const void *client) const;
+
+    // The number of cores that background work is given collectively, which a background task that runs in parallel
+    // (e.g. well finding) should be spread over
+    unsigned backgroundShare() const;
+
+    // Returns true if a background task may begin now, in which case endBackgroundTask() must be called once it ends
+    bool tryBeginBackgroundTask();
+    void endBackgroundTask();
+
+private:
+    CoreBudget(const CoreBudget &);
+    CoreBudget &operator=(const CoreBudget &);
+
+    unsigned shareForClientAtIndex(size_t index, size_t clientCount) const;     // requires the lock to be held
+
+    const unsigned _cores;
+    mutable std::mutex _mutex;
+    std::vector<const void *> _clients;         // in the order they were added
+    unsigned _backgroundTaskCount;
+};
+
+#endif
@@ -6,7 +6,10 @@
 //  Copyright 2011 Chris Marcellino. All rights reserved.
 //
 
-#import <opencv2/core/core.hpp>
+#ifndef CvUtilities_hpp
+#define CvUtilities_hpp
+
+#include <opencv2/core/core.hpp>
 
 static inline int rectArea(const CvRect& rect)
 {
@@ -61,19 +64,36 @@ static inline CvRect outsetRect(CvRect rect, int dx, int dy)
     return rect;
 }
 
+// Sets the ROI of a copy of an image header (e.g. a stack copy, so that a shared image can have a ROI per thread) without
+// allocating it as cvSetImageROI() would, by storing it in roiStorage, which must outlive the header's use. The header
+// must not then be passed to cvResetImageROI(), which would free the storage.
+static inline void setImageHeaderROI(IplImage *header, IplROI *roiStorage, CvRect rect)
+{
+    roiStorage->coi = 0;
+    header->roi = roiStorage;
+    cvSetImageROI(header, rect);
+}
+
 static inline void fastZeroImage(IplImage *image)
 {
     assert(image->nChannels != 4);
     memset(image->imageData, 0, image->imageSize);
 }
 
-// Returns a font with drawing size proportional to the image provided with respect to normalizedScale.
-static inline CvFont fontForNormalizedScale(double normalizedScale, IplImage* image)
+// Returns a font with drawing size proportional to the image size provided with respect to normalizedScale.
+static inline CvFont fontForNormalizedScale(double normalizedScale, CvSize imageSize)
 {
-    double fontScale = MIN(image->width, image->height) / 1080.0 * normalizedScale;
+    double fontScale = MIN(imageSize.width, imageSize.height) / 1080.0 * normalizedScale;
     CvFont font;
     cvInitFont(&font, CV_FONT_HERSHEY_DUPLEX, fontScale, fontScale, 0, fontScale);
     return font;
 }
 
+static inline CvFont fontForNormalizedScale(double normalizedScale, IplImage* image)
+{
+    return fontForNormalizedScale(normalizedScale, cvSize(image->width, image->height));
+}
+
 #define CV_RGBA( r, g, b, a )  cvScalar( (b), (g), (r), (a) )
+
+#endif
@@ -0,0 +1,32 @@
+//
+//  DebugFrame.h
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+@class VideoFrame;
+#ifdef __cplusplus
+class DebugOverlay;
+#endif
+
+// A processed video frame along with the debugging overlay drawn for it, to be displayed to the user. The overlay is
+// only composited (onto a copy, leaving the video frame unmodified) when an image is created for display, so frames that
+// are never displayed cost no rendering.
+// Thread-safe.
+@interface DebugFrame : NSObject
+
+#ifdef __cplusplus
+- (id)initWithVideoFrame:(VideoFrame *)videoFrame debugOverlay:(const DebugOverlay &)debugOverlay;
+#endif
+
+@property(readonly) VideoFrame *videoFrame;
+@property(readonly) NSTimeInterval presentationTime;
+
+- (CGImageRef)createCGImage CF_RETURNS_RETAINED;
+
+@end
@@ -0,0 +1,54 @@
+//
+//  DebugFrame.mm
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#import "DebugFrame.h"
+#import "VideoFrame.h"
+#import "DebugOverlay.hpp"
+#import "FrameBufferPool.hpp"
+
+// Here for C++ build safety
+@interface DebugFrame () {
+    VideoFrame *_videoFrame;
+    DebugOverlay _debugOverlay;
+}
+
+@end
+
+
+@implementation DebugFrame
+
+@synthesize videoFrame = _videoFrame;
+
+- (id)initWithVideoFrame:(VideoFrame *)videoFrame debugOverlay:(const DebugOverlay &)debugOverlay
+{
+    if ((self = [super init])) {
+        NSAssert(videoFrame, @"video frame is required");
+        _videoFrame = videoFrame;
+        _debugOverlay = debugOverlay;
+    }
+    return self;
+}
+
+- (NSTimeInterval)presentationTime
+{
+    return [_videoFrame presentationTime];
+}
+
+- (CGImageRef)createCGImage
+{
+    if (_debugOverlay.empty()) {
+        return [_videoFrame createCGImage];
+    }
+    
+    IplImage *composite = FrameBufferPool::sharedPool().cloneImage([_videoFrame image]);
+    _debugOverlay.composite(composite);
+    VideoFrame *compositeFrame = [[VideoFrame alloc] initWithIplImageTakingOwnership:composite presentationTime:[_videoFrame presentationTime]];
+    return [compositeFrame createCGImage];      // the image data retains the frame
+}
+
+@end
@@ -0,0 +1,247 @@
+//
+//  DebugOverlay.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#include "DebugOverlay.hpp"
+#include "FrameBufferPool.hpp"
+#include <opencv2/imgproc/imgproc_c.h>
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+static const size_t MaximumMaskColors = 255;        // palette index 0 is transparent
+
+namespace {
+
+struct Primitive {
+    enum Type { Line, Circle, Text } type;
+    CvRect clip;            // the region drawn into, in frame coordinates
+    CvPoint pt1, pt2;       // relative to clip
+    int radius;
+    int thickness;
+    CvScalar color;
+    CvFont font;
+    std::string text;
+    bool aboveMask;
+};
+
+}
+
+struct DebugOverlay::Layer {
+    CvSize frameSize;
+    std::mutex mutex;
+    std::vector<Primitive> primitives;
+    IplImage *mask;         // palette indices, NULL until the first mask fill
+    CvRect maskBounds;      // bounding rect of the filled masks
+    std::vector<CvScalar> palette;
+
+    Layer(CvSize size) : frameSize(size), mask(NULL), maskBounds(cvRect(0, 0, 0, 0)) {}
+    ~Layer()
+    {
+        FrameBufferPool::sharedPool().releaseImage(&mask);
+    }
+
+    void addPrimitive(Primitive &primitive)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        primitive.aboveMask = mask != NULL;
+        primitives.push_back(primitive);
+    }
+};
+
+static CvRect intersectRects(CvRect a, CvRect b)
+{
+    int x = std::max(a.x, b.x);
+    int y = std::max(a.y, b.y);
+    int width = std::min(a.x + a.width, b.x + b.width) - x;
+    int height = std::min(a.y + a.height, b.y + b.height) - y;
+    return cvRect(x, y, std::max(width, 0), std::max(height, 0));
+}
+
+static CvRect unionRects(CvRect a, CvRect b)
+{
+    if (a.width == 0 || a.height == 0) {
+        return b;
+    }
+    int x = std::min(a.x, b.x);
+    int y = std::min(a.y, b.y);
+    return cvRect(x, y, std::max(a.x + a.width, b.x + b.width) - x, std::max(a.y + a.height, b.y + b.height) - y);
+}
+
+DebugOverlay::DebugOverlay() :
+    _rect(cvRect(0, 0, 0, 0))
+{
+}
+
+DebugOverlay::DebugOverlay(CvSize frameSize) :
+    _layer(std::make_shared<Layer>(frameSize)),
+    _rect(cvRect(0, 0, frameSize.width, frameSize.height))
+{
+}
+
+DebugOverlay DebugOverlay::region(CvRect rect) const
+{
+    DebugOverlay region = *this;
+    region._rect = intersectRects(cvRect(_rect.x + rect.x, _rect.y + rect.y, rect.width, rect.height), _rect);
+    return region;
+}
+
+void DebugOverlay::drawLine(CvPoint pt1, CvPoint pt2, CvScalar color, int thickness)
+{
+    if (!_layer) {
+        return;
+    }
+    Primitive primitive;
+    primitive.type = Primitive::Line;
+    primitive.clip = _rect;
+    primitive.pt1 = pt1;
+    primitive.pt2 = pt2;
+    primitive.color = color;
+    primitive.thickness = thickness;
+    _layer->addPrimitive(primitive);
+}
+
+void DebugOverlay::drawCircle(CvPoint center, int radius, CvScalar color, int thickness)
+{
+    if (!_layer) {
+        return;
+    }
+    Primitive primitive;
+    primitive.type = Primitive::Circle;
+    primitive.clip = _rect;
+    primitive.pt1 = center;
+    primitive.radius = radius;
+    primitive.color = color;
+    primitive.thickness = thickness;
+    _layer->addPrimitive(primitive);
+}
+
+void DebugOverlay::drawText(const std::string &text, CvPoint origin, const CvFont &font, CvScalar color)
+{
+    if (!_layer) {
+        return;
+    }
+    Primitive primitive;
+    primitive.type = Primitive::Text;
+    primitive.clip = _rect;
+    primitive.pt1 = origin;
+    primitive.font = font;
+    primitive.text = text;
+    primitive.color = color;
+    _layer->addPrimitive(primitive);
+}
+
+void DebugOverlay::fillMask(const IplImage *mask, CvScalar color)
+{
+    if (!_layer || _rect.width == 0 || _rect.height == 0) {
+        return;
+    }
+    assert(mask->depth == IPL_DEPTH_8U && mask->nChannels == 1);
+
+    IplImage layerMask;
+    int paletteIndex;
+    {
+        std::lock_guard<std::mutex> lock(_layer->mutex);
+        if (!_layer->mask) {
+            _layer->mask = FrameBufferPool::sharedPool().createImage(_layer->frameSize, IPL_DEPTH_8U, 1);
+            memset(_layer->mask->imageData, 0, _layer->mask->imageSize);
+        }
+        _layer->maskBounds = unionRects(_layer->maskBounds, _rect);
+
+        std::vector<CvScalar> &palette = _layer->palette;
+        size_t i = 0;
+        while (i < palette.size() && memcmp(&palette[i], &color, sizeof(color)) != 0) {
+            i++;
+        }
+        if (i == palette.size()) {
+            if (palette.size() < MaximumMaskColors) {
+                palette.push_back(color);
+            } else {
+                i = palette.size() - 1;     // out of colors, so reuse the last
+            }
+        }
+        paletteIndex = (int)i + 1;
+        layerMask = *_layer->mask;      // stack copy for its own ROI
+    }
+
+    // The mask writes are outside of the lock since regions being filled concurrently are disjoint
+    cvSetImageROI(&layerMask, _rect);
+    cvSet(&layerMask, cvRealScalar(paletteIndex), mask);
+}
+
+bool DebugOverlay::empty() const
+{
+    if (!_layer) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(_layer->mutex);
+    return _layer->primitives.empty() && !_layer->mask;
+}
+
+static void drawPrimitive(const Primitive &primitive, IplImage *image)
+{
+    IplImage clipped = *image;
+    cvSetImageROI(&clipped, primitive.clip);
+    switch (primitive.type) {
+        case Primitive::Line:
+            cvLine(&clipped, primitive.pt1, primitive.pt2, primitive.color, primitive.thickness);
+            break;
+        case Primitive::Circle:
+            cvCircle(&clipped, primitive.pt1, primitive.radius, primitive.color, primitive.thickness);
+            break;
+        case Primitive::Text:
+            cvPutText(&clipped, primitive.text.c_str(), primitive.pt1, &primitive.font, primitive.color);
+            break;
+    }
+}
+
+void DebugOverlay::composite(IplImage *image) const
+{
+    if (!_layer) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_layer->mutex);
+    assert(image->width == _layer->frameSize.width && image->height == _layer->frameSize.height);
+    assert(image->depth == IPL_DEPTH_8U && (image->nChannels == 3 || image->nChannels == 4));
+
+    const std::vector<Primitive> &primitives = _layer->primitives;
+    for (size_t i = 0; i < primitives.size(); i++) {
+        if (!primitives[i].aboveMask) {
+            drawPrimitive(primitives[i], image);
+        }
+    }
+
+    if (_layer->mask) {
+        // Expand the palette to pixels
+        int channels = image->nChannels;
+        uchar colors[MaximumMaskColors + 1][4];
+        for (size_t i = 0; i < _layer->palette.size(); i++) {
+            for (int c = 0; c < 4; c++) {
+                colors[i + 1][c] = (uchar)std::min(std::max(cvRound(_layer->palette[i].val[c]), 0), 255);
+            }
+        }
+
+        CvRect bounds = _layer->maskBounds;
+        for (int y = bounds.y; y < bounds.y + bounds.height; y++) {
+            const uchar *maskRow = (const uchar *)_layer->mask->imageData + y * _layer->mask->widthStep;
+            uchar *imageRow = (uchar *)image->imageData + y * image->widthStep;
+            for (int x = bounds.x; x < bounds.x + bounds.width; x++) {
+                if (maskRow[x]) {
+                    memcpy(imageRow + x * channels, colors[maskRow[x]], channels);
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < primitives.size(); i++) {
+        if (primitives[i].aboveMask) {
+            drawPrimitive(primitives[i], image);
+        }
+    }
+}
@@ -0,0 +1,53 @@
+//
+//  DebugOverlay.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef DebugOverlay_hpp
+#define DebugOverlay_hpp
+
+#include <opencv2/core/core_c.h>
+#include <memory>
+#include <string>
+
+// The debugging graphics drawn for a video frame (e.g. well circles, labels, movement indicators and edge masks).
+// Rather than drawing on a copy of the frame, drawing is recorded as a sparse list of primitives plus an 8-bit mask
+// layer (allocated only once a mask is filled), which is only rasterized by composite() for frames that are displayed.
+//
+// Instances are cheap handles onto a shared layer. region() returns a handle whose coordinates and clipping are
+// relative to a rectangle, like an IplImage ROI. A default constructed overlay is disabled and ignores all drawing.
+// Thread-safe, though concurrent mask fills must be to disjoint regions (e.g. separate wells).
+class DebugOverlay {
+public:
+    DebugOverlay();
+    explicit DebugOverlay(CvSize frameSize);
+
+    bool enabled() const { return (bool)_layer; }
+    CvSize size() const { return cvSize(_rect.width, _rect.height); }
+
+    // The rect is relative to this region and is clipped to it
+    DebugOverlay region(CvRect rect) const;
+
+    void drawLine(CvPoint pt1, CvPoint pt2, CvScalar color, int thickness = 1);
+    void drawCircle(CvPoint center, int radius, CvScalar color, int thickness = 1);
+    void drawText(const std::string &text, CvPoint origin, const CvFont &font, CvScalar color);
+    // Colors the pixels of the region where the 8-bit mask (which must be the size of the region) is nonzero. Masks
+    // appear above primitives drawn before the first mask was filled and beneath those drawn after it, and later masks
+    // cover earlier ones.
+    void fillMask(const IplImage *mask, CvScalar color);
+
+    bool empty() const;
+    // Draws the overlay onto a BGR(A) image the size of the frame
+    void composite(IplImage *image) const;
+
+private:
+    struct Layer;
+
+    std::shared_ptr<Layer> _layer;
+    CvRect _rect;           // in frame coordinates
+};
+
+#endif
@@ -20,6 +20,10 @@
     if ([[inAbsoluteURL scheme] caseInsensitiveCompare:BlackmagicDeckLinkCaptureDeviceScheme] == NSOrderedSame) {
         return BlackmagicDeckLinkCaptureDeviceFileType;
     }
+    // Also by extension in case Launch Services hasn't registered the app's declaration of the type
+    if ([inAbsoluteURL isFileURL] && [[inAbsoluteURL pathExtension] caseInsensitiveCompare:@"waframes"] == NSOrderedSame) {
+        return FrameRecordingFileType;
+    }
     
     return [super typeForContentsOfURL:inAbsoluteURL error:outError];
 }
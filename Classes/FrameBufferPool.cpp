@@ -0,0 +1,156 @@
+//
+//  FrameBufferPool.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#include "FrameBufferPool.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+static const size_t BufferAlignment = 64;
+
+bool FrameBufferPool::Key::operator<(const Key &other) const
+{
+    if (width != other.width) {
+        return width < other.width;
+    }
+    if (height != other.height) {
+        return height < other.height;
+    }
+    if (depth != other.depth) {
+        return depth < other.depth;
+    }
+    if (channels != other.channels) {
+        return channels < other.channels;
+    }
+    return widthStep < other.widthStep;
+}
+
+FrameBufferPool &FrameBufferPool::sharedPool()
+{
+    static FrameBufferPool *pool = new FrameBufferPool();     // never destroyed since frames may outlive static destructors
+    return *pool;
+}
+
+FrameBufferPool::FrameBufferPool(size_t maximumPooledBuffersPerKey, size_t maximumPooledBytes) :
+    _maximumPooledBuffersPerKey(maximumPooledBuffersPerKey),
+    _maximumPooledBytes(maximumPooledBytes)
+{
+    memset(&_statistics, 0, sizeof(_statistics));
+}
+
+FrameBufferPool::~FrameBufferPool()
+{
+    releasePooledBuffers();
+}
+
+IplImage *FrameBufferPool::createImage(CvSize size, int depth, int channels)
+{
+    // Create the header first so that the stride matches cvCreateImage()
+    IplImage *image = cvCreateImageHeader(size, depth, channels);
+    Key key = { size.width, size.height, depth, channels, image->widthStep };
+    size_t bufferSize = image->imageSize;
+
+    void *buffer = NULL;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _statistics.checkoutCount++;
+        std::vector<void *> &pooledBuffers = _pooledBuffersByKey[key];
+        if (!pooledBuffers.empty()) {
+            buffer = pooledBuffers.back();
+            pooledBuffers.pop_back();
+            _statistics.hitCount++;
+            _statistics.pooledBytes -= bufferSize;
+        }
+    }
+    if (!buffer && posix_memalign(&buffer, BufferAlignment, bufferSize) != 0) {
+        cvReleaseImageHeader(&image);
+        cvError(CV_StsNoMem, "FrameBufferPool::createImage", "Out of memory", __FILE__, __LINE__);
+        return NULL;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _outstandingBuffers[buffer] = key;
+        _statistics.outstandingBytes += bufferSize;
+        _statistics.outstandingBytesHighWater = std::max(_statistics.outstandingBytesHighWater, _statistics.outstandingBytes);
+    }
+
+    cvSetData(image, buffer, key.widthStep);
+    return image;
+}
+
+IplImage *FrameBufferPool::cloneImage(const IplImage *image)
+{
+    IplImage *clone = createImage(cvSize(image->width, image->height), image->depth, image->nChannels);
+    if (image->widthStep == clone->widthStep) {
+        memcpy(clone->imageData, image->imageData, image->imageSize);
+    } else {
+        size_t rowBytes = std::min(image->widthStep, clone->widthStep);
+        for (int y = 0; y < image->height; y++) {
+            memcpy(clone->imageData + y * clone->widthStep, image->imageData + y * image->widthStep, rowBytes);
+        }
+    }
+    return clone;
+}
+
+void FrameBufferPool::releaseImage(IplImage **image)
+{
+    if (!*image) {
+        return;
+    }
+
+    void *buffer = (*image)->imageDataOrigin;
+    bool pooled = false;
+    bool freeBuffer = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::map<void *, Key>::iterator it = _outstandingBuffers.find(buffer);
+        if (it != _outstandingBuffers.end()) {
+            pooled = true;
+            size_t bufferSize = (*image)->imageSize;
+            _statistics.outstandingBytes -= bufferSize;
+
+            std::vector<void *> &pooledBuffers = _pooledBuffersByKey[it->second];
+            if (pooledBuffers.size() < _maximumPooledBuffersPerKey && _statistics.pooledBytes + bufferSize <= _maximumPooledBytes) {
+                pooledBuffers.push_back(buffer);
+                _statistics.pooledBytes += bufferSize;
+                _statistics.pooledBytesHighWater = std::max(_statistics.pooledBytesHighWater, _statistics.pooledBytes);
+            } else {
+                freeBuffer = true;
+            }
+            _outstandingBuffers.erase(it);
+        }
+    }
+
+    if (pooled) {
+        if (freeBuffer) {
+            free(buffer);
+        }
+        cvReleaseImageHeader(image);
+    } else {
+        cvReleaseImage(image);
+    }
+}
+
+FrameBufferPool::Statistics FrameBufferPool::statistics()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _statistics;
+}
+
+void FrameBufferPool::releasePooledBuffers()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (std::map<Key, std::vector<void *> >::iterator it = _pooledBuffersByKey.begin(); it != _pooledBuffersByKey.end(); it++) {
+        for (size_t i = 0; i < it->second.size(); i++) {
+            free(it->second[i]);
+        }
+    }
+    _pooledBuffersByKey.clear();
+    _statistics.pooledBytes = 0;
+}
@@ -0,0 +1,66 @@
+//
+//  FrameBufferPool.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef FrameBufferPool_hpp
+#define FrameBufferPool_hpp
+
+#include <opencv2/core/core_c.h>
+#include <stdint.h>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// A thread-safe pool of image buffers keyed by size, depth, channel count and row stride, so that full-frame images
+// can be reused from frame to frame rather than being allocated (and page faulted in) and freed each time. Buffers
+// are 64 byte aligned and images have the same row stride as those from cvCreateImage(). Returned buffers are kept
+// for reuse up to a per-key count and overall byte limit, and are freed beyond that.
+class FrameBufferPool {
+public:
+    struct Statistics {
+        uint64_t checkoutCount;
+        uint64_t hitCount;                  // checkouts that reused a pooled buffer
+        size_t outstandingBytes;
+        size_t outstandingBytesHighWater;
+        size_t pooledBytes;
+        size_t pooledBytesHighWater;
+
+        double hitRate() const { return checkoutCount > 0 ? (double)hitCount / checkoutCount : 0.0; }
+    };
+
+    static FrameBufferPool &sharedPool();
+
+    FrameBufferPool(size_t maximumPooledBuffersPerKey = 16, size_t maximumPooledBytes = 512 * 1024 * 1024);
+    ~FrameBufferPool();
+
+    // The contents of the returned image are undefined
+    IplImage *createImage(CvSize size, int depth, int channels);
+    IplImage *cloneImage(const IplImage *image);        // copies the pixels only (the ROI and COI are not retained)
+    // Returns pooled images to the pool, and releases any other images with cvReleaseImage(). Sets *image to NULL.
+    void releaseImage(IplImage **image);
+
+    Statistics statistics();
+    void releasePooledBuffers();
+
+private:
+    struct Key {
+        int width, height, depth, channels, widthStep;
+        bool operator<(const Key &other) const;
+    };
+
+    FrameBufferPool(const FrameBufferPool &);
+    FrameBufferPool &operator=(const FrameBufferPool &);
+
+    std::mutex _mutex;
+    size_t _maximumPooledBuffersPerKey;
+    size_t _maximumPooledBytes;
+    std::map<Key, std::vector<void *> > _pooledBuffersByKey;
+    std::map<void *, Key> _outstandingBuffers;
+    Statistics _statistics;
+};
+
+#endif /* FrameBufferPool_hpp */
@@ -0,0 +1,108 @@
+//
+//  FrameIngest.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#include "FrameIngest.hpp"
+#include "FrameBufferPool.hpp"
+#include "YpCbCrConversion.hpp"
+#include <opencv2/imgproc/imgproc_c.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+static const int RowsPerChunk = 16;
+
+// Returns a header for a band of rows of an image without an ROI
+static IplImage rowBand(const IplImage *image, int firstRow, int rowCount)
+{
+    IplImage band = *image;
+    band.roi = NULL;
+    band.height = rowCount;
+    band.imageData = image->imageData + firstRow * image->widthStep;
+    band.imageSize = rowCount * image->widthStep;
+    return band;
+}
+
+static void copyRow(const uint8_t *src, uint8_t *dest, int width, int channels, bool mirror)
+{
+    if (!mirror) {
+        memcpy(dest, src, width * channels);
+    } else if (channels == 2) {
+        // UYVY: reverse the pairs and swap their luma, as in flipYpCbCr422Horizontally()
+        int pairs = width / 2;
+        for (int i = 0; i < pairs; i++) {
+            const uint8_t *pair = src + (pairs - 1 - i) * 4;
+            uint8_t *destPair = dest + i * 4;
+            destPair[0] = pair[0];
+            destPair[1] = pair[3];
+            destPair[2] = pair[2];
+            destPair[3] = pair[1];
+        }
+    } else {
+        assert(channels == 4);
+        for (int x = 0; x < width; x++) {
+            memcpy(dest + x * 4, src + (width - 1 - x) * 4, 4);
+        }
+    }
+}
+
+bool canIngestImageByRows(CvSize srcSize, CvSize destSize)
+{
+    return srcSize.height == destSize.height;
+}
+
+void ingestImageRows(const IplImage *src, IplImage *dest, bool flipHorizontally, bool flipVertically, int firstRow, int rowCount)
+{
+    assert(canIngestImageByRows(cvGetSize(src), cvGetSize(dest)) && firstRow + rowCount <= src->height);
+    int endRow = firstRow + rowCount;
+
+    if (src->width == dest->width) {
+        assert(src->nChannels == dest->nChannels);
+        for (int row = firstRow; row < endRow; row++) {
+            int destRow = flipVertically ? dest->height - 1 - row : row;
+            copyRow((const uint8_t *)src->imageData + row * src->widthStep,
+                    (uint8_t *)dest->imageData + destRow * dest->widthStep,
+                    src->width,
+                    src->nChannels,
+                    flipHorizontally);
+        }
+        return;
+    }
+
+    // Convert and resize a chunk of rows at a time into scratch images small enough to stay in cache. Since only the
+    // width changes, each resized row depends only on the same source row.
+    assert(dest->nChannels == 4);
+    FrameBufferPool &pool = FrameBufferPool::sharedPool();
+    IplImage *converted = src->nChannels == 2 ? pool.createImage(cvSize(src->width, RowsPerChunk), IPL_DEPTH_8U, 4) : NULL;
+    IplImage *resized = pool.createImage(cvSize(dest->width, RowsPerChunk), IPL_DEPTH_8U, 4);
+
+    for (int row = firstRow; row < endRow; row += RowsPerChunk) {
+        int chunkRows = std::min(RowsPerChunk, endRow - row);
+        IplImage srcChunk = rowBand(src, row, chunkRows);
+        IplImage resizedChunk = rowBand(resized, 0, chunkRows);
+        if (converted) {
+            IplImage convertedChunk = rowBand(converted, 0, chunkRows);
+            convertYpCbCr422ToBGRA8(&srcChunk, &convertedChunk, 0, chunkRows);
+            cvResize(&convertedChunk, &resizedChunk, CV_INTER_AREA);
+        } else {
+            cvResize(&srcChunk, &resizedChunk, CV_INTER_AREA);
+        }
+
+        for (int i = 0; i < chunkRows; i++) {
+            int destRow = flipVertically ? dest->height - 1 - (row + i) : row + i;
+            copyRow((const uint8_t *)resized->imageData + i * resized->widthStep,
+                    (uint8_t *)dest->imageData + destRow * dest->widthStep,
+                    dest->width,
+                    4,
+                    flipHorizontally);
+        }
+    }
+
+    pool.releaseImage(&converted);
+    pool.releaseImage(&resized);
+}
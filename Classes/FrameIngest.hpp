@@ -0,0 +1,27 @@
+//
+//  FrameIngest.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef FrameIngest_hpp
+#define FrameIngest_hpp
+
+#include <opencv2/core/core_c.h>
+
+// Copies a captured image (UYVY or BGRA, see YpCbCrConversion.hpp) into a frame of its final size and orientation in
+// a single pass, converting UYVY to BGRA and resizing with CV_INTER_AREA only if the sizes differ (e.g. for anamorphic
+// sources), then flipping. The result is identical to converting, resizing and then calling cvFlip() separately.
+// Without resizing, the destination must have the same format as the source (i.e. UYVY is kept). The work is done in
+// small row chunks that stay in cache, and separate row stripes may be ingested in parallel.
+
+// Returns whether the resize can be done row by row, which is the case when only the width changes (i.e. the usual
+// anamorphic pixel aspect ratios). Otherwise the steps must be performed separately over the whole image.
+bool canIngestImageByRows(CvSize srcSize, CvSize destSize);
+
+// Ingests the rows [firstRow, firstRow + rowCount) of the source, which are written to the flipped rows of dest.
+void ingestImageRows(const IplImage *src, IplImage *dest, bool flipHorizontally, bool flipVertically, int firstRow, int rowCount);
+
+#endif
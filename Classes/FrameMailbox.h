@@ -0,0 +1,29 @@
+//
+//  FrameMailbox.h
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+// A single-slot mailbox that hands frames from a producer (e.g. the capture callback) to a dedicated consumer thread
+// with latest-wins semantics. Depositing a frame while the previous one is still waiting replaces (drops) it, so when
+// the consumer becomes free it always takes the most recent frame, rather than a stale one or none until the next frame
+// arrives. The slot is exchanged atomically, so the producer never blocks or takes a lock, and the consumer thread is
+// woken directly by a semaphore rather than by hopping between operation queues. Thread-safe.
+@interface FrameMailbox : NSObject
+
+- (id)initWithName:(NSString *)name;
+
+// The block processes one frame on the consumer thread. Returns NO if a frame that was still waiting was dropped.
+- (BOOL)depositFrameOperationWithBlock:(void (^)(void))block;
+
+@property(readonly) NSUInteger depositedFrameCount;
+@property(readonly) NSUInteger droppedFrameCount;
+
+// Stops the consumer thread once it finishes any frame it is processing. A waiting frame is dropped.
+- (void)close;
+
+@end
@@ -0,0 +1,101 @@
+//
+//  FrameMailbox.mm
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#import "FrameMailbox.h"
+#import <atomic>
+
+// Here for C++ build safety
+@interface FrameMailbox () {
+    std::atomic<void *> _slot;                  // a retained block, or NULL
+    std::atomic<bool> _closed;
+    std::atomic<NSUInteger> _depositedFrameCount;
+    std::atomic<NSUInteger> _droppedFrameCount;
+    dispatch_semaphore_t _frameAvailable;       // signaled each time a block is placed in the empty slot
+}
+
+@end
+
+
+@implementation FrameMailbox
+
+- (id)initWithName:(NSString *)name
+{
+    if ((self = [super init])) {
+        _slot = NULL;
+        _closed = false;
+        _depositedFrameCount = 0;
+        _droppedFrameCount = 0;
+        _frameAvailable = dispatch_semaphore_create(0);
+        
+        // The thread retains the mailbox until it is closed. Since each signal corresponds to the slot being filled,
+        // and only this thread empties it, every wakeup finds a block (unless closed).
+        NSThread *thread = [[NSThread alloc] initWithBlock:^{
+            while (true) {
+                dispatch_semaphore_wait(_frameAvailable, DISPATCH_TIME_FOREVER);
+                if (_closed) {
+                    break;
+                }
+                @autoreleasepool {
+                    void (^block)(void) = (__bridge_transfer void (^)(void))_slot.exchange(NULL);
+                    if (block) {
+                        block();
+                    }
+                }
+            }
+            [self releaseWaitingFrame];
+        }];
+        [thread setName:name];
+        [thread setQualityOfService:NSQualityOfServiceUserInteractive];
+        [thread start];
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self releaseWaitingFrame];
+}
+
+- (void)releaseWaitingFrame
+{
+    void *block = _slot.exchange(NULL);
+    if (block) {
+        CFRelease(block);
+    }
+}
+
+- (BOOL)depositFrameOperationWithBlock:(void (^)(void))block
+{
+    _depositedFrameCount++;
+    void *previous = _slot.exchange((__bridge_retained void *)[block copy]);
+    if (previous) {
+        CFRelease(previous);
+        _droppedFrameCount++;
+        return NO;
+    }
+    dispatch_semaphore_signal(_frameAvailable);
+    return YES;
+}
+
+- (NSUInteger)depositedFrameCount
+{
+    return _depositedFrameCount;
+}
+
+- (NSUInteger)droppedFrameCount
+{
+    return _droppedFrameCount;
+}
+
+- (void)close
+{
+    _closed = true;
+    dispatch_semaphore_signal(_frameAvailable);
+}
+
+@end
@@ -0,0 +1,30 @@
+//
+//  FramePipelineStage.h
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+// A serial stage of the frame processing pipeline (e.g. conversion, geometry, analysis, overlay). At most 'capacity'
+// frames may be in the stage at once, counting both the frame being processed and those waiting. This lets successive
+// stages work on successive frames concurrently while keeping the frames in order and bounding the frames in flight.
+// Thread-safe.
+@interface FramePipelineStage : NSObject
+
+- (id)initWithName:(NSString *)name capacity:(NSUInteger)capacity;
+
+@property(readonly) NSString *name;
+
+// Blocks until the stage has room for the frame, then enqueues the block (i.e. backpressure to the previous stage)
+- (void)addFrameOperationWithBlock:(void (^)(void))block;
+// Enqueues the block only if the stage has room. Returns NO if it is full, in which case the frame should be dropped.
+- (BOOL)tryAddFrameOperationWithBlock:(void (^)(void))block;
+// Enqueues a block that does not count against the capacity, in order after the frames already enqueued. Never blocks.
+- (void)addControlOperationWithBlock:(void (^)(void))block;
+
+- (void)waitUntilAllOperationsAreFinished;
+
+@end
@@ -0,0 +1,73 @@
+//
+//  FramePipelineStage.m
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#import "FramePipelineStage.h"
+
+@interface FramePipelineStage () {
+    NSOperationQueue *_queue;           // serial
+    dispatch_semaphore_t _slots;        // one per frame that may be in the stage
+}
+
+@end
+
+
+@implementation FramePipelineStage
+
+- (id)initWithName:(NSString *)name capacity:(NSUInteger)capacity
+{
+    if ((self = [super init])) {
+        NSAssert(capacity > 0, @"capacity must be positive");
+        _queue = [[NSOperationQueue alloc] init];
+        [_queue setName:name];
+        [_queue setMaxConcurrentOperationCount:1];
+        [_queue setQualityOfService:NSQualityOfServiceUserInteractive];
+        _slots = dispatch_semaphore_create(capacity);
+    }
+    return self;
+}
+
+- (NSString *)name
+{
+    return [_queue name];
+}
+
+- (void)addFrameOperationWithBlock:(void (^)(void))block
+{
+    dispatch_semaphore_wait(_slots, DISPATCH_TIME_FOREVER);
+    [self addOperationReleasingSlotWithBlock:block];
+}
+
+- (BOOL)tryAddFrameOperationWithBlock:(void (^)(void))block
+{
+    if (dispatch_semaphore_wait(_slots, DISPATCH_TIME_NOW) != 0) {
+        return NO;
+    }
+    [self addOperationReleasingSlotWithBlock:block];
+    return YES;
+}
+
+- (void)addOperationReleasingSlotWithBlock:(void (^)(void))block
+{
+    dispatch_semaphore_t slots = _slots;
+    [_queue addOperationWithBlock:^{
+        block();
+        dispatch_semaphore_signal(slots);
+    }];
+}
+
+- (void)addControlOperationWithBlock:(void (^)(void))block
+{
+    [_queue addOperationWithBlock:block];
+}
+
+- (void)waitUntilAllOperationsAreFinished
+{
+    [_queue waitUntilAllOperationsAreFinished];
+}
+
+@end
@@ -0,0 +1,346 @@
+//
+//  FrameRecording.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#include "FrameRecording.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char *const FrameRecordingPathExtension = "waframes";
+
+static const char FrameRecordingSignature[8] = { 'W', 'A', 'F', 'R', 'A', 'M', 'E', 'S' };
+static const uint32_t FrameRecordingVersion = 1;
+static const size_t FrameRecordingAlignment = 64;
+
+struct FrameRecordingFileHeader {
+    char signature[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint8_t reserved[48];
+};
+
+struct FrameRecordingChunkHeader {
+    uint32_t type;                  // a FrameRecordingEventType
+    uint32_t flip;
+    double presentationTime;
+    uint64_t payloadSize;           // including the padding
+    int32_t width;
+    int32_t height;
+    int32_t channels;
+    int32_t widthStep;
+    uint8_t reserved[24];
+};
+
+static_assert(sizeof(FrameRecordingFileHeader) == FrameRecordingAlignment, "file header must be one alignment unit");
+static_assert(sizeof(FrameRecordingChunkHeader) == FrameRecordingAlignment, "chunk header must be one alignment unit");
+
+static size_t paddedSize(size_t size)
+{
+    return (size + FrameRecordingAlignment - 1) / FrameRecordingAlignment * FrameRecordingAlignment;
+}
+
+FrameRecordingWriter::FrameRecordingWriter()
+    : _queuedFrameCount(0), _closing(false), _file(NULL), _frameCount(0), _dropCount(0)
+{
+}
+
+FrameRecordingWriter::~FrameRecordingWriter()
+{
+    close();
+}
+
+// Writes a 64 byte header and the payload, padded
+static bool writeChunk(FILE *file, const void *header, const void *payload, size_t payloadSize)
+{
+    static const char padding[FrameRecordingAlignment] = { 0 };
+    size_t paddingSize = paddedSize(payloadSize) - payloadSize;
+    return fwrite(header, FrameRecordingAlignment, 1, file) == 1 &&
+           (payloadSize == 0 || fwrite(payload, payloadSize, 1, file) == 1) &&
+           (paddingSize == 0 || fwrite(padding, paddingSize, 1, file) == 1);
+}
+
+bool FrameRecordingWriter::open(const std::string &path, std::string &error)
+{
+    close();
+    std::lock_guard<std::mutex> lock(_mutex);
+    _frameCount = _dropCount = 0;
+    _file = fopen(path.c_str(), "wb");
+    if (!_file) {
+        error = std::string("unable to create file: ") + strerror(errno);
+        return false;
+    }
+
+    FrameRecordingFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.signature, FrameRecordingSignature, sizeof(header.signature));
+    header.version = FrameRecordingVersion;
+    header.headerSize = sizeof(header);
+    if (!writeChunk(_file, &header, NULL, 0)) {
+        error = std::string("unable to write file: ") + strerror(errno);
+        fclose(_file);
+        _file = NULL;
+        return false;
+    }
+    _writerThread = std::thread(&FrameRecordingWriter::writeQueuedChunks, this);
+    return true;
+}
+
+bool FrameRecordingWriter::isOpen()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _file != NULL && !_closing;
+}
+
+void FrameRecordingWriter::enqueueChunk(const void *header, const IplImage *image)
+{
+    _queue.push_back(QueuedChunk());
+    QueuedChunk &chunk = _queue.back();
+    chunk.header.assign((const char *)header, (const char *)header + FrameRecordingAlignment);
+    chunk.isFrame = image != NULL;
+    if (image) {
+        if (!_spareBuffers.empty()) {
+            chunk.payload.swap(_spareBuffers.back());
+            _spareBuffers.pop_back();
+        }
+        chunk.payload.assign(image->imageData, image->imageData + (size_t)image->widthStep * image->height);
+        _queuedFrameCount++;
+    }
+    _queueChanged.notify_all();
+}
+
+void FrameRecordingWriter::appendFrame(const IplImage *image, unsigned flip, double presentationTime)
+{
+    if (image->depth != IPL_DEPTH_8U || (image->nChannels != 2 && image->nChannels != 4)) {
+        return;
+    }
+    // Wait for the disk rather than drop the frame from the recording
+    std::unique_lock<std::mutex> lock(_mutex);
+    _queueChanged.wait(lock, [&]() { return !_file || _closing || _queuedFrameCount < MaximumQueuedFrames; });
+    if (!_file || _closing) {
+        return;
+    }
+
+    FrameRecordingChunkHeader header;
+    memset(&header, 0, sizeof(header));
+    header.type = FrameRecordingEventFrame;
+    header.flip = flip;
+    header.presentationTime = presentationTime;
+    header.payloadSize = paddedSize((size_t)image->widthStep * image->height);
+    header.width = image->width;
+    header.height = image->height;
+    header.channels = image->nChannels;
+    header.widthStep = image->widthStep;
+    enqueueChunk(&header, image);
+}
+
+void FrameRecordingWriter::appendDrop(double presentationTime)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_file || _closing) {
+        return;
+    }
+
+    FrameRecordingChunkHeader header;
+    memset(&header, 0, sizeof(header));
+    header.type = FrameRecordingEventDrop;
+    header.presentationTime = presentationTime;
+    enqueueChunk(&header, NULL);
+}
+
+// Writes the chunks in the order they were queued, without the lock held, until the writer is closed and the queue is
+// empty or a write fails, and then closes the file
+void FrameRecordingWriter::writeQueuedChunks()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _queueChanged.wait(lock, [&]() { return !_queue.empty() || _closing; });
+        if (_queue.empty()) {
+            fclose(_file);
+            _file = NULL;
+            return;
+        }
+        QueuedChunk chunk;
+        chunk.header.swap(_queue.front().header);
+        chunk.payload.swap(_queue.front().payload);
+        chunk.isFrame = _queue.front().isFrame;
+        _queue.pop_front();
+        FILE *file = _file;
+
+        lock.unlock();
+        bool success = writeChunk(file, chunk.header.data(), chunk.payload.data(), chunk.payload.size());
+        lock.lock();
+
+        if (chunk.isFrame) {
+            _queuedFrameCount--;
+            _spareBuffers.push_back(std::vector<char>());
+            _spareBuffers.back().swap(chunk.payload);
+        }
+        if (success) {
+            (chunk.isFrame ? _frameCount : _dropCount)++;
+        } else {
+            fclose(_file);
+            _file = NULL;
+            _queue.clear();
+            _queuedFrameCount = 0;
+            _spareBuffers.clear();
+        }
+        _queueChanged.notify_all();
+        if (!_file) {
+            return;
+        }
+    }
+}
+
+void FrameRecordingWriter::close()
+{
+    std::thread writerThread;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_writerThread.joinable()) {
+            return;
+        }
+        _closing = true;
+        writerThread.swap(_writerThread);
+        _queueChanged.notify_all();
+    }
+    writerThread.join();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _spareBuffers.clear();
+    _closing = false;
+}
+
+uint64_t FrameRecordingWriter::frameCount()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _frameCount;
+}
+
+uint64_t FrameRecordingWriter::dropCount()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _dropCount;
+}
+
+FrameRecordingReader::FrameRecordingReader()
+    : _mapping(NULL), _mappingLength(0), _frameCount(0)
+{
+}
+
+FrameRecordingReader::~FrameRecordingReader()
+{
+    if (_mapping) {
+        munmap(_mapping, _mappingLength);
+    }
+}
+
+bool FrameRecordingReader::fileIsRecording(const std::string &path)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    char signature[sizeof(FrameRecordingSignature)];
+    bool isRecording = fread(signature, sizeof(signature), 1, file) == 1 &&
+                       memcmp(signature, FrameRecordingSignature, sizeof(signature)) == 0;
+    fclose(file);
+    return isRecording;
+}
+
+bool FrameRecordingReader::open(const std::string &path, std::string &error)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = std::string("unable to open file: ") + strerror(errno);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        error = std::string("unable to read file: ") + strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    if ((size_t)info.st_size < sizeof(FrameRecordingFileHeader)) {
+        error = "not a frame recording";
+        ::close(fd);
+        return false;
+    }
+    _mappingLength = (size_t)info.st_size;
+    _mapping = mmap(NULL, _mappingLength, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);            // the mapping remains valid
+    if (_mapping == MAP_FAILED) {
+        _mapping = NULL;
+        error = std::string("unable to map file: ") + strerror(errno);
+        return false;
+    }
+    // Frames are read once, in order
+    madvise(_mapping, _mappingLength, MADV_SEQUENTIAL);
+
+    const char *bytes = (const char *)_mapping;
+    const FrameRecordingFileHeader *fileHeader = (const FrameRecordingFileHeader *)bytes;
+    if (memcmp(fileHeader->signature, FrameRecordingSignature, sizeof(FrameRecordingSignature)) != 0) {
+        error = "not a frame recording";
+        return false;
+    }
+    if (fileHeader->version != FrameRecordingVersion || fileHeader->headerSize != sizeof(FrameRecordingFileHeader)) {
+        error = "unsupported frame recording version";
+        return false;
+    }
+
+    // Index the complete chunks
+    size_t offset = sizeof(FrameRecordingFileHeader);
+    while (_mappingLength - offset >= sizeof(FrameRecordingChunkHeader)) {
+        const FrameRecordingChunkHeader *header = (const FrameRecordingChunkHeader *)(bytes + offset);
+        offset += sizeof(FrameRecordingChunkHeader);
+        if (header->payloadSize > _mappingLength - offset) {
+            break;          // truncated
+        }
+
+        Event event;
+        memset(&event, 0, sizeof(event));
+        event.type = (FrameRecordingEventType)header->type;
+        event.presentationTime = header->presentationTime;
+        if (header->type == FrameRecordingEventFrame) {
+            if (header->width <= 0 || header->height <= 0 || (header->channels != 2 && header->channels != 4) ||
+                header->widthStep < header->width * header->channels ||
+                (uint64_t)header->widthStep * header->height > header->payloadSize) {
+                error = "invalid frame in frame recording";
+                return false;
+            }
+            event.flip = header->flip;
+            event.size = cvSize(header->width, header->height);
+            event.channels = header->channels;
+            event.widthStep = header->widthStep;
+            event.imageData = bytes + offset;
+            _frameCount++;
+        } else if (header->type != FrameRecordingEventDrop) {
+            offset += header->payloadSize;
+            continue;       // skip chunk types from future versions
+        }
+        _events.push_back(event);
+        offset += header->payloadSize;
+    }
+    return true;
+}
+
+double FrameRecordingReader::frameRate() const
+{
+    if (_events.size() < 2 || _events.back().presentationTime <= _events.front().presentationTime) {
+        return 0.0;
+    }
+    return (_events.size() - 1) / (_events.back().presentationTime - _events.front().presentationTime);
+}
+
+void FrameRecordingReader::initImageHeader(const Event &event, IplImage *header)
+{
+    cvInitImageHeader(header, event.size, IPL_DEPTH_8U, event.channels);
+    cvSetData(header, (void *)event.imageData, event.widthStep);
+}
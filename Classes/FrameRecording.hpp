@@ -0,0 +1,127 @@
+//
+//  FrameRecording.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef FrameRecording_hpp
+#define FrameRecording_hpp
+
+#include <opencv2/core/core_c.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Frame recordings (.waframes) hold the exact frames given to the analysis pipeline, after conversion and flipping, so
+// that a run can be replayed bit-for-bit rather than by re-decoding a lossy movie. A recording is a 64 byte file header
+// followed by a sequence of chunks, each a 64 byte chunk header and then (for frames) the image's rows with its row
+// stride, padded to a multiple of 64 bytes. Frames are stored in their native representation, i.e. packed UYVY for
+// frames captured as 422YpCbCr8, else BGRA. Since each image starts on a 64 byte boundary, a memory mapped recording can
+// be read without copying. Values are in the host's byte order (little endian on every supported platform). A recording
+// that was cut short (e.g. by a crash) is readable up to its last complete chunk.
+
+extern const char *const FrameRecordingPathExtension;       // "waframes"
+
+enum FrameRecordingEventType {
+    FrameRecordingEventFrame = 1,
+    FrameRecordingEventDrop = 2         // a frame was dropped before it reached the pipeline
+};
+
+// Appends to a recording. The chunks are written in order by the writer's own thread, so appending a frame only copies
+// it, and the caller (e.g. the geometry stage) only waits for the disk if MaximumQueuedFrames frames are already waiting
+// to be written. Frames are never dropped from the recording. Thread-safe, so that drops may be noted from any thread.
+class FrameRecordingWriter {
+public:
+    enum {
+        MaximumQueuedFrames = 8
+    };
+
+    FrameRecordingWriter();
+    ~FrameRecordingWriter();        // closes the file
+
+    // Creates (or replaces) the file. Returns false and sets error on failure.
+    bool open(const std::string &path, std::string &error);
+    bool isOpen();
+
+    // Appends an 8-bit, 2 channel (UYVY) or 4 channel (BGRA) image, which is copied. flip holds the VideoFrameFlip bits
+    // of the frame. Once a write fails, the file is closed and further appends are ignored.
+    void appendFrame(const IplImage *image, unsigned flip, double presentationTime);
+    void appendDrop(double presentationTime);
+    void close();                   // writes any queued chunks first
+
+    // Of those written so far
+    uint64_t frameCount();
+    uint64_t dropCount();
+
+private:
+    struct QueuedChunk {
+        std::vector<char> header;   // a chunk header
+        std::vector<char> payload;  // the image's rows, empty for drops
+        bool isFrame;
+    };
+
+    FrameRecordingWriter(const FrameRecordingWriter &);
+    FrameRecordingWriter &operator=(const FrameRecordingWriter &);
+
+    void enqueueChunk(const void *header, const IplImage *image);      // requires the lock to be held
+    void writeQueuedChunks();       // the writer thread
+
+    std::mutex _mutex;
+    std::condition_variable _queueChanged;
+    std::deque<QueuedChunk> _queue;
+    size_t _queuedFrameCount;
+    std::vector<std::vector<char> > _spareBuffers;     // of written frames, reused so that appending doesn't allocate
+    std::thread _writerThread;
+    bool _closing;
+    FILE *_file;                    // written to and closed by the writer thread once it has begun
+    uint64_t _frameCount;
+    uint64_t _dropCount;
+};
+
+// Memory maps a recording and indexes its chunks. Not thread-safe while opening; the images may be read concurrently.
+class FrameRecordingReader {
+public:
+    struct Event {
+        FrameRecordingEventType type;
+        double presentationTime;
+        unsigned flip;              // frames only
+        CvSize size;                // frames only
+        int channels;               // frames only; 2 for UYVY, 4 for BGRA
+        int widthStep;              // frames only
+        const char *imageData;      // frames only; points into the mapping
+    };
+
+    FrameRecordingReader();
+    ~FrameRecordingReader();        // unmaps the file, invalidating all image headers
+
+    // Returns false and sets error on failure
+    bool open(const std::string &path, std::string &error);
+    // Whether the file starts with the recording signature
+    static bool fileIsRecording(const std::string &path);
+
+    const std::vector<Event> &events() const { return _events; }
+    size_t frameCount() const { return _frameCount; }
+    // The mean frame rate, counting drops as frames, or 0 if there are too few frames to tell
+    double frameRate() const;
+
+    // Initializes header to refer (without copying) to the read-only pixels of a frame event
+    static void initImageHeader(const Event &event, IplImage *header);
+
+private:
+    FrameRecordingReader(const FrameRecordingReader &);
+    FrameRecordingReader &operator=(const FrameRecordingReader &);
+
+    void *_mapping;
+    size_t _mappingLength;
+    std::vector<Event> _events;
+    size_t _frameCount;
+};
+
+#endif
@@ -0,0 +1,28 @@
+//
+//  FrameRecordingSource.h
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class VideoFrame;
+
+// Replays the frames of a frame recording (see FrameRecording.hpp) as VideoFrames with their recorded flips and
+// presentation times, so that they can be given to a VideoProcessor exactly as they were when recorded. The recording
+// is memory mapped. Not thread-safe.
+@interface FrameRecordingSource : NSObject
+
+- (id)initWithPath:(NSString *)path error:(NSError **)outError;
+
+@property(readonly) NSSize frameSize;           // of the first frame
+@property(readonly) NSUInteger frameCount;
+@property(readonly) NSUInteger dropCount;
+
+// Returns the next frame, copied into images of the shared FrameBufferPool, or nil at the end of the recording.
+// droppedFrameCount is set to the number of drops that were recorded since the previous frame.
+- (VideoFrame *)nextFrameWithDroppedFrameCount:(NSUInteger *)droppedFrameCount;
+
+@end
@@ -0,0 +1,95 @@
+//
+//  FrameRecordingSource.mm
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#import "FrameRecordingSource.h"
+#import "VideoFrame.h"
+#import "FrameRecording.hpp"
+#import "FrameBufferPool.hpp"
+#import <string>
+
+// Here for C++ build safety
+@interface FrameRecordingSource () {
+    FrameRecordingReader _reader;
+    size_t _nextEventIndex;
+    NSUInteger _dropCount;
+}
+
+@end
+
+
+@implementation FrameRecordingSource
+
+@synthesize dropCount = _dropCount;
+
+- (id)initWithPath:(NSString *)path error:(NSError **)outError
+{
+    if ((self = [super init])) {
+        std::string error;
+        if (!_reader.open([path fileSystemRepresentation], error) || _reader.frameCount() == 0) {
+            if (outError) {
+                NSString *description = error.empty() ? NSLocalizedString(@"The frame recording contains no frames", nil) :
+                                                        [NSString stringWithUTF8String:error.c_str()];
+                *outError = [NSError errorWithDomain:NSCocoaErrorDomain
+                                                code:NSFileReadCorruptFileError
+                                            userInfo:@{ NSLocalizedDescriptionKey : description }];
+            }
+            return nil;
+        }
+        for (const FrameRecordingReader::Event &event : _reader.events()) {
+            if (event.type == FrameRecordingEventDrop) {
+                _dropCount++;
+            }
+        }
+    }
+    return self;
+}
+
+- (NSSize)frameSize
+{
+    for (const FrameRecordingReader::Event &event : _reader.events()) {
+        if (event.type == FrameRecordingEventFrame) {
+            return NSMakeSize(event.size.width, event.size.height);
+        }
+    }
+    return NSZeroSize;
+}
+
+- (NSUInteger)frameCount
+{
+    return _reader.frameCount();
+}
+
+- (VideoFrame *)nextFrameWithDroppedFrameCount:(NSUInteger *)droppedFrameCount
+{
+    NSUInteger drops = 0;
+    const std::vector<FrameRecordingReader::Event> &events = _reader.events();
+    while (_nextEventIndex < events.size() && events[_nextEventIndex].type == FrameRecordingEventDrop) {
+        drops++;
+        _nextEventIndex++;
+    }
+    if (droppedFrameCount) {
+        *droppedFrameCount = drops;
+    }
+    if (_nextEventIndex >= events.size()) {
+        return nil;
+    }
+
+    // Copy the frame out of the read-only mapping, since frames are modified in place by the pipeline
+    const FrameRecordingReader::Event &event = events[_nextEventIndex++];
+    IplImage header;
+    FrameRecordingReader::initImageHeader(event, &header);
+    IplImage *image = FrameBufferPool::sharedPool().cloneImage(&header);
+    BOOL isYpCbCr = image->nChannels == 2;
+    return [[VideoFrame alloc] initWithImage:isYpCbCr ? NULL : image
+                                   lumaImage:NULL
+                                 ypCbCrImage:isYpCbCr ? image : NULL
+                                        flip:(VideoFrameFlip)event.flip
+                            presentationTime:event.presentationTime];
+}
+
+@end
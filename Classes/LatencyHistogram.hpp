@@ -0,0 +1,154 @@
+//
+//  LatencyHistogram.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef LatencyHistogram_hpp
+#define LatencyHistogram_hpp
+
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+// A fixed-memory log-linear histogram of durations (in seconds) with microsecond resolution. Each power of two
+// is divided into 16 linear sub-buckets, so reported percentiles are within 1/16 (6.25%) of the true value.
+// Durations over ~35 minutes are clamped. Statistics are kept for the whole run and for a sliding window of the
+// most recent samples. Not thread-safe.
+class LatencyHistogram {
+public:
+    enum {
+        SubBucketBits = 4,
+        SubBucketCount = 1 << SubBucketBits,
+        MaximumMagnitudeBits = 31,
+        BucketCount = (MaximumMagnitudeBits - SubBucketBits + 2) * SubBucketCount,
+        SlidingWindowCount = 300        // 10 seconds at 30 fps
+    };
+
+    LatencyHistogram()
+    {
+        memset(this, 0, sizeof(*this));
+    }
+
+    void addSample(double seconds)
+    {
+        // Remove the oldest sample from the sliding window once it is full
+        if (_windowSampleCount == SlidingWindowCount) {
+            _windowCounts[bucketIndexForSeconds(_window[_windowNextIndex])]--;
+        } else {
+            _windowSampleCount++;
+        }
+        _window[_windowNextIndex] = seconds;
+        _windowNextIndex = (_windowNextIndex + 1) % SlidingWindowCount;
+
+        int index = bucketIndexForSeconds(seconds);
+        _windowCounts[index]++;
+        _totalCounts[index]++;
+        _totalSampleCount++;
+        _totalMaximum = std::max(_totalMaximum, seconds);
+    }
+
+    uint64_t sampleCount(bool wholeRun) const
+    {
+        return wholeRun ? _totalSampleCount : _windowSampleCount;
+    }
+
+    // Returns the upper bound of the bucket containing the percentile (0 < percentile <= 1), or 0 if there are no samples
+    double percentile(double percentile, bool wholeRun) const
+    {
+        uint64_t count = sampleCount(wholeRun);
+        if (count == 0) {
+            return 0.0;
+        }
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t)ceil(percentile * count));
+        uint64_t cumulative = 0;
+        for (int i = 0; i < BucketCount; i++) {
+            cumulative += wholeRun ? _totalCounts[i] : _windowCounts[i];
+            if (cumulative >= rank) {
+                return std::min(bucketUpperBoundSeconds(i), maximum(wholeRun));
+            }
+        }
+        return maximum(wholeRun);
+    }
+
+    // Exact
+    double maximum(bool wholeRun) const
+    {
+        if (wholeRun) {
+            return _totalMaximum;
+        }
+        double windowMaximum = 0.0;
+        for (int i = 0; i < _windowSampleCount; i++) {
+            windowMaximum = std::max(windowMaximum, _window[i]);
+        }
+        return windowMaximum;
+    }
+
+    // Calculates the exact mean and standard deviation of the most recent samples (up to the sliding window size).
+    // Returns false if there are no samples.
+    bool recentMeanAndStdDev(int lastSamples, double &mean, double &stddev) const
+    {
+        int count = std::min(lastSamples, _windowSampleCount);
+        if (count <= 0) {
+            return false;
+        }
+        double sum = 0.0;
+        for (int i = 0; i < count; i++) {
+            sum += recentSample(i);
+        }
+        mean = sum / count;
+
+        double variance = 0.0;
+        for (int i = 0; i < count; i++) {
+            double difference = recentSample(i) - mean;
+            variance += difference * difference;
+        }
+        variance /= count;
+        stddev = sqrt(variance);
+        return true;
+    }
+
+private:
+    static int bucketIndexForSeconds(double seconds)
+    {
+        double microseconds = seconds * 1e6;
+        uint64_t value = microseconds > 0.0 ? (uint64_t)microseconds : 0;
+        value = std::min<uint64_t>(value, (1ULL << (MaximumMagnitudeBits + 1)) - 1);
+        if (value < SubBucketCount) {
+            return (int)value;
+        }
+        int magnitude = 63 - __builtin_clzll(value);
+        int shift = magnitude - SubBucketBits;
+        return (shift + 1) * SubBucketCount + (int)((value >> shift) - SubBucketCount);
+    }
+
+    static double bucketUpperBoundSeconds(int index)
+    {
+        if (index < SubBucketCount) {
+            return (index + 1) * 1e-6;
+        }
+        int shift = index / SubBucketCount - 1;
+        uint64_t lowerBound = (uint64_t)(SubBucketCount + index % SubBucketCount) << shift;
+        return (lowerBound + (1ULL << shift)) * 1e-6;
+    }
+
+    // 0 is the most recent sample
+    double recentSample(int age) const
+    {
+        return _window[(_windowNextIndex + SlidingWindowCount - 1 - age) % SlidingWindowCount];
+    }
+
+    uint64_t _totalCounts[BucketCount];
+    uint64_t _totalSampleCount;
+    double _totalMaximum;
+
+    uint32_t _windowCounts[BucketCount];
+    double _window[SlidingWindowCount];
+    int _windowSampleCount;
+    int _windowNextIndex;
+};
+
+#endif /* LatencyHistogram_hpp */
@@ -7,49 +7,79 @@
 //
 
 #import "NullMotionAnalyzer.h"
-#import "VideoFrame.h"
 #import "CvUtilities.hpp"
+#import "DebugOverlay.hpp"
+#import <float.h>
 
-@implementation NullMotionAnalyzer
+// Analyzes nothing, only marking the frames as such
+class NullPlateAnalyzer : public PlateAnalyzer {
+public:
+    virtual bool canProcessInParallel() const
+    {
+        return true;
+    }
 
-+ (NSString *)analyzerName
-{
-    return NSLocalizedString(@"(none)", nil);
-}
+    virtual void willBeginPlateTracking(PlateResults & /* results */)
+    {
+    }
 
-- (BOOL)canProcessInParallel
-{
-    return YES;
-}
+    virtual bool willBeginFrameProcessing(const AnalysisFrameRef & /* frame */, unsigned /* maximumConcurrency */, DebugOverlay &debugOverlay, PlateResults & /* results */)
+    {
+        // Draw the movement text
+        if (debugOverlay.enabled()) {
+            CvSize size = debugOverlay.size();
+            CvFont wellFont = fontForNormalizedScale(3.5, size);
+            debugOverlay.drawText("ANALYSIS DISABLED",
+                                  cvPoint(size.width * 0.2, size.height * 0.55),
+                                  wellFont,
+                                  CV_RGBA(0, 0, 255, 255));
+        }
+        return false;
+    }
 
-- (void)willBeginPlateTrackingWithPlateData:(PlateData *)plateData
-{
+    virtual void processWell(IplImage * /* wellImage */, int /* well */, DebugOverlay & /* debugOverlay */, double /* presentationTime */, PlateResults & /* results */)
+    {
+        // nothing
+    }
+
+    virtual void didEndFrameProcessing(const AnalysisFrameRef & /* frame */, PlateResults & /* results */)
+    {
+        // nothing
+    }
+
+    virtual double minimumTimeIntervalProcessedToReportData() const
+    {
+        return FLT_MAX;
+    }
+
+    virtual size_t minimumSamplesProcessedToReportData() const
+    {
+        return NSIntegerMax;
+    }
+};
+
+// Here for C++ build safety
+@interface NullMotionAnalyzer () {
+    NullPlateAnalyzer _analyzer;
 }
 
-- (BOOL)willBeginFrameProcessing:(VideoFrame *)videoFrame debugImage:(IplImage*)debugImage plateData:(PlateData *)plateData
+@end
+
+
+@implementation NullMotionAnalyzer
+
++ (NSString *)analyzerName
 {
-    // Draw the movement text
-    CvFont wellFont = fontForNormalizedScale(3.5, debugImage);
-    cvPutText(debugImage,
-              "ANALYSIS DISABLED",
-              cvPoint(debugImage->width * 0.2, debugImage->height * 0.55),
-              &wellFont,
-              CV_RGBA(0, 0, 255, 255));
-    return NO;
+    return NSLocalizedString(@"(none)", nil);
 }
 
-- (void)processVideoFrameWellSynchronously:(IplImage*)wellImage
-                                   forWell:(int)well
-                                debugImage:(IplImage*)debugImage
-                          presentationTime:(NSTimeInterval)presentationTime
-                                 plateData:(PlateData *)plateData
+- (void)willBeginPlateTrackingWithPlateData:(PlateData *)plateData
 {
-    // nothing
 }
 
-- (void)didEndFrameProcessing:(VideoFrame *)videoFrame plateData:(PlateData *)plateData
+- (PlateAnalyzer &)plateAnalyzer
 {
-    // nothing
+    return _analyzer;
 }
 
 - (void)didEndTrackingPlateWithPlateData:(PlateData *)plateData
@@ -59,12 +89,12 @@
 
 - (NSTimeInterval)minimumTimeIntervalProcessedToReportData
 {
-    return FLT_MAX;
+    return _analyzer.minimumTimeIntervalProcessedToReportData();
 }
 
 - (NSUInteger)minimumSamplesProcessedToReportData
 {
-    return NSIntegerMax;
+    return _analyzer.minimumSamplesProcessedToReportData();
 }
 
 @end
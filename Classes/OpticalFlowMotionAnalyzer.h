@@ -9,12 +9,7 @@
 #import <Foundation/Foundation.h>
 #import "AssayAnalyzer.h"
 
-@class VideoFrame;
-
-@interface OpticalFlowMotionAnalyzer : NSObject <AssayAnalyzer> {
-    NSMutableArray *_lastFrames;
-    VideoFrame *_prevFrame;
-    NSTimeInterval _lastMovementThresholdPresentationTime;
-}
+// The analysis itself is in OpticalFlowPlateAnalyzer.hpp
+@interface OpticalFlowMotionAnalyzer : NSObject <AssayAnalyzer>
 
 @end
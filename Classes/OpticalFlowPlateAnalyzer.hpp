@@ -0,0 +1,36 @@
+//
+//  OpticalFlowPlateAnalyzer.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef OpticalFlowPlateAnalyzer_hpp
+#define OpticalFlowPlateAnalyzer_hpp
+
+#include <vector>
+#include "PlateAnalyzer.hpp"
+
+// The analysis behind OpticalFlowMotionAnalyzer. The edge points of each well are tracked with pyramidal Lucas-Kanade
+// optical flow to a frame at least 100 ms earlier, and their mean speed is the movement unit.
+class OpticalFlowPlateAnalyzer : public PlateAnalyzer {
+public:
+    explicit OpticalFlowPlateAnalyzer(double ignoreFramesPostMovementTimeInterval = DefaultIgnoreFramesPostMovementTimeInterval);
+
+    virtual bool canProcessInParallel() const;
+    virtual void willBeginPlateTracking(PlateResults &results);
+    virtual bool willBeginFrameProcessing(const AnalysisFrameRef &frame, unsigned maximumConcurrency, DebugOverlay &debugOverlay, PlateResults &results);
+    virtual void processWell(IplImage *wellImage, int well, DebugOverlay &debugOverlay, double presentationTime, PlateResults &results);
+    virtual void didEndFrameProcessing(const AnalysisFrameRef &frame, PlateResults &results);
+    virtual double minimumTimeIntervalProcessedToReportData() const;
+    virtual size_t minimumSamplesProcessedToReportData() const;
+
+private:
+    double _ignoreFramesPostMovementTimeInterval;
+    std::vector<AnalysisFrameRef> _lastFrames;
+    AnalysisFrameRef _prevFrame;
+    double _lastMovementThresholdPresentationTime;
+};
+
+#endif
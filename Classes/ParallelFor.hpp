@@ -0,0 +1,163 @@
+//
+//  ParallelFor.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef ParallelFor_hpp
+#define ParallelFor_hpp
+
+#include <stddef.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef __APPLE__
+#include <dispatch/dispatch.h>
+#endif
+
+#ifndef __APPLE__
+// The threads that help run parallelFor()'s loops where there is no dispatch_apply(). They live as long as the process,
+// so that a loop doesn't pay to create and join threads (e.g. for each stage of each frame), and the pool grows to the
+// most helpers any loop has asked for. Each loop's calling thread also runs the task, and once it returns, the helpers
+// that haven't begun yet are cancelled, so loops complete even when nested or when every helper is busy. Thread-safe.
+class ParallelForPool {
+public:
+    static ParallelForPool &sharedPool()
+    {
+        static ParallelForPool *sharedPool = new ParallelForPool();     // never destroyed, as its threads never exit
+        return *sharedPool;
+    }
+
+    // Calls task() on the calling thread and on up to helperCount helpers at once, and returns once all of the calls
+    // that began have returned. The task must finish the loop's work even if no helpers run.
+    template <typename Task>
+    void run(size_t helperCount, const Task &task)
+    {
+        Job job = { &invoke<Task>, &task, helperCount, 0 };
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            while (_threads.size() < helperCount) {
+                _threads.push_back(std::thread(&ParallelForPool::help, this));
+            }
+            _jobs.push_back(&job);
+        }
+        _jobAdded.notify_all();
+
+        task();
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (job.unclaimedHelperCount > 0) {
+            _jobs.erase(std::find(_jobs.begin(), _jobs.end(), &job));
+            job.unclaimedHelperCount = 0;
+        }
+        _helperFinished.wait(lock, [&]() { return job.activeHelperCount == 0; });
+    }
+
+private:
+    struct Job {
+        void (*invoke)(const void *task);
+        const void *task;
+        size_t unclaimedHelperCount;
+        size_t activeHelperCount;
+    };
+
+    ParallelForPool() {}
+    ParallelForPool(const ParallelForPool &);
+    ParallelForPool &operator=(const ParallelForPool &);
+
+    template <typename Task>
+    static void invoke(const void *task)
+    {
+        (*(const Task *)task)();
+    }
+
+    // Each thread runs the oldest job's task until it is out of helpers, and then the next
+    void help()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true) {
+            _jobAdded.wait(lock, [&]() { return !_jobs.empty(); });
+            Job *job = _jobs.front();
+            if (--job->unclaimedHelperCount == 0) {
+                _jobs.pop_front();
+            }
+            job->activeHelperCount++;
+
+            lock.unlock();
+            job->invoke(job->task);
+            lock.lock();
+
+            if (--job->activeHelperCount == 0) {
+                _helperFinished.notify_all();
+            }
+        }
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _jobAdded;
+    std::condition_variable _helperFinished;
+    std::deque<Job *> _jobs;                // those with unclaimed helpers, oldest first
+    std::vector<std::thread> _threads;
+};
+#endif
+
+// As below, but with at most maximumConcurrency calls running at once (e.g. a plate's share of the cores, see
+// CoreBudget), in a worker per core of the share that takes the next iteration as it finishes each one. Off Apple
+// platforms, the calling thread is one of the workers and the others are threads of the ParallelForPool.
+template <typename Body>
+void parallelFor(size_t iterations, unsigned maximumConcurrency, const Body &body)
+{
+    size_t workerCount = std::min<size_t>(std::max(maximumConcurrency, 1U), iterations);
+    if (workerCount <= 1) {
+        for (size_t i = 0; i < iterations; i++) {
+            body(i);
+        }
+        return;
+    }
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < iterations; i = next++) {
+            body(i);
+        }
+    };
+#ifdef __APPLE__
+    const decltype(worker) *workerPointer = &worker;
+    dispatch_apply(workerCount, DISPATCH_APPLY_AUTO, ^(size_t) {
+        (*workerPointer)();
+    });
+#else
+    ParallelForPool::sharedPool().run(workerCount - 1, worker);
+#endif
+}
+
+// Calls body(i) for each i in [0, iterations) concurrently and returns once all of the calls have. This is the portable
+// equivalent of +[NSOperationQueue addOperationsInParallelWithInstances:onGlobalQueueForBlock:] for the analysis core,
+// and likewise uses dispatch_apply() on Apple platforms, where the calls run at the priority of the calling thread (e.g.
+// its TaskScheduler lane). Elsewhere, the iterations are shared out to a worker per core.
+// Callers provide their own locking (e.g. a std::mutex) for any critical sections.
+template <typename Body>
+void parallelFor(size_t iterations, const Body &body)
+{
+    if (iterations <= 1) {
+        if (iterations == 1) {
+            body((size_t)0);
+        }
+        return;
+    }
+#ifdef __APPLE__
+    const Body *bodyPointer = &body;        // so that the block doesn't copy the body
+    dispatch_apply(iterations, DISPATCH_APPLY_AUTO, ^(size_t i) {
+        (*bodyPointer)(i);
+    });
+#else
+    parallelFor(iterations, std::max(std::thread::hardware_concurrency(), 1U), body);
+#endif
+}
+
+#endif
@@ -0,0 +1,51 @@
+//
+//  ParallelReduce.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef ParallelReduce_hpp
+#define ParallelReduce_hpp
+
+#include <stddef.h>
+#include <vector>
+#include "ParallelFor.hpp"
+
+// Combines values[0] through values[n - 1] into values[0] in a fixed binary tree: the first level combines each
+// even-indexed value with the next, the second each fourth value with the result two after it, and so on, with the
+// combinations of each level run concurrently on up to maximumConcurrency threads. combine(left, right) must be
+// associative and is always given the value covering the lower indices as left, so it needn't be commutative. As the
+// tree's shape depends only on n, the result is the same bits for any number of cores or order of completion (unlike a
+// running total under a lock), and a floating point sum accumulates less error than a serial one.
+template <typename T, typename Combine>
+void treeReduce(std::vector<T> &values, unsigned maximumConcurrency, const Combine &combine)
+{
+    for (size_t stride = 1; stride < values.size(); stride *= 2) {
+        size_t pairCount = (values.size() - stride + 2 * stride - 1) / (2 * stride);
+        parallelFor(pairCount, maximumConcurrency, [&](size_t pair) {
+            size_t left = pair * 2 * stride;
+            values[left] = combine(values[left], values[left + stride]);
+        });
+    }
+}
+
+// Returns the combination of map(i) for each i in [0, iterations) (or identity if there are none), computing the values
+// concurrently and combining them with treeReduce(), so that the result doesn't depend on the scheduling of the
+// iterations. Use this rather than accumulating into shared state from parallelFor().
+template <typename T, typename Map, typename Combine>
+T parallelReduce(size_t iterations, unsigned maximumConcurrency, const T &identity, const Map &map, const Combine &combine)
+{
+    if (iterations == 0) {
+        return identity;
+    }
+    std::vector<T> values(iterations, identity);
+    parallelFor(iterations, maximumConcurrency, [&](size_t i) {
+        values[i] = map(i);
+    });
+    treeReduce(values, maximumConcurrency, combine);
+    return values[0];
+}
+
+#endif
@@ -0,0 +1,96 @@
+//
+//  PlateAnalyzer.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#include "PlateAnalyzer.hpp"
+#include "PlateResults.hpp"
+#include "DebugOverlay.hpp"
+#include "CvUtilities.hpp"
+#include "Tracing.hpp"
+#include "ParallelFor.hpp"
+#include <stdlib.h>
+#include <string.h>
+
+PlateAnalyzer::PlateAnalyzer()
+    : _randomSeed((uint32_t)random())
+{
+}
+
+uint32_t PlateAnalyzer::randomSeedForFrame(double presentationTime, int well) const
+{
+    uint64_t timeBits;
+    memcpy(&timeBits, &presentationTime, sizeof(timeBits));
+    // SplitMix64 finalizer
+    uint64_t x = ((uint64_t)_randomSeed << 32) ^ timeBits ^ ((uint64_t)(well + 1) * 0x9E3779B97F4A7C15ULL);
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return (uint32_t)(x ^ (x >> 32));
+}
+
+void analyzePlateFrame(PlateAnalyzer &analyzer,
+                       const AnalysisFrameRef &frame,
+                       const std::vector<Circle> &wellCircles,
+                       unsigned maximumConcurrency,
+                       const PlateParallelLoop &parallelLoop,
+                       DebugOverlay &debugOverlay,
+                       PlateResults &results)
+{
+    results.beginFrame(frame->presentationTime);
+    bool processWells;
+    {
+        TraceSpan span("begin frame", frame->presentationTime);
+        processWells = analyzer.willBeginFrameProcessing(frame, maximumConcurrency, debugOverlay, results);
+    }
+    if (processWells) {
+        auto processWell = [&](size_t i) {
+            TraceSpan span("analyze well", frame->presentationTime, "well", (int)i);
+            // Make a stack copy of the header so that it can have its own ROI, etc., and a region of the overlay to match
+            IplImage wellImage = *frame->image;
+            IplROI wellROI;
+            DebugOverlay wellOverlay = debugOverlay;
+            if (wellCircles.size() > 0) {
+                CvRect boundingSquare = boundingSquareForCircle(wellCircles[i]);
+                setImageHeaderROI(&wellImage, &wellROI, boundingSquare);
+                wellOverlay = debugOverlay.region(boundingSquare);
+            }
+            analyzer.processWell(&wellImage, wellCircles.size() > 0 ? (int)i : -1, wellOverlay, frame->presentationTime, results);
+        };
+
+        size_t iterations = wellCircles.size() > 0 ? wellCircles.size() : 1;      // i.e. wells
+        if (analyzer.canProcessInParallel()) {
+            // Wells aren't split into tiles, as neither analyzer's per-well stages (e.g. Canny's edge tracing, or the
+            // optical flow's pyramids) give the same results when run on bands of a well
+            analyzer.wellWorkDecomposer().run(iterations, maximumConcurrency, 1, [&](size_t unitCount, const auto &runUnit) {
+                parallelLoop(unitCount, std::cref(runUnit));      // a reference, so that the function doesn't allocate
+            }, [&](size_t i, int, int) {
+                processWell(i);
+            });
+        } else {
+            for (size_t i = 0; i < iterations; i++) {
+                processWell(i);
+            }
+        }
+    }
+    {
+        TraceSpan span("end frame", frame->presentationTime);
+        analyzer.didEndFrameProcessing(frame, results);
+    }
+    results.commitFrame();
+}
+
+void analyzePlateFrame(PlateAnalyzer &analyzer,
+                       const AnalysisFrameRef &frame,
+                       const std::vector<Circle> &wellCircles,
+                       unsigned maximumConcurrency,
+                       DebugOverlay &debugOverlay,
+                       PlateResults &results)
+{
+    analyzePlateFrame(analyzer, frame, wellCircles, maximumConcurrency, [maximumConcurrency](size_t iterations, const std::function<void(size_t)> &body) {
+        parallelFor(iterations, maximumConcurrency, body);
+    }, debugOverlay, results);
+}
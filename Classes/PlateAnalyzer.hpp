@@ -0,0 +1,109 @@
+//
+//  PlateAnalyzer.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef PlateAnalyzer_hpp
+#define PlateAnalyzer_hpp
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <opencv2/core/core_c.h>
+#include "WellFinding.hpp"
+#include "WorkDecomposer.hpp"
+
+class DebugOverlay;
+class PlateResults;
+
+// The number of seconds after the plate or lighting last moved that analyzers ignore frames by default
+static const double DefaultIgnoreFramesPostMovementTimeInterval = 2.0;
+
+// A frame as seen by a PlateAnalyzer. The image must not be modified. The owner of the image is kept alive by the
+// frame's deleter (e.g. the VideoFrame it came from), so frames may be retained by analyzers indefinitely.
+struct AnalysisFrame {
+    AnalysisFrame(IplImage *image, double presentationTime) : image(image), presentationTime(presentationTime) {}
+
+    IplImage *image;            // BGRA
+    double presentationTime;
+};
+typedef std::shared_ptr<const AnalysisFrame> AnalysisFrameRef;
+
+// The portable analysis core of an AssayAnalyzer (see AssayAnalyzer.h), so that the same analysis can be run by the
+// VideoProcessor and by the command line analyzer, each with analyzePlateFrame(). Instances are created when a plate
+// begins being tracked, and are only ever called from one thread at a time, except for processWell().
+class PlateAnalyzer {
+public:
+    virtual ~PlateAnalyzer() {}
+
+    // Return true if processWell() can be called for several wells at once on separate threads
+    virtual bool canProcessInParallel() const = 0;
+    virtual void willBeginPlateTracking(PlateResults &results) = 0;
+    // These three are called for each frame, in order. The first is called once per frame to allow any preprocessing or
+    // setup, and can return false if the wells of the frame shouldn't be processed (e.g. poor image quality or movement,
+    // or the whole frame was processed here), in which case didEndFrameProcessing() is still called. debugOverlay covers
+    // the whole frame. maximumConcurrency is the number of cores that the frame's work should be spread over (e.g. the
+    // plate's share, see CoreBudget), for frame level stages as well as for the wells.
+    virtual bool willBeginFrameProcessing(const AnalysisFrameRef &frame, unsigned maximumConcurrency, DebugOverlay &debugOverlay, PlateResults &results) = 0;
+    // Called once for each well. wellImage has its ROI set, and debugOverlay is a region, covering only the well's
+    // bounding square. Well is 0 indexed and in row-major order, or -1 for a non-well plate. The header is unique to the
+    // callee and may be modified, but the underlying data may not. Results must be staged.
+    virtual void processWell(IplImage *wellImage, int well, DebugOverlay &debugOverlay, double presentationTime, PlateResults &results) = 0;
+    // Results staged before this returns are committed atomically afterwards
+    virtual void didEndFrameProcessing(const AnalysisFrameRef &frame, PlateResults &results) = 0;
+    virtual void didEndTrackingPlate(PlateResults & /* results */) {}
+
+    // Minimum for reporting of data
+    virtual double minimumTimeIntervalProcessedToReportData() const = 0;
+    virtual size_t minimumSamplesProcessedToReportData() const = 0;
+
+    // Seeds the analyzer's random sampling, so that analyzing the same frames again gives identical results regardless
+    // of how the wells are scheduled. By default the seed is drawn from random(). Set before tracking begins.
+    void setRandomSeed(uint32_t seed) { _randomSeed = seed; }
+    uint32_t randomSeed() const { return _randomSeed; }
+
+    // Schedules the wells of each frame from their recent costs (see analyzePlateFrame())
+    WorkDecomposer &wellWorkDecomposer() { return _wellWorkDecomposer; }
+
+protected:
+    PlateAnalyzer();
+
+    // A seed for the random choices made for one well of a frame (or -1 for the whole frame), derived from the analyzer's
+    // seed, the frame's presentation time and the well
+    uint32_t randomSeedForFrame(double presentationTime, int well) const;
+
+private:
+    uint32_t _randomSeed;
+    WorkDecomposer _wellWorkDecomposer;
+};
+
+// Calls body(i) for each i in [0, iterations) concurrently, and returns once all have returned, e.g. with parallelFor()
+// or a TaskScheduler lane
+typedef std::function<void(size_t iterations, const std::function<void(size_t)> &body)> PlateParallelLoop;
+
+// Analyzes a tracked frame in a frame transaction on the results, processing the wells in parallel over up to
+// maximumConcurrency cores (e.g. the plate's share, see CoreBudget) with parallelLoop if the analyzer allows it,
+// batching cheap wells with the analyzer's wellWorkDecomposer(). The analyzer's frame level stages are given the same
+// number of cores. wellCircles is empty for a non-well plate.
+void analyzePlateFrame(PlateAnalyzer &analyzer,
+                       const AnalysisFrameRef &frame,
+                       const std::vector<Circle> &wellCircles,
+                       unsigned maximumConcurrency,
+                       const PlateParallelLoop &parallelLoop,
+                       DebugOverlay &debugOverlay,
+                       PlateResults &results);
+
+// As above, running the wells with parallelFor()
+void analyzePlateFrame(PlateAnalyzer &analyzer,
+                       const AnalysisFrameRef &frame,
+                       const std::vector<Circle> &wellCircles,
+                       unsigned maximumConcurrency,
+                       DebugOverlay &debugOverlay,
+                       PlateResults &results);
+
+#endif
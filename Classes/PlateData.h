@@ -7,22 +7,30 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "PlateResults.hpp"      // for ReportingStyle
 
-enum {
-    ReportingStyleNone = 0,
-    ReportingStyleMean = 1 << 1,
-    ReportingStyleStdDev = 1 << 2,
-    ReportingStyleRaw = 1 << 20,
-    ReportingStylePercent = 1 << 21
-};
-typedef int ReportingStyle;
+// Stages of VideoProcessor frame processing that are timed individually
+typedef enum {
+    ProcessingStageTotal,
+    ProcessingStageFlip,
+    ProcessingStageAnalysis,
+    ProcessingStageOverlay,
+    ProcessingStageEndToEnd,        // from capture (the frame's presentation time) to display of its debug frame
+    ProcessingStageCount
+} ProcessingStage;
 
-// Thread-safe
+// Thread-safe. The results themselves are kept by a PlateResults (see PlateResults.hpp), which is shared with the
+// command line analyzer.
 @interface PlateData : NSObject
 
 // Set wellCount to 0 for a non-well plate
 - (id)initWithWellCount:(NSUInteger)wellCount startPresentationTime:(NSTimeInterval)presentationTime;
 
+#ifdef __cplusplus
+// For the portable analyzers (see PlateAnalyzer.hpp). Valid for the lifetime of the receiver.
+- (PlateResults &)results;
+#endif
+
 @property(readonly) NSUInteger wellCount;
 @property(readonly) NSTimeInterval startPresentationTime;
 @property(readonly) NSTimeInterval lastPresentationTime;
@@ -30,17 +38,36 @@ typedef int ReportingStyle;
 // MovementUnits are analyzer dependent arbitrary units. This is the only required data.
 - (void)appendMovementUnit:(double)movementUnit atPresentationTime:(NSTimeInterval)presentationTime forWell:(int)well;
 
-// Adds results to a specific column, creating the column if necessary.
+// Adds results to a specific column, creating the column if necessary. The median and percentiles are estimated with a
+// bounded-memory sketch to within 1% of the exact value. Raw values are only retained if the style includes the mean,
+// standard deviation or raw output (movement units are always retained). Results added before a column's style is
+// first set are all retained, and are added to its sketch then.
 - (void)setReportingStyle:(ReportingStyle)style forDataColumnID:(const char *)columnID;
 - (ReportingStyle)reportingStyleForDataColumnID:(const char *)columnID;
+// The percentiles (NSNumbers in [0, 1]) reported for a column with the percentiles style, if not the default 10th, 25th,
+// 75th and 90th
+- (void)setReportedPercentiles:(NSArray *)percentiles forDataColumnID:(const char *)columnID;
 - (void)appendResult:(double)result toDataColumnID:(const char *)columnID forWell:(int)well;
 
+// Frame transactions. analyzePlateFrame() (see PlateAnalyzer.hpp) begins a frame on the results before the analyzer's
+// willBeginFrameProcessing() and commits it after didEndFrameProcessing(). In between, analyzers stage each well's results without locking, and the whole frame becomes
+// visible to readers at once when it is committed. Each well's staging record must only be written by the single worker
+// processing that well. Column IDs must remain valid until the frame is committed (i.e. use string constants).
+- (void)beginFrameAtPresentationTime:(NSTimeInterval)presentationTime;
+- (void)stageMovementUnit:(double)movementUnit forWell:(int)well;
+- (void)stageResult:(double)result toDataColumnID:(const char *)columnID forWell:(int)well;
+- (void)commitFrame;
+
 // Allows reporting of non-formatted results text to be provided with the results and in the log files. Most MotionAnalyzers are
 // not expected to provide this.
 - (void)appendToAdditionalResultsText:(NSString *)text;
 
 - (BOOL)movementUnitsMean:(double *)mean stdDev:(double *)stddev forWell:(int)well;
 - (BOOL)movementUnitsMean:(double *)mean stdDev:(double *)stddev forWell:(int)well inLastSeconds:(NSTimeInterval)seconds;
+// Computes the windowed statistics for all wells at once. The means and stddevs arrays must have one element per well
+// (or a single element for a non-well plate).
+// Wells without any samples in the window are set to NAN.
+- (void)movementUnitsMeans:(double *)means stdDevs:(double *)stddevs inLastSeconds:(NSTimeInterval)seconds;
 
 // Frame rate statistics are automatically set by the VideoProcessors. MotionAnalyzers should not manipulate these.
 @property(readonly) NSUInteger receivedFrameCount;
@@ -51,8 +78,22 @@ typedef int ReportingStyle;
 - (double)averageFramesPerSecond;
 - (double)droppedFrameProportion;
 
-- (void)addProcessingTime:(NSTimeInterval)processingTime;
+// Processing times are kept in fixed-size histograms. The mean/stddev cover at most the last 300 frames of the total stage.
+// Percentiles are for either the whole run or for the last 300 frames, and are accurate to within 6.25%.
+- (void)addProcessingTime:(NSTimeInterval)processingTime;       // ProcessingStageTotal
+- (void)addProcessingTime:(NSTimeInterval)processingTime forStage:(ProcessingStage)stage;
 - (BOOL)processingTimeMean:(double *)mean stdDev:(double *)stddev inLastFrames:(NSUInteger)lastFrames;
+- (BOOL)processingTimeP50:(double *)p50 p90:(double *)p90 p99:(double *)p99 max:(double *)max
+                 forStage:(ProcessingStage)stage
+                 wholeRun:(BOOL)wholeRun;
+- (NSString *)processingTimeSummary;        // whole-run percentiles for each stage
+
+// The VideoProcessor notes the analysis rate when tracking begins and whenever it changes, i.e. when only every n-th
+// source frame is analyzed (the decimation) because the analysis can't keep up with the source
+- (void)noteAnalysisDecimation:(NSUInteger)decimation
+               sourceFrameRate:(double)sourceFrameRate
+            atPresentationTime:(NSTimeInterval)presentationTime;
+- (NSString *)sampleIntervalSummary;        // the analysis rates and the statistics of the intervals between samples
 
 // Results Output
 - (NSArray *)sortedColumnIDsWithData;
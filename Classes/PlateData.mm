@@ -7,29 +7,27 @@
 //
 
 #import "PlateData.h"
-#import "WellFinding.hpp"
-#import <string>
-#import <map>
+#import "LatencyHistogram.hpp"
+#import <memory>
 
-// Required data column identifiers
-static const char* MovementUnitID = "Movement Units";
-static const char* PresentationTimeID = "Timestamp";
+static NSString *const ReportMovementUnitPercentilesKey = @"ReportMovementUnitPercentiles";
+static NSString *const ReportedMovementUnitPercentilesKey = @"ReportedMovementUnitPercentiles";     // e.g. (0.05, 0.95)
+static NSString *const CompressRawValuesKey = @"CompressRawValues";
 
-static bool meanAndStdDev(const std::vector<double>& vec, double &mean, double &stddev, size_t firstIndex = 0);
-static inline NSString *valueAsString(double value, bool asPercent);
-static inline void appendCSVElement(NSMutableString *output, NSString *element);
+// An analysis rate chosen by the VideoProcessor, from the presentation time it took effect
+struct AnalysisRate {
+    NSTimeInterval presentationTime;
+    NSUInteger decimation;
+    double sourceFrameRate;
+};
 
+// Here for C++ build safety
 @interface PlateData () {
-    NSTimeInterval _startPresentationTime;
-    NSTimeInterval _lastPresentationTime;
-    BOOL _nonWellPlate;
-    std::vector<std::map<std::string, std::vector<double> > > _valuesByWellAndDataColumn;
-    std::map<std::string, ReportingStyle> _reportingStyleByDataColumn;
+    std::unique_ptr<PlateResults> _results;     // thread-safe by itself
     NSUInteger _receivedFrameCount;
     NSUInteger _frameDropCount;
-    NSUInteger _sampleCount;
-    std::vector<double> _processingTimes;
-    NSMutableString *_additionalResultsText;
+    LatencyHistogram _processingTimes[ProcessingStageCount];
+    std::vector<AnalysisRate> _analysisRates;
 }
 
 @end
@@ -37,98 +35,117 @@ static inline void appendCSVElement(NSMutableString *output, NSString *element);
 
 @implementation PlateData
 
-@synthesize startPresentationTime = _startPresentationTime;
-@synthesize lastPresentationTime = _lastPresentationTime;
 @synthesize receivedFrameCount = _receivedFrameCount;
 @synthesize frameDropCount = _frameDropCount;
-@synthesize sampleCount = _sampleCount;
 
 - (id)initWithWellCount:(NSUInteger)wellCount startPresentationTime:(NSTimeInterval)presentationTime
 {
     if ((self = [super init])) {
-        if (wellCount <= 0) {
-            wellCount = 1;
-            _nonWellPlate = YES;
+        NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+        _results.reset(new PlateResults((int)wellCount,
+                                        presentationTime,
+                                        [defaults boolForKey:CompressRawValuesKey],
+                                        [defaults boolForKey:ReportMovementUnitPercentilesKey]));
+        NSArray *percentiles = [defaults arrayForKey:ReportedMovementUnitPercentilesKey];
+        if (percentiles) {
+            [self setReportedPercentiles:percentiles forDataColumnID:PlateResults::MovementUnitID];
         }
-        _startPresentationTime = _lastPresentationTime = presentationTime;
-        _valuesByWellAndDataColumn.resize(wellCount);
-        
-        [self setReportingStyle:(ReportingStyleMean | ReportingStyleStdDev | ReportingStyleRaw) forDataColumnID:MovementUnitID];
     }
     return self;
 }
 
+- (PlateResults &)results
+{
+    return *_results;
+}
+
+- (NSUInteger)wellCount
+{
+    return _results->wellCount();
+}
+
+- (NSTimeInterval)startPresentationTime
+{
+    return _results->startPresentationTime();
+}
+
+- (NSTimeInterval)lastPresentationTime
+{
+    return _results->lastPresentationTime();
+}
+
+- (NSUInteger)sampleCount
+{
+    return _results->sampleCount();
+}
+
 - (void)appendMovementUnit:(double)movementUnit atPresentationTime:(NSTimeInterval)presentationTime forWell:(int)well
 {
-    @synchronized(self) {
-        NSAssert(presentationTime >= _lastPresentationTime, @"out of order presentation times");
-        if (_lastPresentationTime != presentationTime) {
-            _sampleCount++;
-            _lastPresentationTime = presentationTime;
-        }
-        if (well == -1) {
-            well = 0;
-        }
-        [self appendResult:movementUnit toDataColumnID:MovementUnitID forWell:well];
-        [self appendResult:presentationTime toDataColumnID:PresentationTimeID forWell:well];
-    }
+    _results->appendMovementUnit(movementUnit, presentationTime, well);
 }
 
 - (void)setReportingStyle:(ReportingStyle)style forDataColumnID:(const char *)columnID
 {
-    @synchronized(self) {
-        _reportingStyleByDataColumn[std::string(columnID)] = style;
-    }
+    _results->setReportingStyle(style, columnID);
 }
 
 - (ReportingStyle)reportingStyleForDataColumnID:(const char *)columnID
 {
-    @synchronized(self) {
-        return _reportingStyleByDataColumn[std::string(columnID)];
+    return _results->reportingStyle(columnID);
+}
+
+- (void)setReportedPercentiles:(NSArray *)percentiles forDataColumnID:(const char *)columnID
+{
+    std::vector<double> values;
+    for (NSNumber *percentile in percentiles) {
+        values.push_back([percentile doubleValue]);
     }
+    _results->setReportedPercentiles(values, columnID);
 }
 
 - (void)appendResult:(double)result toDataColumnID:(const char *)columnID forWell:(int)well
 {
-    @synchronized(self) {
-        if (well == -1) {
-            well = 0;
-        }
-        _valuesByWellAndDataColumn[well][std::string(columnID)].push_back(result);
-    }
+    _results->appendResult(result, columnID, well);
+}
+
+- (void)beginFrameAtPresentationTime:(NSTimeInterval)presentationTime
+{
+    _results->beginFrame(presentationTime);
+}
+
+- (void)stageMovementUnit:(double)movementUnit forWell:(int)well
+{
+    _results->stageMovementUnit(movementUnit, well);
+}
+
+- (void)stageResult:(double)result toDataColumnID:(const char *)columnID forWell:(int)well
+{
+    _results->stageResult(result, columnID, well);
+}
+
+- (void)commitFrame
+{
+    _results->commitFrame();
 }
 
 - (void)appendToAdditionalResultsText:(NSString *)text
 {
-    @synchronized(self) {
-        if (!_additionalResultsText) {
-            _additionalResultsText = [[NSMutableString alloc] init];
-        }
-        [_additionalResultsText appendString:text];
-    }
+    _results->appendToAdditionalResultsText([text UTF8String]);
 }
 
 - (BOOL)movementUnitsMean:(double *)mean stdDev:(double *)stddev forWell:(int)well
 {
-    @synchronized(self) {
-        if (well == -1) {
-            well = 0;
-        }
-        return meanAndStdDev(_valuesByWellAndDataColumn[well][std::string(MovementUnitID)], *mean, *stddev);
-    }
+    return _results->movementUnitsMeanAndStdDev(well, *mean, *stddev);
 }
 
 - (BOOL)movementUnitsMean:(double *)mean stdDev:(double *)stddev forWell:(int)well inLastSeconds:(NSTimeInterval)seconds
 {
-    @synchronized(self) {
-        if (well == -1) {
-            well = 0;
-        }
-        NSTimeInterval time = [self lastPresentationTime] - seconds;
-        std::vector<double>* presentationTimes = &_valuesByWellAndDataColumn[well][std::string(PresentationTimeID)];
-        size_t index = std::lower_bound(presentationTimes->begin(), presentationTimes->end(), time) - presentationTimes->begin();
-        return meanAndStdDev(_valuesByWellAndDataColumn[well][std::string(MovementUnitID)], *mean, *stddev, index);
-    }
+    return _results->movementUnitsMeanAndStdDevInLastSeconds(well, seconds, *mean, *stddev);
+}
+
+- (void)movementUnitsMeans:(double *)means stdDevs:(double *)stddevs inLastSeconds:(NSTimeInterval)seconds
+{
+    _results->movementUnitsMeansAndStdDevs(seconds, means, stddevs);
 }
 
 - (void)incrementReceivedFrameCount
@@ -156,209 +173,135 @@ static inline void appendCSVElement(NSMutableString *output, NSString *element);
 }
 
 - (void)addProcessingTime:(NSTimeInterval)processingTime
+{
+    [self addProcessingTime:processingTime forStage:ProcessingStageTotal];
+}
+
+- (void)addProcessingTime:(NSTimeInterval)processingTime forStage:(ProcessingStage)stage
 {
     @synchronized(self) {
-        _processingTimes.push_back(processingTime);
+        _processingTimes[stage].addSample(processingTime);
     }
 }
 
 - (BOOL)processingTimeMean:(double *)mean stdDev:(double *)stddev inLastFrames:(NSUInteger)lastFrames
 {
     @synchronized(self) {
-        NSUInteger firstIndex = 0;
-        if (_processingTimes.size() > lastFrames) {
-            firstIndex = _processingTimes.size() - lastFrames;
-        }
-        return meanAndStdDev(_processingTimes, *mean, *stddev, firstIndex);
+        return _processingTimes[ProcessingStageTotal].recentMeanAndStdDev((int)MIN(lastFrames, (NSUInteger)INT_MAX), *mean, *stddev);
     }
 }
 
-static bool meanAndStdDev(const std::vector<double>& vec, double &mean, double &stddev, NSUInteger firstIndex)
+- (BOOL)processingTimeP50:(double *)p50 p90:(double *)p90 p99:(double *)p99 max:(double *)max
+                 forStage:(ProcessingStage)stage
+                 wholeRun:(BOOL)wholeRun
 {
-    NSInteger numSamples = vec.size() - firstIndex;
-    double sum = 0.0;
-    for (size_t i = firstIndex; i < vec.size(); i++) {
-        sum += vec[i];
+    @synchronized(self) {
+        const LatencyHistogram &histogram = _processingTimes[stage];
+        *p50 = histogram.percentile(0.50, wholeRun);
+        *p90 = histogram.percentile(0.90, wholeRun);
+        *p99 = histogram.percentile(0.99, wholeRun);
+        *max = histogram.maximum(wholeRun);
+        return histogram.sampleCount(wholeRun) > 0;
     }
-    mean = sum / numSamples;
+}
+
+- (NSString *)processingTimeSummary
+{
+    static NSString *const stageNames[ProcessingStageCount] = { @"Total", @"Flip", @"Analysis", @"Overlay", @"End-to-end" };
     
-    double variance = 0.0;
-    for (size_t i = firstIndex; i < vec.size(); i++) {
-        double difference = vec[i] - mean;
-        variance += difference * difference;
+    NSMutableString *summary = [NSMutableString stringWithString:@"Processing time (ms) p50/p90/p99/max:"];
+    for (int stage = 0; stage < ProcessingStageCount; stage++) {
+        double p50, p90, p99, max;
+        if ([self processingTimeP50:&p50 p90:&p90 p99:&p99 max:&max forStage:(ProcessingStage)stage wholeRun:YES]) {
+            [summary appendFormat:@" %@ %.1f/%.1f/%.1f/%.1f;", stageNames[stage], p50 * 1000, p90 * 1000, p99 * 1000, max * 1000];
+        }
     }
-    variance /= numSamples;
-    stddev = sqrt(variance);
-    return numSamples > 0;
+    return summary;
 }
 
-- (NSArray *)sortedColumnIDsWithData
+- (void)noteAnalysisDecimation:(NSUInteger)decimation
+               sourceFrameRate:(double)sourceFrameRate
+            atPresentationTime:(NSTimeInterval)presentationTime
 {
     @synchronized(self) {
-        NSMutableArray *columnIDs = [NSMutableArray arrayWithCapacity:_valuesByWellAndDataColumn.size()];
-        for (std::map<std::string, std::vector<double> >::iterator it = _valuesByWellAndDataColumn[0].begin(); it != _valuesByWellAndDataColumn[0].end(); it++) {
-            NSString *columnID = [[NSString alloc] initWithUTF8String:(it->first).c_str()];
-            [columnIDs addObject:columnID];
-        }
-        [columnIDs sortUsingSelector:@selector(caseInsensitiveCompare:)];
-        return columnIDs;
+        AnalysisRate rate = { presentationTime, decimation, sourceFrameRate };
+        _analysisRates.push_back(rate);
     }
 }
 
-- (NSString *)csvOutputForPlateID:(NSString *)plateID
-                           scanID:(NSString *)scanID
-      withAdditionalRawDataOutput:(NSMutableDictionary *)rawColumnIDsToCSVStrings
-                     analyzerName:(NSString *)analyzerName
-                 columnMajorOrder:(BOOL)columnMajorOrder
+- (NSString *)sampleIntervalSummary
 {
     @synchronized(self) {
-        NSMutableString *output = [NSMutableString string];
-        
-        // Write header row
-        appendCSVElement(output, @"Plate and Well");
-        appendCSVElement(output, @"Scan ID");
-        appendCSVElement(output, @"Well");
-        appendCSVElement(output, @"Assay Date/Time");
-        
-        NSArray *dataColumnIDs = [self sortedColumnIDsWithData];
-        for (NSString *columnID in dataColumnIDs) {
-            std::string columnIDStdStr = std::string([columnID UTF8String]);
-            
-            ReportingStyle style = _reportingStyleByDataColumn[columnIDStdStr];
-            if (style & ReportingStyleMean) {
-                appendCSVElement(output, [columnID stringByAppendingString:@" - Mean"]);
-            }
-            if (style & ReportingStyleStdDev) {
-                appendCSVElement(output, [columnID stringByAppendingString:@" - Std. Dev."]);
-            }
+        NSMutableString *summary = [NSMutableString stringWithString:@"Analysis rate:"];
+        for (size_t i = 0; i < _analysisRates.size(); i++) {
+            const AnalysisRate &rate = _analysisRates[i];
+            [summary appendFormat:@" every %lu of %.2f fps (%.2f fps) from %.1f s;",
+             (unsigned long)rate.decimation, rate.sourceFrameRate, rate.sourceFrameRate / rate.decimation,
+             MAX(rate.presentationTime - [self startPresentationTime], 0.0)];
         }
         
-        NSTimeInterval elapsedTime = [self lastPresentationTime] - [self startPresentationTime];
-        appendCSVElement(output, [NSString stringWithFormat:@"Elapsed time: %lu:%lu", (long)floor(elapsedTime / 60), lrint(fmod(elapsedTime, 60))]);
-        appendCSVElement(output, [NSString stringWithFormat:@"Assay: %@, version %@",
-                                  [analyzerName stringByReplacingOccurrencesOfString:@"—" withString:@"-"],
-                                  [[NSBundle mainBundle] objectForInfoDictionaryKey:(id)kCFBundleVersionKey]]);
-        [output appendString:@"\n"];
-        
-        // Get the assay date/time
-        NSDateFormatter *dateFormatter = [[NSDateFormatter alloc] init];
-        [dateFormatter setDateStyle:NSDateFormatterFullStyle];
-        [dateFormatter setTimeStyle:NSDateFormatterFullStyle];
-        NSString *assayDateTime = [dateFormatter stringFromDate:[NSDate dateWithTimeIntervalSinceNow:-elapsedTime]];
-        
-        // Write stats for each well
-        for (int i = 0; i < (int)_valuesByWellAndDataColumn.size(); i++) {
-            int well;
-            if (columnMajorOrder) {
-                int rows, columns;
-                getPlateConfigurationForWellCount((int)_valuesByWellAndDataColumn.size(), rows, columns);
-                well = (i % rows) * columns + i / rows;
-            } else {
-                well = i;
-            }
-            
-            @autoreleasepool {
-                // Output the plate-well ID
-                NSString *wellIDString;
-                NSString *plateAndWellID;
-                if (_nonWellPlate) {
-                    wellIDString = @"entire plate";
-                    plateAndWellID = [NSString stringWithFormat:@"%@ %@", plateID, wellIDString];
-                } else {
-                    std::string wellID = wellIdentifierStringForIndex(well, (int)_valuesByWellAndDataColumn.size());
-                    wellIDString = [NSString stringWithUTF8String:wellID.c_str()];
-                    plateAndWellID = [NSString stringWithFormat:@"%@ Well %@", plateID, wellIDString];
-                }
-                appendCSVElement(output, plateAndWellID);
-                
-                // Output the scan ID and well by themselves
-                appendCSVElement(output, scanID);
-                appendCSVElement(output, wellIDString);
-                
-                // Output the assay date/time
-                appendCSVElement(output, assayDateTime);
-                
-                for (NSString *columnID in dataColumnIDs) {
-                    @autoreleasepool {
-                        std::string columnIDStdStr = std::string([columnID UTF8String]);
-                        
-                        ReportingStyle style = _reportingStyleByDataColumn[columnIDStdStr];
-                        if ((style & ReportingStyleMean) || (style & ReportingStyleStdDev)) {
-                            double mean, stddev;
-                            meanAndStdDev(_valuesByWellAndDataColumn[well][columnIDStdStr], mean, stddev);
-                            if (style & ReportingStyleMean) {
-                                appendCSVElement(output, valueAsString(mean, style & ReportingStylePercent));
-                            }
-                            if (style & ReportingStyleStdDev) {
-                                appendCSVElement(output, valueAsString(stddev, style & ReportingStylePercent));
-                            }
-                        }
-                        
-                        // Append all raw values on a line, preceeded by the plate-well id
-                        if (style & ReportingStyleRaw) {
-                            // Get the string for this column ID if we've already started one
-                            NSMutableString *rawLine = [rawColumnIDsToCSVStrings objectForKey:columnID];
-                            if (!rawLine) {
-                                rawLine = [NSMutableString string];
-                                [rawColumnIDsToCSVStrings setObject:rawLine forKey:columnID];
-                                
-                                // Write out the header row with labels and times
-                                appendCSVElement(rawLine, @"Plate and Well");
-                                appendCSVElement(rawLine, @"Scan ID");
-                                appendCSVElement(rawLine, @"Well/Times");
-                                const std::vector<double>* rawTimes = &_valuesByWellAndDataColumn[well][std::string(PresentationTimeID)];
-                                for (size_t i = 0; i < rawTimes->size(); i++) {
-                                    @autoreleasepool {
-                                        appendCSVElement(rawLine, [NSString stringWithFormat:@"%.3f", rawTimes->at(i)]);
-                                    }
-                                }
-                                [rawLine appendString:@"\n"];
-                            }
-                            
-                            appendCSVElement(rawLine, plateAndWellID);
-                            appendCSVElement(rawLine, scanID);
-                            appendCSVElement(rawLine, wellIDString);
-                            const std::vector<double>* rawValues = &_valuesByWellAndDataColumn[well][columnIDStdStr];
-                            for (size_t i = 0; i < rawValues->size(); i++) {
-                                @autoreleasepool {
-                                    appendCSVElement(rawLine, valueAsString(rawValues->at(i), style & ReportingStylePercent));
-                                }
-                            }
-                            [rawLine appendString:@"\n"];
-                        }
-                        
-                    }
-                }
-                [output appendString:@"\n"];
+        // Summarize the effective intervals between the frames that were actually sampled
+        std::vector<double> framePresentationTimes = _results->framePresentationTimes();
+        size_t intervals = framePresentationTimes.size() > 1 ? framePresentationTimes.size() - 1 : 0;
+        if (intervals > 0) {
+            double sum = 0.0, sumOfSquares = 0.0, max = 0.0;
+            for (size_t i = 0; i < intervals; i++) {
+                double interval = framePresentationTimes[i + 1] - framePresentationTimes[i];
+                sum += interval;
+                sumOfSquares += interval * interval;
+                max = MAX(max, interval);
             }
+            double mean = sum / intervals;
+            double stddev = sqrt(MAX(sumOfSquares / intervals - mean * mean, 0.0));
+            [summary appendFormat:@" sample interval (ms) mean %.1f, SD %.1f, max %.1f", mean * 1000, stddev * 1000, max * 1000];
         }
-        [output appendString:@"\n"];
-        
-        // Append the additional information from the analyzer or the video processor
-        if (_additionalResultsText) {
-            [output appendString:@"\n"];
-            appendCSVElement(output, _additionalResultsText);
-            [output appendString:@"\n"];
-        }
-        
-        return output;
+        return summary;
     }
 }
 
-static inline NSString *valueAsString(double value, bool asPercent)
+- (NSArray *)sortedColumnIDsWithData
 {
-    return asPercent ? [NSString stringWithFormat:@"%.4g%%", value * 100.0] : [NSString stringWithFormat:@"%.4g", value];
+    std::vector<std::string> columnIDs = _results->sortedColumnIDsWithData();
+    NSMutableArray *array = [NSMutableArray arrayWithCapacity:columnIDs.size()];
+    for (size_t i = 0; i < columnIDs.size(); i++) {
+        [array addObject:[NSString stringWithUTF8String:columnIDs[i].c_str()]];
+    }
+    return array;
 }
 
-static inline void appendCSVElement(NSMutableString *output, NSString *element)
+- (NSString *)csvOutputForPlateID:(NSString *)plateID
+                           scanID:(NSString *)scanID
+      withAdditionalRawDataOutput:(NSMutableDictionary *)rawColumnIDsToCSVStrings
+                     analyzerName:(NSString *)analyzerName
+                 columnMajorOrder:(BOOL)columnMajorOrder
 {
-    if ([element rangeOfString:@","].length > 0 || [element rangeOfString:@"\""].length > 0) {
-        element = [element stringByReplacingOccurrencesOfString:@"\"" withString:@"\"\""];
-        element = [NSString stringWithFormat:@"\"%@\"", element];
+    // Get the assay date/time
+    NSTimeInterval elapsedTime = [self lastPresentationTime] - [self startPresentationTime];
+    NSDateFormatter *dateFormatter = [[NSDateFormatter alloc] init];
+    [dateFormatter setDateStyle:NSDateFormatterFullStyle];
+    [dateFormatter setTimeStyle:NSDateFormatterFullStyle];
+    NSString *assayDateTime = [dateFormatter stringFromDate:[NSDate dateWithTimeIntervalSinceNow:-elapsedTime]];
+    NSString *version = [[NSBundle mainBundle] objectForInfoDictionaryKey:(id)kCFBundleVersionKey];
+    
+    // Continue any raw output strings already started by the caller
+    std::map<std::string, std::string> rawCSVStrings;
+    for (NSString *columnID in rawColumnIDsToCSVStrings) {
+        rawCSVStrings[[columnID UTF8String]] = [[rawColumnIDsToCSVStrings objectForKey:columnID] UTF8String];
     }
     
-    [output appendString:element];
-    [output appendString:@","];
+    std::string output = _results->csvOutput([plateID UTF8String],
+                                             [scanID UTF8String],
+                                             [assayDateTime UTF8String],
+                                             [analyzerName UTF8String],
+                                             [version UTF8String],
+                                             columnMajorOrder,
+                                             rawCSVStrings);
+    
+    for (std::map<std::string, std::string>::iterator it = rawCSVStrings.begin(); it != rawCSVStrings.end(); it++) {
+        [rawColumnIDsToCSVStrings setObject:[NSMutableString stringWithUTF8String:it->second.c_str()]
+                                     forKey:[NSString stringWithUTF8String:it->first.c_str()]];
+    }
+    return [NSString stringWithUTF8String:output.c_str()];
 }
 
 @end
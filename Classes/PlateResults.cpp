@@ -0,0 +1,553 @@
+//
+//  PlateResults.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#include "PlateResults.hpp"
+#include "WellFinding.hpp"
+#include <assert.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+
+// Required data column identifiers
+const char *const PlateResults::MovementUnitID = "Movement Units";
+
+static const double DefaultPercentiles[] = { 0.10, 0.25, 0.75, 0.90 };
+
+// Movement unit samples are indexed by plate frame number. Wells that were not sampled in a given frame store this value.
+static const double SkippedFrameValue = NAN;
+
+static bool meanAndStdDev(const SampleSeries& series, double &mean, double &stddev, size_t firstIndex = 0);
+static bool caseInsensitiveLessThan(const std::string &a, const std::string &b);
+static std::string valueAsString(double value, bool asPercent);
+static std::string percentileName(double percentile);
+static void appendCSVElement(std::string &output, const std::string &element);
+
+PlateResults::PlateResults(int wellCount, double startPresentationTime, bool compressRawValues, bool reportMovementUnitPercentiles)
+    : _startPresentationTime(startPresentationTime), _lastPresentationTime(startPresentationTime), _nonWellPlate(false),
+      _compressRawValues(compressRawValues), _stagedFramePresentationTime(startPresentationTime)
+{
+    if (wellCount <= 0) {
+        wellCount = 1;
+        _nonWellPlate = true;
+    }
+    _valuesByWellAndDataColumn.resize(wellCount);
+    _sketchesByWellAndDataColumn.resize(wellCount);
+    _stagedWellResults.resize(wellCount);
+
+    ReportingStyle movementUnitStyle = ReportingStyleMean | ReportingStyleStdDev | ReportingStyleRaw;
+    if (reportMovementUnitPercentiles) {
+        movementUnitStyle |= ReportingStyleMedian | ReportingStylePercentiles;
+    }
+    setReportingStyle(movementUnitStyle, MovementUnitID);
+}
+
+int PlateResults::wellCount() const
+{
+    return _nonWellPlate ? 0 : (int)_valuesByWellAndDataColumn.size();
+}
+
+double PlateResults::startPresentationTime() const
+{
+    return _startPresentationTime;
+}
+
+double PlateResults::lastPresentationTime() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _lastPresentationTime;
+}
+
+size_t PlateResults::sampleCount() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _framePresentationTimes.size();
+}
+
+std::vector<double> PlateResults::framePresentationTimes() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _framePresentationTimes;
+}
+
+void PlateResults::appendMovementUnit(double movementUnit, double presentationTime, int well)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    appendMovementUnitLocked(movementUnit, presentationTime, well == -1 ? 0 : well);
+}
+
+void PlateResults::appendMovementUnitLocked(double movementUnit, double presentationTime, int well)
+{
+    assert(presentationTime >= _lastPresentationTime);     // out of order presentation times
+    // The first well to report for a frame adds it to the plate's time axis
+    if (_framePresentationTimes.empty() || _framePresentationTimes.back() != presentationTime) {
+        _framePresentationTimes.push_back(presentationTime);
+        _lastPresentationTime = presentationTime;
+    }
+
+    // Mark any frames that this well skipped so that its sample indices remain frame numbers
+    std::string columnID(MovementUnitID);
+    SampleSeries &movementUnits = seriesLocked(columnID, well);
+    size_t frameIndex = _framePresentationTimes.size() - 1;
+    assert(movementUnits.size() <= frameIndex);     // multiple movement units for one well in a frame
+    movementUnits.resize(frameIndex, SkippedFrameValue);
+    movementUnits.push_back(movementUnit);
+
+    if (_reportingStyleByDataColumn[columnID] & (ReportingStyleMedian | ReportingStylePercentiles)) {
+        _sketchesByWellAndDataColumn[well][columnID].add(movementUnit);
+    }
+}
+
+void PlateResults::appendResultLocked(double result, const std::string &columnID, int well)
+{
+    // Always create the column so that it is reported
+    SampleSeries &values = seriesLocked(columnID, well);
+    std::map<std::string, ReportingStyle>::const_iterator styleIt = _reportingStyleByDataColumn.find(columnID);
+    if (styleIt == _reportingStyleByDataColumn.end()) {
+        // Keep the result until the style is known (see setReportingStyle())
+        values.push_back(result);
+        return;
+    }
+    ReportingStyle style = styleIt->second;
+    if (style & (ReportingStyleMean | ReportingStyleStdDev | ReportingStyleRaw)) {
+        values.push_back(result);
+    }
+    if (style & (ReportingStyleMedian | ReportingStylePercentiles)) {
+        _sketchesByWellAndDataColumn[well][columnID].add(result);
+    }
+}
+
+SampleSeries &PlateResults::seriesLocked(const std::string &columnID, int well)
+{
+    std::map<std::string, SampleSeries> &columns = _valuesByWellAndDataColumn[well];
+    std::map<std::string, SampleSeries>::iterator it = columns.find(columnID);
+    if (it == columns.end()) {
+        it = columns.insert(std::make_pair(columnID, SampleSeries(_compressRawValues))).first;
+    }
+    return it->second;
+}
+
+void PlateResults::setReportingStyle(ReportingStyle style, const char *columnID)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::string column(columnID);
+    bool styleWasSet = _reportingStyleByDataColumn.count(column) > 0;
+    _reportingStyleByDataColumn[column] = style;
+    if (styleWasSet || column == MovementUnitID) {
+        return;
+    }
+
+    // Any results added before the style was set were retained, so estimate their quantiles, and release them if
+    // they aren't otherwise needed
+    for (size_t well = 0; well < _valuesByWellAndDataColumn.size(); well++) {
+        std::map<std::string, SampleSeries>::iterator it = _valuesByWellAndDataColumn[well].find(column);
+        if (it == _valuesByWellAndDataColumn[well].end()) {
+            continue;
+        }
+        if (style & (ReportingStyleMedian | ReportingStylePercentiles)) {
+            QuantileSketch &sketch = _sketchesByWellAndDataColumn[well][column];
+            for (SampleSeries::const_iterator value = it->second.begin(); value != it->second.end(); ++value) {
+                sketch.add(*value);
+            }
+        }
+        if (!(style & (ReportingStyleMean | ReportingStyleStdDev | ReportingStyleRaw))) {
+            it->second = SampleSeries(_compressRawValues);
+        }
+    }
+}
+
+ReportingStyle PlateResults::reportingStyle(const char *columnID) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::map<std::string, ReportingStyle>::const_iterator it = _reportingStyleByDataColumn.find(std::string(columnID));
+    return it != _reportingStyleByDataColumn.end() ? it->second : ReportingStyleNone;
+}
+
+std::vector<double> PlateResults::DefaultReportedPercentiles()
+{
+    return std::vector<double>(DefaultPercentiles, DefaultPercentiles + sizeof(DefaultPercentiles) / sizeof(*DefaultPercentiles));
+}
+
+void PlateResults::setReportedPercentiles(const std::vector<double> &percentiles, const char *columnID)
+{
+    for (size_t i = 0; i < percentiles.size(); i++) {
+        assert(percentiles[i] >= 0.0 && percentiles[i] <= 1.0);
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    _reportedPercentilesByDataColumn[std::string(columnID)] = percentiles;
+}
+
+std::vector<double> PlateResults::reportedPercentiles(const char *columnID) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::map<std::string, std::vector<double> >::const_iterator it = _reportedPercentilesByDataColumn.find(std::string(columnID));
+    return it != _reportedPercentilesByDataColumn.end() ? it->second : DefaultReportedPercentiles();
+}
+
+void PlateResults::appendResult(double result, const char *columnID, int well)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    appendResultLocked(result, std::string(columnID), well == -1 ? 0 : well);
+}
+
+void PlateResults::beginFrame(double presentationTime)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stagedFramePresentationTime = presentationTime;
+}
+
+void PlateResults::stageMovementUnit(double movementUnit, int well)
+{
+    StagedWellResults &staged = _stagedWellResults[well == -1 ? 0 : well];
+    assert(!staged.hasMovementUnit);        // multiple movement units for one well in a frame
+    staged.hasMovementUnit = true;
+    staged.movementUnit = movementUnit;
+}
+
+void PlateResults::stageResult(double result, const char *columnID, int well)
+{
+    _stagedWellResults[well == -1 ? 0 : well].results.push_back(std::make_pair(columnID, result));
+}
+
+void PlateResults::commitFrame()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (size_t well = 0; well < _stagedWellResults.size(); well++) {
+        StagedWellResults &staged = _stagedWellResults[well];
+        if (staged.hasMovementUnit) {
+            appendMovementUnitLocked(staged.movementUnit, _stagedFramePresentationTime, (int)well);
+            staged.hasMovementUnit = false;
+        }
+        for (size_t i = 0; i < staged.results.size(); i++) {
+            appendResultLocked(staged.results[i].second, std::string(staged.results[i].first), (int)well);
+        }
+        staged.results.clear();     // retains its capacity for the next frame
+    }
+}
+
+void PlateResults::appendToAdditionalResultsText(const std::string &text)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _additionalResultsText += text;
+}
+
+bool PlateResults::movementUnitsMeanAndStdDev(int well, double &mean, double &stddev) const
+{
+    return movementUnitsMeanAndStdDevInLastSeconds(well, INFINITY, mean, stddev);
+}
+
+bool PlateResults::movementUnitsMeanAndStdDevInLastSeconds(int well, double seconds, double &mean, double &stddev) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const std::map<std::string, SampleSeries> &columns = _valuesByWellAndDataColumn[well == -1 ? 0 : well];
+    std::map<std::string, SampleSeries>::const_iterator it = columns.find(MovementUnitID);
+    return it != columns.end() && meanAndStdDev(it->second, mean, stddev, firstFrameIndexInLastSecondsLocked(seconds));
+}
+
+void PlateResults::movementUnitsMeansAndStdDevs(double seconds, double *means, double *stddevs) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    // All wells share the plate's time axis, so the window only needs to be located once
+    size_t firstFrame = firstFrameIndexInLastSecondsLocked(seconds);
+    for (size_t i = 0; i < _valuesByWellAndDataColumn.size(); i++) {
+        std::map<std::string, SampleSeries>::const_iterator it = _valuesByWellAndDataColumn[i].find(MovementUnitID);
+        if (it == _valuesByWellAndDataColumn[i].end() || !meanAndStdDev(it->second, means[i], stddevs[i], firstFrame)) {
+            means[i] = stddevs[i] = NAN;
+        }
+    }
+}
+
+size_t PlateResults::firstFrameIndexInLastSecondsLocked(double seconds) const
+{
+    double time = _lastPresentationTime - seconds;
+    return std::lower_bound(_framePresentationTimes.begin(), _framePresentationTimes.end(), time) - _framePresentationTimes.begin();
+}
+
+// Samples for skipped frames are excluded
+static bool meanAndStdDev(const SampleSeries& series, double &mean, double &stddev, size_t firstIndex)
+{
+    long numSamples = 0;
+    double sum = 0.0;
+    for (SampleSeries::const_iterator it = series.iteratorAt(firstIndex); it != series.end(); ++it) {
+        if (!isnan(*it)) {
+            sum += *it;
+            numSamples++;
+        }
+    }
+    mean = sum / numSamples;
+
+    double variance = 0.0;
+    for (SampleSeries::const_iterator it = series.iteratorAt(firstIndex); it != series.end(); ++it) {
+        if (!isnan(*it)) {
+            double difference = *it - mean;
+            variance += difference * difference;
+        }
+    }
+    variance /= numSamples;
+    stddev = sqrt(variance);
+    return numSamples > 0;
+}
+
+std::vector<std::string> PlateResults::sortedColumnIDsWithData() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return sortedColumnIDsWithDataLocked();
+}
+
+std::vector<double> PlateResults::values(const std::string &columnID, int well) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<double> values;
+    const std::map<std::string, SampleSeries> &columns = _valuesByWellAndDataColumn[well == -1 ? 0 : well];
+    std::map<std::string, SampleSeries>::const_iterator it = columns.find(columnID);
+    if (it != columns.end()) {
+        values.reserve(it->second.size());
+        for (SampleSeries::const_iterator value = it->second.begin(); value != it->second.end(); ++value) {
+            values.push_back(*value);
+        }
+    }
+    return values;
+}
+
+std::vector<std::string> PlateResults::sortedColumnIDsWithDataLocked() const
+{
+    std::vector<std::string> columnIDs;
+    columnIDs.reserve(_valuesByWellAndDataColumn[0].size());
+    for (std::map<std::string, SampleSeries>::const_iterator it = _valuesByWellAndDataColumn[0].begin(); it != _valuesByWellAndDataColumn[0].end(); it++) {
+        columnIDs.push_back(it->first);
+    }
+    std::stable_sort(columnIDs.begin(), columnIDs.end(), caseInsensitiveLessThan);
+    return columnIDs;
+}
+
+std::string PlateResults::csvOutput(const std::string &plateID,
+                                    const std::string &scanID,
+                                    const std::string &assayDateTime,
+                                    const std::string &analyzerName,
+                                    const std::string &version,
+                                    bool columnMajorOrder,
+                                    std::map<std::string, std::string> &rawColumnIDsToCSVStrings) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::string output;
+
+    // Write header row
+    appendCSVElement(output, "Plate and Well");
+    appendCSVElement(output, "Scan ID");
+    appendCSVElement(output, "Well");
+    appendCSVElement(output, "Assay Date/Time");
+
+    static const SampleSeries emptySeries;
+    static const QuantileSketch emptySketch;
+    static const std::vector<double> defaultPercentiles = DefaultReportedPercentiles();
+    std::vector<std::string> dataColumnIDs = sortedColumnIDsWithDataLocked();
+    for (size_t c = 0; c < dataColumnIDs.size(); c++) {
+        const std::string &columnID = dataColumnIDs[c];
+        std::map<std::string, ReportingStyle>::const_iterator styleIt = _reportingStyleByDataColumn.find(columnID);
+        ReportingStyle style = styleIt != _reportingStyleByDataColumn.end() ? styleIt->second : ReportingStyleNone;
+        if (style & ReportingStyleMean) {
+            appendCSVElement(output, columnID + " - Mean");
+        }
+        if (style & ReportingStyleStdDev) {
+            appendCSVElement(output, columnID + " - Std. Dev.");
+        }
+        if (style & ReportingStyleMedian) {
+            appendCSVElement(output, columnID + " - Median");
+        }
+        if (style & ReportingStylePercentiles) {
+            std::map<std::string, std::vector<double> >::const_iterator percentilesIt = _reportedPercentilesByDataColumn.find(columnID);
+            const std::vector<double> &percentiles = percentilesIt != _reportedPercentilesByDataColumn.end() ? percentilesIt->second : defaultPercentiles;
+            for (size_t i = 0; i < percentiles.size(); i++) {
+                appendCSVElement(output, columnID + " - " + percentileName(percentiles[i]) + " Percentile");
+            }
+        }
+    }
+
+    char buffer[64];
+    double elapsedTime = _lastPresentationTime - _startPresentationTime;
+    snprintf(buffer, sizeof(buffer), "Elapsed time: %ld:%ld", (long)floor(elapsedTime / 60), lrint(fmod(elapsedTime, 60)));
+    appendCSVElement(output, buffer);
+    // Em dashes are replaced for the benefit of spreadsheet applications that don't read UTF-8
+    std::string asciiAnalyzerName = analyzerName;
+    static const std::string emDash("\xE2\x80\x94");
+    for (size_t position = asciiAnalyzerName.find(emDash); position != std::string::npos; position = asciiAnalyzerName.find(emDash, position)) {
+        asciiAnalyzerName.replace(position, emDash.size(), "-");
+    }
+    appendCSVElement(output, "Assay: " + asciiAnalyzerName + ", version " + version);
+    output += "\n";
+
+    // Write stats for each well
+    for (int i = 0; i < (int)_valuesByWellAndDataColumn.size(); i++) {
+        int well;
+        if (columnMajorOrder) {
+            int rows, columns;
+            getPlateConfigurationForWellCount((int)_valuesByWellAndDataColumn.size(), rows, columns);
+            well = (i % rows) * columns + i / rows;
+        } else {
+            well = i;
+        }
+
+        // Output the plate-well ID
+        std::string wellIDString;
+        std::string plateAndWellID;
+        if (_nonWellPlate) {
+            wellIDString = "entire plate";
+            plateAndWellID = plateID + " " + wellIDString;
+        } else {
+            wellIDString = wellIdentifierStringForIndex(well, (int)_valuesByWellAndDataColumn.size());
+            plateAndWellID = plateID + " Well " + wellIDString;
+        }
+        appendCSVElement(output, plateAndWellID);
+
+        // Output the scan ID and well by themselves
+        appendCSVElement(output, scanID);
+        appendCSVElement(output, wellIDString);
+
+        // Output the assay date/time
+        appendCSVElement(output, assayDateTime);
+
+        const std::map<std::string, SampleSeries> &wellValues = _valuesByWellAndDataColumn[well];
+        const std::map<std::string, QuantileSketch> &wellSketches = _sketchesByWellAndDataColumn[well];
+        for (size_t c = 0; c < dataColumnIDs.size(); c++) {
+            const std::string &columnID = dataColumnIDs[c];
+            std::map<std::string, ReportingStyle>::const_iterator styleIt = _reportingStyleByDataColumn.find(columnID);
+            ReportingStyle style = styleIt != _reportingStyleByDataColumn.end() ? styleIt->second : ReportingStyleNone;
+            std::map<std::string, SampleSeries>::const_iterator valuesIt = wellValues.find(columnID);
+            const SampleSeries &values = valuesIt != wellValues.end() ? valuesIt->second : emptySeries;
+
+            if ((style & ReportingStyleMean) || (style & ReportingStyleStdDev)) {
+                double mean, stddev;
+                meanAndStdDev(values, mean, stddev);
+                if (style & ReportingStyleMean) {
+                    appendCSVElement(output, valueAsString(mean, style & ReportingStylePercent));
+                }
+                if (style & ReportingStyleStdDev) {
+                    appendCSVElement(output, valueAsString(stddev, style & ReportingStylePercent));
+                }
+            }
+            if (style & (ReportingStyleMedian | ReportingStylePercentiles)) {
+                std::map<std::string, QuantileSketch>::const_iterator sketchIt = wellSketches.find(columnID);
+                const QuantileSketch &sketch = sketchIt != wellSketches.end() ? sketchIt->second : emptySketch;
+                if (style & ReportingStyleMedian) {
+                    appendCSVElement(output, valueAsString(sketch.quantile(0.5), style & ReportingStylePercent));
+                }
+                if (style & ReportingStylePercentiles) {
+                    std::map<std::string, std::vector<double> >::const_iterator percentilesIt = _reportedPercentilesByDataColumn.find(columnID);
+                    const std::vector<double> &percentiles = percentilesIt != _reportedPercentilesByDataColumn.end() ? percentilesIt->second : defaultPercentiles;
+                    for (size_t i = 0; i < percentiles.size(); i++) {
+                        appendCSVElement(output, valueAsString(sketch.quantile(percentiles[i]), style & ReportingStylePercent));
+                    }
+                }
+            }
+
+            // Append all raw values on a line, preceeded by the plate-well id
+            if (style & ReportingStyleRaw) {
+                // Get the string for this column ID, writing out the header row with labels and times if it is new
+                std::string &rawLine = rawColumnIDsToCSVStrings[columnID];
+                if (rawLine.empty()) {
+                    appendCSVElement(rawLine, "Plate and Well");
+                    appendCSVElement(rawLine, "Scan ID");
+                    appendCSVElement(rawLine, "Well/Times");
+                    for (size_t i = 0; i < _framePresentationTimes.size(); i++) {
+                        snprintf(buffer, sizeof(buffer), "%.3f", _framePresentationTimes[i]);
+                        appendCSVElement(rawLine, buffer);
+                    }
+                    rawLine += "\n";
+                }
+
+                appendCSVElement(rawLine, plateAndWellID);
+                appendCSVElement(rawLine, scanID);
+                appendCSVElement(rawLine, wellIDString);
+                // Skipped frames are left empty. Movement units are also padded out to the end of the time axis.
+                size_t valueCount = values.size();
+                if (columnID == MovementUnitID) {
+                    valueCount = _framePresentationTimes.size();
+                }
+                SampleSeries::const_iterator rawValue = values.begin();
+                for (size_t i = 0; i < valueCount; i++) {
+                    if (i < values.size() && !isnan(*rawValue)) {
+                        appendCSVElement(rawLine, valueAsString(*rawValue, style & ReportingStylePercent));
+                    } else {
+                        appendCSVElement(rawLine, "");
+                    }
+                    if (i < values.size()) {
+                        ++rawValue;
+                    }
+                }
+                rawLine += "\n";
+            }
+        }
+        output += "\n";
+    }
+    output += "\n";
+
+    // Append the additional information from the analyzer or the video processor
+    if (!_additionalResultsText.empty()) {
+        output += "\n";
+        appendCSVElement(output, _additionalResultsText);
+        output += "\n";
+    }
+
+    return output;
+}
+
+// The same ordering as -[NSString caseInsensitiveCompare:] for ASCII column IDs
+static bool caseInsensitiveLessThan(const std::string &a, const std::string &b)
+{
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) {
+        return tolower((unsigned char)x) < tolower((unsigned char)y);
+    });
+}
+
+static std::string valueAsString(double value, bool asPercent)
+{
+    char buffer[32];
+    if (asPercent) {
+        snprintf(buffer, sizeof(buffer), "%.4g%%", value * 100.0);
+    } else {
+        snprintf(buffer, sizeof(buffer), "%.4g", value);
+    }
+    return buffer;
+}
+
+// E.g. "10th", "99.5th" or "1st"
+static std::string percentileName(double percentile)
+{
+    char buffer[32];
+    double percent = percentile * 100.0;
+    const char *suffix = "th";
+    if (percent == floor(percent)) {
+        long integer = (long)percent;
+        if (integer % 100 < 11 || integer % 100 > 13) {
+            switch (integer % 10) {
+                case 1: suffix = "st"; break;
+                case 2: suffix = "nd"; break;
+                case 3: suffix = "rd"; break;
+            }
+        }
+    }
+    snprintf(buffer, sizeof(buffer), "%g%s", percent, suffix);
+    return buffer;
+}
+
+static void appendCSVElement(std::string &output, const std::string &element)
+{
+    if (element.find_first_of(",\"") != std::string::npos) {
+        output += '"';
+        for (size_t i = 0; i < element.size(); i++) {
+            if (element[i] == '"') {
+                output += '"';
+            }
+            output += element[i];
+        }
+        output += '"';
+    } else {
+        output += element;
+    }
+    output += ',';
+}
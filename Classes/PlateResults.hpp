@@ -0,0 +1,137 @@
+//
+//  PlateResults.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef PlateResults_hpp
+#define PlateResults_hpp
+
+// C compatible so that PlateData.h can be imported by Objective-C sources
+enum {
+    ReportingStyleNone = 0,
+    ReportingStyleMean = 1 << 1,
+    ReportingStyleStdDev = 1 << 2,
+    ReportingStyleMedian = 1 << 3,
+    ReportingStylePercentiles = 1 << 4,     // 10th, 25th, 75th and 90th unless chosen otherwise
+    ReportingStyleRaw = 1 << 20,
+    ReportingStylePercent = 1 << 21
+};
+typedef int ReportingStyle;
+
+#ifdef __cplusplus
+
+#include <stddef.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "QuantileSketch.hpp"
+#include "SampleSeries.hpp"
+
+// The results of analyzing a plate, and their CSV output. This is the portable core of PlateData, which adds the
+// VideoProcessor's frame rate and processing time statistics, and is shared with the command line analyzer so that
+// both produce identical output. Well may be -1 for a non-well plate throughout. Thread-safe, except as noted for staging.
+class PlateResults {
+public:
+    static const char *const MovementUnitID;        // the movement units' column ID
+
+    // Set wellCount to 0 for a non-well plate. Raw values are stored compressed if compressRawValues is set (see
+    // SampleSeries.hpp), and the median and percentiles of the movement units are reported if requested.
+    PlateResults(int wellCount, double startPresentationTime, bool compressRawValues = false, bool reportMovementUnitPercentiles = false);
+
+    int wellCount() const;
+    double startPresentationTime() const;
+    double lastPresentationTime() const;
+    size_t sampleCount() const;                             // the number of frames with movement units
+    std::vector<double> framePresentationTimes() const;     // a copy of the plate-wide time axis
+
+    // MovementUnits are analyzer dependent arbitrary units. This is the only required data.
+    void appendMovementUnit(double movementUnit, double presentationTime, int well);
+
+    // Adds results to a specific column, creating the column if necessary. The median and percentiles are estimated with a
+    // bounded-memory sketch to within 1% of the exact value. Raw values are only retained if the style includes the mean,
+    // standard deviation or raw output (movement units are always retained). Results added before a column's style is
+    // first set are all retained, and are added to its sketch then, so the style must not later gain the median or
+    // percentiles once results have been added without them.
+    void setReportingStyle(ReportingStyle style, const char *columnID);
+    ReportingStyle reportingStyle(const char *columnID) const;
+    // The percentiles (each in [0, 1], e.g. 0.95) reported for a column with the percentiles style, which are
+    // DefaultReportedPercentiles() unless set
+    static std::vector<double> DefaultReportedPercentiles();
+    void setReportedPercentiles(const std::vector<double> &percentiles, const char *columnID);
+    std::vector<double> reportedPercentiles(const char *columnID) const;
+    void appendResult(double result, const char *columnID, int well);
+
+    // Frame transactions. A frame is begun before the analyzer processes it and committed afterwards. In between,
+    // analyzers stage each well's results without locking, and the whole frame becomes visible to readers at once when
+    // it is committed. Each well's staging record must only be written by the single worker processing that well.
+    // Column IDs must remain valid until the frame is committed (i.e. use string constants).
+    void beginFrame(double presentationTime);
+    void stageMovementUnit(double movementUnit, int well);
+    void stageResult(double result, const char *columnID, int well);
+    void commitFrame();
+
+    // Non-formatted results text reported with the results. Most analyzers are not expected to provide this.
+    void appendToAdditionalResultsText(const std::string &text);
+
+    bool movementUnitsMeanAndStdDev(int well, double &mean, double &stddev) const;
+    bool movementUnitsMeanAndStdDevInLastSeconds(int well, double seconds, double &mean, double &stddev) const;
+    // Computes the windowed statistics for all wells at once. The means and stddevs arrays must have one element per well
+    // (or a single element for a non-well plate). Wells without any samples in the window are set to NAN.
+    void movementUnitsMeansAndStdDevs(double seconds, double *means, double *stddevs) const;
+
+    // Results output. The analyzer name and version are reported in the header row. The raw values of each column with
+    // the raw style are appended to the string for their column ID, with a header row if the string is empty.
+    std::vector<std::string> sortedColumnIDsWithData() const;
+    // A copy of the retained values of a column for a well, e.g. for regression testing. Movement units have one value
+    // per frame of the time axis (NAN if the well skipped the frame), and other columns one per result.
+    std::vector<double> values(const std::string &columnID, int well) const;
+    std::string csvOutput(const std::string &plateID,
+                          const std::string &scanID,
+                          const std::string &assayDateTime,
+                          const std::string &analyzerName,
+                          const std::string &version,
+                          bool columnMajorOrder,
+                          std::map<std::string, std::string> &rawColumnIDsToCSVStrings) const;
+
+private:
+    // The results a single well has staged for the frame currently being processed
+    struct StagedWellResults {
+        StagedWellResults() : hasMovementUnit(false), movementUnit(0) {}
+        bool hasMovementUnit;
+        double movementUnit;
+        std::vector<std::pair<const char*, double> > results;
+    };
+
+    PlateResults(const PlateResults &);                 // not copyable
+    PlateResults &operator=(const PlateResults &);
+
+    // These require the lock to be held
+    void appendMovementUnitLocked(double movementUnit, double presentationTime, int well);
+    void appendResultLocked(double result, const std::string &columnID, int well);
+    SampleSeries &seriesLocked(const std::string &columnID, int well);
+    size_t firstFrameIndexInLastSecondsLocked(double seconds) const;
+    std::vector<std::string> sortedColumnIDsWithDataLocked() const;
+
+    mutable std::mutex _mutex;
+    double _startPresentationTime;
+    double _lastPresentationTime;
+    bool _nonWellPlate;
+    bool _compressRawValues;
+    std::vector<double> _framePresentationTimes;        // plate-wide time axis, one entry per sampled frame
+    std::vector<std::map<std::string, SampleSeries> > _valuesByWellAndDataColumn;
+    std::map<std::string, ReportingStyle> _reportingStyleByDataColumn;
+    std::map<std::string, std::vector<double> > _reportedPercentilesByDataColumn;     // if not the default
+    std::vector<std::map<std::string, QuantileSketch> > _sketchesByWellAndDataColumn;      // for median/percentile styles
+    std::string _additionalResultsText;
+
+    double _stagedFramePresentationTime;
+    std::vector<StagedWellResults> _stagedWellResults;
+};
+
+#endif
+
+#endif
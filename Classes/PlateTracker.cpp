@@ -0,0 +1,83 @@
+//
+//  PlateTracker.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#include "PlateTracker.hpp"
+#include <float.h>
+
+static const double MinimumWellMatchTimeToBeginTracking = 0.500; // 500 ms
+static const double PresentationTimeDistantPast = -DBL_MAX;
+
+PlateTracker::PlateTracker()
+    : _wellCountHint(0)
+{
+    reset();
+}
+
+PlateTracker::Transition PlateTracker::wellsFound(bool plateFound, const std::vector<Circle> &wellCircles, double presentationTime)
+{
+    // Store the circles for debugging later
+    _lastCircles = wellCircles;
+    // If we've found a plate, store the well count to improve the performance of future searches
+    if (plateFound) {
+        _wellCountHint = (int)wellCircles.size();
+    }
+
+    switch (_state) {
+        case NoPlate:
+            if (plateFound) {
+                _state = PlateFirstFrameIdentified;
+                _trackingWellCircles = wellCircles;     // store the first circles as the baseline for the second set
+                _firstWellFrameTime = presentationTime;
+            }
+            break;
+
+        case PlateFirstFrameIdentified:
+            if (plateFound) {
+                // If the second identification yields matching results as the first, and they are spread by at least
+                // 500 ms, begin motion tracking
+                if (plateSequentialCirclesAppearSameAndStationary(_trackingWellCircles, wellCircles) &&
+                    presentationTime - _firstWellFrameTime >= MinimumWellMatchTimeToBeginTracking &&
+                    presentationTime > _lockoutEndTime) {
+                    _startOfTrackingTime = presentationTime;
+                    _state = TrackingMotion;
+                    _trackingWellCircles = wellCircles; // store the second set as the baseline for all remaining sets
+                    return BeganTracking;
+                } else {
+                    // There is still a plate, but it doesn't match or more likely is still moving moved, or not enough
+                    // time has lapsed, so we stay in this state, but update the circles
+                    _trackingWellCircles = wellCircles;
+                }
+            } else {
+                // Plate is gone so reset
+                return PlateLost;
+            }
+            break;
+
+        case TrackingMotion:
+            // If the plate is gone, moved or different, reset
+            if (!plateFound || !plateSequentialCirclesAppearSameAndStationary(_trackingWellCircles, wellCircles)) {
+                return PlateLost;
+            }
+            break;
+    }
+    return NoTransition;
+}
+
+void PlateTracker::reset()
+{
+    _state = NoPlate;
+    _firstWellFrameTime = PresentationTimeDistantPast;
+    _startOfTrackingTime = PresentationTimeDistantPast;
+    _lockoutEndTime = PresentationTimeDistantPast;
+    _trackingWellCircles.clear();
+}
+
+void PlateTracker::lockOutUntil(double presentationTime)
+{
+    _lockoutEndTime = presentationTime;
+}
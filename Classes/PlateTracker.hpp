@@ -0,0 +1,61 @@
+//
+//  PlateTracker.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef PlateTracker_hpp
+#define PlateTracker_hpp
+
+#include <vector>
+#include "WellFinding.hpp"
+
+// The plate tracking state machine of the VideoProcessor, shared with the command line analyzer. It is fed the result of
+// each well search, and decides when a plate has been identified, when it has been stationary long enough to begin
+// tracking it, and when it has moved or been removed. Not thread-safe.
+class PlateTracker {
+public:
+    enum State {
+        NoPlate,
+        PlateFirstFrameIdentified,
+        TrackingMotion
+    };
+
+    enum Transition {
+        NoTransition,
+        BeganTracking,
+        PlateLost           // the plate moved, changed or was removed; the caller must report any results and reset()
+    };
+
+    PlateTracker();
+
+    // Whether the next search should consider all plate sizes rather than just wellCountHint()
+    bool shouldSearchAllPlateSizes() const { return _state == NoPlate; }
+    int wellCountHint() const { return _wellCountHint; }
+
+    // Feeds the wells found (in row major order) in a frame, in presentation time order
+    Transition wellsFound(bool plateFound, const std::vector<Circle> &wellCircles, double presentationTime);
+
+    // Returns to NoPlate, forgetting the plate and any lockout, but keeping the well count hint and the last circles
+    void reset();
+    // Prevents tracking from beginning until after the given time, e.g. between time lapse recordings
+    void lockOutUntil(double presentationTime);
+
+    State state() const { return _state; }
+    const std::vector<Circle> &trackingWellCircles() const { return _trackingWellCircles; }
+    const std::vector<Circle> &lastCircles() const { return _lastCircles; }     // the last circles found, for display
+    double startOfTrackingTime() const { return _startOfTrackingTime; }
+
+private:
+    State _state;
+    int _wellCountHint;
+    std::vector<Circle> _trackingWellCircles;
+    std::vector<Circle> _lastCircles;
+    double _firstWellFrameTime;     // not the beginning of tracking
+    double _startOfTrackingTime;
+    double _lockoutEndTime;
+};
+
+#endif
@@ -0,0 +1,158 @@
+//
+//  QuantileSketch.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef QuantileSketch_hpp
+#define QuantileSketch_hpp
+
+#include <stdint.h>
+#include <math.h>
+#include <stddef.h>
+#include <algorithm>
+#include <vector>
+
+// A bounded-memory streaming quantile sketch (after DDSketch, Masson et al. 2019). Values are counted in logarithmically
+// sized bins, so every reported quantile q is within the relative accuracy (1% by default) of the exact sample at rank
+// floor(q * (n - 1)), i.e. |estimate - exact| <= 0.01 * |exact|. Values with a magnitude below 1e-9 are counted as zero.
+//
+// Each sign uses at most MaximumBinCount bins (4 KB), which covers a dynamic range of about 1e8 at 1% accuracy. If a
+// sign's values span a wider range, its lowest-magnitude bins are merged, so only quantiles that fall in those merged
+// bins lose the accuracy guarantee. Adding a value is O(1) apart from rare bin growth, and a quantile query is linear
+// in the number of bins. Not thread-safe.
+class QuantileSketch {
+public:
+    enum {
+        MaximumBinCount = 1024
+    };
+
+    explicit QuantileSketch(double relativeAccuracy = 0.01) :
+        _gamma((1.0 + relativeAccuracy) / (1.0 - relativeAccuracy)),
+        _inverseLogGamma(1.0 / log(_gamma)),
+        _zeroCount(0)
+    {
+    }
+
+    void add(double value)
+    {
+        if (isnan(value)) {
+            return;
+        }
+        if (value > MinimumIndexableValue) {
+            _positive.add(keyForMagnitude(value));
+        } else if (value < -MinimumIndexableValue) {
+            _negative.add(keyForMagnitude(-value));
+        } else {
+            _zeroCount++;
+        }
+    }
+
+    uint64_t count() const
+    {
+        return _negative.count + _zeroCount + _positive.count;
+    }
+
+    // Returns NAN if no values have been added
+    double quantile(double q) const
+    {
+        uint64_t total = count();
+        if (total == 0) {
+            return NAN;
+        }
+        uint64_t rank = (uint64_t)(std::min(std::max(q, 0.0), 1.0) * (total - 1));
+
+        // Negative values in ascending order are their magnitudes in descending order
+        uint64_t cumulative = 0;
+        for (size_t i = _negative.bins.size(); i-- > 0; ) {
+            cumulative += _negative.bins[i];
+            if (cumulative > rank) {
+                return -valueForKey(_negative.offset + (int)i);
+            }
+        }
+        cumulative += _zeroCount;
+        if (cumulative > rank) {
+            return 0.0;
+        }
+        for (size_t i = 0; i < _positive.bins.size(); i++) {
+            cumulative += _positive.bins[i];
+            if (cumulative > rank) {
+                return valueForKey(_positive.offset + (int)i);
+            }
+        }
+        return valueForKey(_positive.offset + (int)_positive.bins.size() - 1);
+    }
+
+    size_t memoryUsage() const
+    {
+        return sizeof(*this) + (_negative.bins.capacity() + _positive.bins.capacity()) * sizeof(uint32_t);
+    }
+
+private:
+    static constexpr double MinimumIndexableValue = 1e-9;
+
+    // Counts for consecutive bin keys starting at offset
+    struct Store {
+        std::vector<uint32_t> bins;
+        int offset;
+        uint64_t count;
+
+        Store() : offset(0), count(0) {}
+
+        void add(int key)
+        {
+            if (bins.empty()) {
+                offset = key;
+                bins.push_back(0);
+            }
+            if (key < offset) {
+                // Grow downwards, or merge into the lowest bin if full
+                size_t growth = std::min<size_t>(offset - key, MaximumBinCount - bins.size());
+                bins.insert(bins.begin(), growth, 0);
+                offset -= (int)growth;
+                key = std::max(key, offset);
+            } else if (key - offset >= (int)bins.size()) {
+                // Grow upwards, merging the lowest bins as needed to stay within the maximum
+                int newOffset = std::max(offset, key - (int)MaximumBinCount + 1);
+                if (newOffset > offset) {
+                    size_t mergedBins = std::min<size_t>(newOffset - offset, bins.size());
+                    uint32_t merged = 0;
+                    for (size_t i = 0; i < mergedBins; i++) {
+                        merged += bins[i];
+                    }
+                    bins.erase(bins.begin(), bins.begin() + mergedBins);
+                    offset = newOffset;
+                    if (bins.empty()) {
+                        bins.push_back(0);
+                    }
+                    bins[0] += merged;
+                }
+                bins.resize(key - offset + 1, 0);
+            }
+            bins[key - offset]++;
+            count++;
+        }
+    };
+
+    // Bin k holds magnitudes in (gamma^(k-1), gamma^k]
+    int keyForMagnitude(double magnitude) const
+    {
+        return (int)ceil(log(magnitude) * _inverseLogGamma);
+    }
+
+    // The value with equal relative error to either bound of bin k
+    double valueForKey(int key) const
+    {
+        return 2.0 * pow(_gamma, key) / (_gamma + 1.0);
+    }
+
+    double _gamma;
+    double _inverseLogGamma;
+    uint64_t _zeroCount;
+    Store _negative;
+    Store _positive;
+};
+
+#endif /* QuantileSketch_hpp */
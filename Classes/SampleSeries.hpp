@@ -0,0 +1,261 @@
+//
+//  SampleSeries.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef SampleSeries_hpp
+#define SampleSeries_hpp
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <vector>
+
+// An append-only series of doubles that is read back with forward iterators. When compressed, values are stored
+// losslessly in chunks of 256 using the XOR encoding from Facebook's Gorilla time series database (Pelkonen et al. 2015):
+// each value is XORed with its predecessor, a repeated value costs 1 bit, and otherwise only the bits that differ are
+// stored. Runs of skipped frames (NAN) and slowly changing values compress well; noisy full-precision values compress
+// little. Iterators can start at any index, which decodes at most one partial chunk to reach it. Not thread-safe.
+class SampleSeries {
+    struct Chunk {
+        std::vector<uint64_t> words;
+        size_t bitCount;
+    };
+
+public:
+    enum {
+        ChunkValueCount = 256
+    };
+
+    explicit SampleSeries(bool compressed = false)
+        : _compressed(compressed), _size(0), _encoderPrevious(0), _encoderLeadingZeros(-1), _encoderTrailingZeros(0)
+    {
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    bool compressed() const
+    {
+        return _compressed;
+    }
+
+    void push_back(double value)
+    {
+        if (_compressed) {
+            appendEncoded(value);
+        } else {
+            _values.push_back(value);
+        }
+        _size++;
+    }
+
+    // Only grows the series
+    void resize(size_t size, double value)
+    {
+        assert(size >= _size);
+        while (_size < size) {
+            push_back(value);
+        }
+    }
+
+    size_t memoryUsage() const
+    {
+        size_t usage = sizeof(*this) + _values.capacity() * sizeof(double) + _chunks.capacity() * sizeof(Chunk);
+        for (size_t i = 0; i < _chunks.size(); i++) {
+            usage += _chunks[i].words.capacity() * sizeof(uint64_t);
+        }
+        return usage;
+    }
+
+    class const_iterator {
+    public:
+        double operator*() const
+        {
+            return _value;
+        }
+
+        const_iterator &operator++()
+        {
+            _index++;
+            if (_index < _series->_size) {
+                if (_series->_compressed) {
+                    if (_index % ChunkValueCount == 0) {
+                        _decoder.begin(_series->_chunks[_index / ChunkValueCount]);
+                    }
+                    _value = _decoder.next();
+                } else {
+                    _value = _series->_values[_index];
+                }
+            }
+            return *this;
+        }
+
+        bool operator!=(const const_iterator &other) const
+        {
+            return _index != other._index;
+        }
+
+        bool operator==(const const_iterator &other) const
+        {
+            return _index == other._index;
+        }
+
+    private:
+        friend class SampleSeries;
+
+        const_iterator(const SampleSeries *series, size_t index) : _series(series), _index(index), _value(0.0)
+        {
+            if (_index < _series->_size) {
+                if (_series->_compressed) {
+                    _decoder.begin(_series->_chunks[_index / ChunkValueCount]);
+                    for (size_t i = _index - _index % ChunkValueCount; i <= _index; i++) {
+                        _value = _decoder.next();
+                    }
+                } else {
+                    _value = _series->_values[_index];
+                }
+            }
+        }
+
+        const SampleSeries *_series;
+        size_t _index;
+        double _value;
+        struct Decoder {
+            const uint64_t *words;
+            size_t bitPosition;
+            uint64_t previous;
+            int leadingZeros;
+            int trailingZeros;
+            bool first;
+
+            void begin(const Chunk &chunk)
+            {
+                words = &chunk.words[0];
+                bitPosition = 0;
+                first = true;
+            }
+
+            uint64_t readBits(int count)
+            {
+                size_t word = bitPosition / 64;
+                int offset = bitPosition % 64;
+                bitPosition += count;
+                uint64_t bits = words[word] << offset;
+                if (offset + count > 64) {
+                    bits |= words[word + 1] >> (64 - offset);
+                }
+                return bits >> (64 - count);
+            }
+
+            double next()
+            {
+                if (first) {
+                    first = false;
+                    previous = readBits(64);
+                } else if (readBits(1)) {
+                    if (readBits(1)) {
+                        leadingZeros = (int)readBits(5);
+                        int meaningfulBits = (int)readBits(6) + 1;
+                        trailingZeros = 64 - leadingZeros - meaningfulBits;
+                    }
+                    int meaningfulBits = 64 - leadingZeros - trailingZeros;
+                    previous ^= readBits(meaningfulBits) << trailingZeros;
+                }
+                double value;
+                memcpy(&value, &previous, sizeof(value));
+                return value;
+            }
+        } _decoder;
+    };
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, _size);
+    }
+
+    const_iterator iteratorAt(size_t index) const
+    {
+        return const_iterator(this, index < _size ? index : _size);
+    }
+
+private:
+    void writeBits(uint64_t bits, int count)       // the low count bits, most significant first
+    {
+        Chunk &chunk = _chunks.back();
+        int offset = chunk.bitCount % 64;
+        if (offset == 0) {
+            chunk.words.push_back(0);
+        }
+        bits <<= 64 - count;
+        chunk.words.back() |= bits >> offset;
+        if (offset + count > 64) {
+            chunk.words.push_back(bits << (64 - offset));
+        }
+        chunk.bitCount += count;
+    }
+
+    void appendEncoded(double value)
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        if (_size % ChunkValueCount == 0) {
+            if (!_chunks.empty()) {
+                _chunks.back().words.shrink_to_fit();       // the full chunk won't grow, so drop its spare capacity
+            }
+            _chunks.push_back(Chunk());
+            _chunks.back().bitCount = 0;
+            writeBits(bits, 64);
+            _encoderLeadingZeros = -1;
+        } else {
+            uint64_t difference = bits ^ _encoderPrevious;
+            if (difference == 0) {
+                writeBits(0, 1);
+            } else {
+                int leadingZeros = __builtin_clzll(difference);
+                int trailingZeros = __builtin_ctzll(difference);
+                if (leadingZeros > 31) {
+                    leadingZeros = 31;      // stored in 5 bits
+                }
+                if (_encoderLeadingZeros >= 0 && leadingZeros >= _encoderLeadingZeros && trailingZeros >= _encoderTrailingZeros) {
+                    // Reuse the previous meaningful bit window
+                    int meaningfulBits = 64 - _encoderLeadingZeros - _encoderTrailingZeros;
+                    writeBits(0x2, 2);
+                    writeBits(difference >> _encoderTrailingZeros, meaningfulBits);
+                } else {
+                    int meaningfulBits = 64 - leadingZeros - trailingZeros;
+                    writeBits(0x3, 2);
+                    writeBits(leadingZeros, 5);
+                    writeBits(meaningfulBits - 1, 6);
+                    writeBits(difference >> trailingZeros, meaningfulBits);
+                    _encoderLeadingZeros = leadingZeros;
+                    _encoderTrailingZeros = trailingZeros;
+                }
+            }
+        }
+        _encoderPrevious = bits;
+    }
+
+    bool _compressed;
+    size_t _size;
+    std::vector<double> _values;        // when uncompressed
+    std::vector<Chunk> _chunks;         // when compressed
+
+    // Encoder state for the last chunk
+    uint64_t _encoderPrevious;
+    int _encoderLeadingZeros;
+    int _encoderTrailingZeros;
+};
+
+#endif /* SampleSeries_hpp */
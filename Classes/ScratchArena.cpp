@@ -0,0 +1,140 @@
+//
+//  ScratchArena.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#include "ScratchArena.hpp"
+#include <stdlib.h>
+#include <algorithm>
+#include <mutex>
+#include <new>
+
+static std::mutex freeArenasMutex;
+static std::vector<ScratchArena *> *freeArenas = new std::vector<ScratchArena *>();     // never destroyed, since threads may outlive statics
+
+// Returns the calling thread's arena for reuse when the thread exits
+struct ThreadArenaHolder {
+    ThreadArenaHolder() : arena(NULL) {}
+
+    ~ThreadArenaHolder()
+    {
+        if (arena) {
+            std::lock_guard<std::mutex> lock(freeArenasMutex);
+            freeArenas->push_back(arena);
+        }
+    }
+
+    ScratchArena *arena;
+};
+
+static thread_local ThreadArenaHolder threadArenaHolder;
+
+ScratchArena &ScratchArena::threadArena()
+{
+    ThreadArenaHolder &holder = threadArenaHolder;
+    if (!holder.arena) {
+        std::lock_guard<std::mutex> lock(freeArenasMutex);
+        if (freeArenas->size() > 0) {
+            holder.arena = freeArenas->back();
+            freeArenas->pop_back();
+        } else {
+            holder.arena = new ScratchArena();
+        }
+    }
+    return *holder.arena;
+}
+
+ScratchArena::ScratchArena(size_t blockSize)
+    : _blockIndex(0), _offset(0), _blockSize(std::max<size_t>(blockSize, Alignment))
+{
+}
+
+ScratchArena::~ScratchArena()
+{
+    for (size_t i = 0; i < _blocks.size(); i++) {
+        free(_blocks[i].data);
+    }
+}
+
+void ScratchArena::appendBlock(size_t size)
+{
+    Block block;
+    block.size = size;
+    void *data;
+    if (posix_memalign(&data, Alignment, size) != 0) {
+        throw std::bad_alloc();
+    }
+    block.data = (char *)data;
+    _blocks.push_back(block);
+}
+
+void *ScratchArena::allocate(size_t size)
+{
+    size = (std::max<size_t>(size, 1) + Alignment - 1) & ~(size_t)(Alignment - 1);      // keeps the offsets aligned
+    while (_blockIndex < _blocks.size()) {
+        Block &block = _blocks[_blockIndex];
+        if (_offset + size <= block.size) {
+            void *pointer = block.data + _offset;
+            _offset += size;
+            return pointer;
+        }
+        _blockIndex++;
+        _offset = 0;
+    }
+
+    appendBlock(std::max(size, _blockSize));
+    _blockIndex = _blocks.size() - 1;
+    _offset = size;
+    return _blocks.back().data;
+}
+
+IplImage *ScratchArena::createImage(CvSize size, int depth, int channels)
+{
+    IplImage *image = (IplImage *)allocate(sizeof(IplImage));
+    cvInitImageHeader(image, size, depth, channels);
+    image->imageData = image->imageDataOrigin = (char *)allocate(image->imageSize);
+    return image;
+}
+
+CvMat *ScratchArena::createMat(int rows, int columns, int type)
+{
+    CvMat *mat = (CvMat *)allocate(sizeof(CvMat));
+    cvInitMatHeader(mat, rows, columns, type);
+    mat->data.ptr = (uchar *)allocate((size_t)mat->step * rows);
+    return mat;
+}
+
+size_t ScratchArena::capacity() const
+{
+    size_t capacity = 0;
+    for (size_t i = 0; i < _blocks.size(); i++) {
+        capacity += _blocks[i].size;
+    }
+    return capacity;
+}
+
+ScratchArena::Mark ScratchArena::mark() const
+{
+    Mark mark = { _blockIndex, _offset };
+    return mark;
+}
+
+void ScratchArena::resetToMark(const Mark &mark)
+{
+    _blockIndex = mark.blockIndex;
+    _offset = mark.offset;
+
+    // Once the arena is empty, replace several blocks with one of their total size, so that a task that needed
+    // more than one block later fits in one without skipping the ends of blocks
+    if (_blockIndex == 0 && _offset == 0 && _blocks.size() > 1) {
+        size_t totalSize = capacity();
+        for (size_t i = 0; i < _blocks.size(); i++) {
+            free(_blocks[i].data);
+        }
+        _blocks.clear();
+        appendBlock(totalSize);
+    }
+}
@@ -0,0 +1,94 @@
+//
+//  ScratchArena.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef ScratchArena_hpp
+#define ScratchArena_hpp
+
+#include <stddef.h>
+#include <vector>
+#include <opencv2/core/core_c.h>
+
+// A bump allocator for the temporaries of one task, e.g. the masks, edge images and feature arrays made while analyzing
+// a well. Allocating is a pointer increment within the arena's blocks, and a Scope releases everything allocated while
+// it existed. The blocks are kept, so once a thread's arena has grown to fit its largest task, tasks make no heap
+// allocations. Memory from an arena must not be freed (e.g. its images must not be passed to cvReleaseImage()), and
+// must not be used once its scope ends.
+//
+// Each thread has its own arena, which is returned for reuse by later threads when the thread exits (as worker threads
+// may be created for each parallel loop). Arenas themselves are not thread-safe.
+class ScratchArena {
+public:
+    enum {
+        DefaultBlockSize = 1 << 20,
+        Alignment = 64                  // of every allocation, e.g. for SIMD rows
+    };
+
+    // The calling thread's arena
+    static ScratchArena &threadArena();
+
+    explicit ScratchArena(size_t blockSize = DefaultBlockSize);
+    ~ScratchArena();
+
+    void *allocate(size_t size);
+    template <typename T>
+    T *allocateArray(size_t count) { return (T *)allocate(count * sizeof(T)); }
+
+    // As cvCreateImage() and cvCreateMat() (with the same row strides), but with the header and data in the arena. The
+    // contents are undefined.
+    IplImage *createImage(CvSize size, int depth, int channels);
+    CvMat *createMat(int rows, int columns, int type);
+
+    size_t capacity() const;            // of the blocks
+    size_t blockCount() const { return _blocks.size(); }
+
+private:
+    struct Block {
+        char *data;
+        size_t size;
+    };
+
+    struct Mark {
+        size_t blockIndex;
+        size_t offset;
+    };
+
+public:
+    // Releases everything allocated from the arena (by default the calling thread's) during the scope's lifetime, e.g.
+    //     ScratchArena::Scope scratchScope;
+    //     IplImage *mask = scratchScope.arena().createImage(size, IPL_DEPTH_8U, 1);
+    // Scopes may be nested.
+    class Scope {
+    public:
+        explicit Scope(ScratchArena &arena = threadArena()) : _arena(arena), _mark(arena.mark()) {}
+        ~Scope() { _arena.resetToMark(_mark); }
+
+        ScratchArena &arena() const { return _arena; }
+
+    private:
+        Scope(const Scope &);
+        Scope &operator=(const Scope &);
+
+        ScratchArena &_arena;
+        Mark _mark;
+    };
+
+private:
+    ScratchArena(const ScratchArena &);
+    ScratchArena &operator=(const ScratchArena &);
+
+    Mark mark() const;
+    void resetToMark(const Mark &mark);
+    void appendBlock(size_t size);
+
+    std::vector<Block> _blocks;
+    size_t _blockIndex;                 // of the block being allocated from
+    size_t _offset;                     // within it
+    size_t _blockSize;
+};
+
+#endif
@@ -0,0 +1,52 @@
+//
+//  TaskScheduler.h
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+// The classes of work done off the pipeline stages, from most to least urgent
+typedef enum {
+    TaskPriorityAnalysis,           // at frame rate, e.g. per-well analysis and conversion stripes
+    TaskPriorityVerification,       // near frame rate, e.g. well finding to verify that a tracked plate is still present
+    TaskPriorityDetection,          // background well finding while no plate is tracked
+    TaskPriorityBarcode,            // background barcode reading
+#define TaskPriorityCount (TaskPriorityBarcode + 1)
+} TaskPriority;
+
+typedef struct {
+    unsigned long long completedCount;      // tasks and parallel instances that ran
+    unsigned long long cancelledCount;      // tasks cancelled before they began
+    NSTimeInterval busyTime;                // summed over every thread
+} TaskSchedulerStatistics;
+
+// Runs tasks in priority lanes so that background work (e.g. a burst of well finding) can't starve the analysis that
+// must keep up with the frame rate. Each lane is a concurrent queue of its own quality of service class, so the kernel
+// and libdispatch run the more urgent lanes' threads first while sharing one pool of worker threads across the lanes.
+// Parallel work (including any dispatch_apply() within a task, e.g. the well finder's fan out over plate sizes) runs at
+// the priority of the lane it was started from. Thread-safe.
+@interface TaskScheduler : NSObject
+
++ (TaskScheduler *)sharedScheduler;
+
+// Enqueues a task. The block is always called exactly once: with NO once it is run, or with YES if the task was
+// cancelled before it began, in which case it should only clean up. Returns an operation that can be cancelled.
+- (NSOperation *)addTaskWithPriority:(TaskPriority)priority block:(void (^)(BOOL cancelled))block;
+// Cancels every task of the priority that hasn't begun
+- (void)cancelAllTasksWithPriority:(TaskPriority)priority;
+
+// Runs 'iterations' instances of the block in parallel, up to maximumConcurrency at once, and returns once all have.
+// Each is passed a unique i in [0, iterations - 1], and the object to @synchronize on during any critical section.
+- (void)performInParallelWithInstances:(NSUInteger)iterations
+                    maximumConcurrency:(NSUInteger)maximumConcurrency
+                              priority:(TaskPriority)priority
+                                 block:(NS_NOESCAPE void (^)(NSUInteger i, id criticalSection))block;
+
+- (TaskSchedulerStatistics)statisticsForPriority:(TaskPriority)priority;
+// Each lane's counts and mean utilization (in cores) since the last summary
+- (NSString *)utilizationSummary;
+
+@end
@@ -0,0 +1,146 @@
+//
+//  TaskScheduler.m
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#import "TaskScheduler.h"
+#import <QuartzCore/QuartzCore.h>
+#import <stdatomic.h>
+
+static NSString *const TaskPriorityNames[TaskPriorityCount] = { @"analysis", @"verification", @"detection", @"barcode" };
+
+@interface TaskScheduler () {
+    NSOperationQueue *_queues[TaskPriorityCount];
+    dispatch_queue_t _dispatchQueues[TaskPriorityCount];     // the queues' underlying queues
+    TaskSchedulerStatistics _statistics[TaskPriorityCount];
+    TaskSchedulerStatistics _lastSummaryStatistics[TaskPriorityCount];
+    NSTimeInterval _lastSummaryTime;
+}
+
+@end
+
+
+@implementation TaskScheduler
+
++ (TaskScheduler *)sharedScheduler
+{
+    static dispatch_once_t pred = 0;
+    static TaskScheduler *sharedInstance = nil;
+    dispatch_once(&pred, ^{
+        sharedInstance = [[self alloc] init];
+    });
+    return sharedInstance;
+}
+
+- (id)init
+{
+    if ((self = [super init])) {
+        // Barcode reading is the same class as detection, but yields to it. (The background class is avoided since it
+        // is throttled too heavily for results to arrive promptly.)
+        const qos_class_t classes[TaskPriorityCount] = { QOS_CLASS_USER_INTERACTIVE, QOS_CLASS_USER_INITIATED, QOS_CLASS_UTILITY, QOS_CLASS_UTILITY };
+        const int relativePriorities[TaskPriorityCount] = { 0, 0, 0, -1 };
+        for (int i = 0; i < TaskPriorityCount; i++) {
+            dispatch_queue_attr_t attributes = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_CONCURRENT, classes[i], relativePriorities[i]);
+            NSString *name = [@"org.chrismarcellino.wormassay.tasks." stringByAppendingString:TaskPriorityNames[i]];
+            _dispatchQueues[i] = dispatch_queue_create([name UTF8String], attributes);
+            _queues[i] = [[NSOperationQueue alloc] init];
+            [_queues[i] setName:name];
+            [_queues[i] setUnderlyingQueue:_dispatchQueues[i]];     // whose class overrides the operation queue's
+        }
+        _lastSummaryTime = CACurrentMediaTime();
+    }
+    return self;
+}
+
+- (void)addCompletedCount:(unsigned long long)count busyTime:(NSTimeInterval)busyTime priority:(TaskPriority)priority
+{
+    @synchronized (self) {
+        _statistics[priority].completedCount += count;
+        _statistics[priority].busyTime += busyTime;
+    }
+}
+
+- (NSOperation *)addTaskWithPriority:(TaskPriority)priority block:(void (^)(BOOL cancelled))block
+{
+    NSParameterAssert(priority < TaskPriorityCount);
+    __block BOOL began = NO;
+    NSBlockOperation *operation = [[NSBlockOperation alloc] init];
+    [operation addExecutionBlock:^{
+        began = YES;
+        NSTimeInterval startTime = CACurrentMediaTime();
+        block(NO);
+        [self addCompletedCount:1 busyTime:CACurrentMediaTime() - startTime priority:priority];
+    }];
+    // The completion block is called once the operation has finished, including when it was cancelled before it began
+    [operation setCompletionBlock:^{
+        if (!began) {
+            block(YES);
+            @synchronized (self) {
+                _statistics[priority].cancelledCount++;
+            }
+        }
+    }];
+    [_queues[priority] addOperation:operation];
+    return operation;
+}
+
+- (void)cancelAllTasksWithPriority:(TaskPriority)priority
+{
+    [_queues[priority] cancelAllOperations];
+}
+
+- (void)performInParallelWithInstances:(NSUInteger)iterations
+                    maximumConcurrency:(NSUInteger)maximumConcurrency
+                              priority:(TaskPriority)priority
+                                 block:(NS_NOESCAPE void (^)(NSUInteger i, id criticalSection))block
+{
+    NSParameterAssert(priority < TaskPriorityCount);
+    if (iterations == 0) {
+        return;
+    }
+
+    // Run a worker per allowed instance, each taking the next i as it finishes the last, so that instances that
+    // finish early leave their worker free to take over the remaining ones
+    id criticalSectionMutex = [[NSObject alloc] init];
+    __block atomic_ulong next = 0;
+    dispatch_apply(MIN(MAX(maximumConcurrency, 1), iterations), _dispatchQueues[priority], ^(size_t worker) {
+        NSTimeInterval startTime = CACurrentMediaTime();
+        unsigned long long count = 0;
+        for (NSUInteger i = atomic_fetch_add(&next, 1); i < iterations; i = atomic_fetch_add(&next, 1)) {
+            block(i, criticalSectionMutex);
+            count++;
+        }
+        [self addCompletedCount:count busyTime:CACurrentMediaTime() - startTime priority:priority];
+    });
+}
+
+- (TaskSchedulerStatistics)statisticsForPriority:(TaskPriority)priority
+{
+    @synchronized (self) {
+        return _statistics[priority];
+    }
+}
+
+- (NSString *)utilizationSummary
+{
+    @synchronized (self) {
+        NSTimeInterval now = CACurrentMediaTime();
+        NSTimeInterval elapsed = MAX(now - _lastSummaryTime, 1e-9);
+        NSMutableString *summary = [NSMutableString stringWithString:@"Tasks:"];
+        for (int i = 0; i < TaskPriorityCount; i++) {
+            TaskSchedulerStatistics current = _statistics[i];
+            TaskSchedulerStatistics last = _lastSummaryStatistics[i];
+            [summary appendFormat:@"%@ %@ %llu (%llu cancelled), %.2f cores", i > 0 ? @";" : @"", TaskPriorityNames[i],
+             current.completedCount - last.completedCount, current.cancelledCount - last.cancelledCount,
+             (current.busyTime - last.busyTime) / elapsed];
+            _lastSummaryStatistics[i] = current;
+        }
+        _lastSummaryTime = now;
+        return summary;
+    }
+}
+
+@end
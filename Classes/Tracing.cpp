@@ -0,0 +1,179 @@
+//
+//  Tracing.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#include "Tracing.hpp"
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+// Returns the calling thread's buffer to the recorder when the thread exits
+struct ThreadBufferHolder {
+    ThreadBufferHolder() : buffer(NULL) {}
+
+    ~ThreadBufferHolder()
+    {
+        if (buffer) {
+            TraceRecorder::sharedRecorder().relinquishBuffer(buffer);
+        }
+    }
+
+    TraceRecorder::ThreadBuffer *buffer;
+};
+
+static thread_local ThreadBufferHolder threadBufferHolder;
+
+TraceRecorder::TraceRecorder()
+{
+}
+
+TraceRecorder &TraceRecorder::sharedRecorder()
+{
+    static TraceRecorder *sharedRecorder = new TraceRecorder();      // never destroyed, since threads may outlive statics
+    return *sharedRecorder;
+}
+
+uint64_t TraceRecorder::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TraceRecorder::ThreadBuffer *TraceRecorder::acquireBuffer()
+{
+    char threadName[64] = "";
+    pthread_getname_np(pthread_self(), threadName, sizeof(threadName));
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    ThreadBuffer *buffer;
+    if (_freeBuffers.size() > 0) {
+        buffer = _freeBuffers.back();
+        _freeBuffers.pop_back();
+    } else {
+        buffer = new ThreadBuffer();
+        buffer->threadID = (uint32_t)_buffers.size();
+        _buffers.push_back(buffer);
+        _threadNames.push_back(std::string());
+    }
+    // Thread IDs are those of the buffers, so that the names don't grow with the number of threads that ever recorded
+    // a span (e.g. short-lived ones). A reused buffer keeps its earlier events, which are shown on the same track, named
+    // for the latest thread.
+    _threadNames[buffer->threadID] = threadName;
+    return buffer;
+}
+
+void TraceRecorder::relinquishBuffer(ThreadBuffer *buffer)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _freeBuffers.push_back(buffer);
+}
+
+void TraceRecorder::addSpan(const char *name, uint64_t startTime, uint64_t endTime, double presentationTime,
+                            const char *argumentName, int argument)
+{
+    ThreadBufferHolder &holder = threadBufferHolder;
+    if (!holder.buffer) {
+        holder.buffer = acquireBuffer();
+    }
+    ThreadBuffer *buffer = holder.buffer;
+
+    uint64_t index = buffer->count.load(std::memory_order_relaxed);
+    // Pairs with the fence in writeChromeTrace(), so that a copy that reads any of this event's fields also reads the
+    // count that was published before it was overwritten
+    std::atomic_thread_fence(std::memory_order_release);
+    Event &event = buffer->events[index % EventsPerThread];
+    event.name = name;
+    event.argumentName = argumentName;
+    event.startTime = startTime;
+    event.duration = endTime - startTime;
+    event.presentationTime = presentationTime;
+    event.argument = argument;
+    event.threadID = buffer->threadID;
+    buffer->count.store(index + 1, std::memory_order_release);      // publishes the event
+}
+
+static std::string escapedJSONString(const std::string &string)
+{
+    std::string escaped;
+    for (size_t i = 0; i < string.size(); i++) {
+        char c = string[i];
+        if (c == '"' || c == '\\') {
+            escaped.push_back('\\');
+            escaped.push_back(c);
+        } else if ((unsigned char)c >= 0x20) {
+            escaped.push_back(c);
+        }
+    }
+    return escaped;
+}
+
+bool TraceRecorder::writeChromeTrace(const std::string &path, std::string &error)
+{
+    std::vector<ThreadBuffer *> buffers;
+    std::vector<std::string> threadNames;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        buffers = _buffers;
+        threadNames = _threadNames;
+    }
+
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file) {
+        error = std::string("unable to create file: ") + strerror(errno);
+        return false;
+    }
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (size_t i = 0; i < threadNames.size(); i++) {
+        std::string name = threadNames[i].empty() ? "thread " + std::to_string(i) : threadNames[i];
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", i, escapedJSONString(name).c_str());
+        first = false;
+    }
+
+    std::vector<Event> events(EventsPerThread);
+    for (size_t i = 0; i < buffers.size(); i++) {
+        ThreadBuffer *buffer = buffers[i];
+        uint64_t end = buffer->count.load(std::memory_order_acquire);
+        uint64_t begin = end > EventsPerThread ? end - EventsPerThread : 0;
+        for (uint64_t j = begin; j < end; j++) {
+            events[j % EventsPerThread] = buffer->events[j % EventsPerThread];
+        }
+        // Skip the events that the thread may have overwritten (or begun to) while they were copied. As in a seqlock,
+        // the fence keeps the copy's plain loads from being reordered after the count is read again.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t endAfterCopying = buffer->count.load(std::memory_order_acquire);
+        if (endAfterCopying + 1 > EventsPerThread) {
+            begin = std::max(begin, endAfterCopying + 1 - EventsPerThread);
+        }
+
+        // Timestamps and durations are in microseconds
+        for (uint64_t j = begin; j < end; j++) {
+            const Event &event = events[j % EventsPerThread];
+            fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"wormassay\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+                    first ? "" : ",\n", event.name, event.threadID, event.startTime / 1000.0, event.duration / 1000.0);
+            first = false;
+            bool hasFrame = !isnan(event.presentationTime);
+            if (hasFrame) {
+                fprintf(file, "\"frame\":%.6f", event.presentationTime);
+            }
+            if (event.argumentName) {
+                fprintf(file, "%s\"%s\":%d", hasFrame ? "," : "", event.argumentName, event.argument);
+            }
+            fprintf(file, "}}");
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    if (fclose(file) != 0) {
+        error = std::string("unable to write file: ") + strerror(errno);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,106 @@
+//
+//  Tracing.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef Tracing_hpp
+#define Tracing_hpp
+
+#include <math.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records timed spans of work (e.g. a frame's conversion, or one well's analysis) so that they can be written out as a
+// Chrome trace (JSON that chrome://tracing and ui.perfetto.dev open) showing where the time went on each thread.
+// Recording is always on and cheap: each thread appends to its own ring buffer without locking, keeping its most
+// recent EventsPerThread spans. Buffers of threads that exit are reused by later threads, along with their thread IDs, so
+// the memory used is bounded by the most threads that have recorded spans at once. Thread-safe.
+class TraceRecorder {
+public:
+    enum {
+        EventsPerThread = 1 << 14
+    };
+
+    static TraceRecorder &sharedRecorder();
+
+    // Nanoseconds on a monotonic clock
+    static uint64_t now();
+
+    // Adds a span to the calling thread's buffer. name and argumentName must be string literals (or otherwise outlive
+    // the recorder). presentationTime is that of the frame being processed, or NAN, and argumentName is NULL if
+    // there is no argument.
+    void addSpan(const char *name, uint64_t startTime, uint64_t endTime, double presentationTime,
+                 const char *argumentName, int argument);
+
+    // Writes the spans currently recorded by every thread. Returns false and sets error on failure.
+    bool writeChromeTrace(const std::string &path, std::string &error);
+
+private:
+    struct Event {
+        const char *name;
+        const char *argumentName;
+        uint64_t startTime;
+        uint64_t duration;
+        double presentationTime;
+        int argument;
+        uint32_t threadID;
+    };
+
+    // Written only by the thread that holds it. Readers copy the events and then discard any that the writer may have
+    // overwritten meanwhile, as shown by the count.
+    struct ThreadBuffer {
+        ThreadBuffer() : count(0), threadID(0) {}
+
+        std::atomic<uint64_t> count;        // of events ever appended
+        uint32_t threadID;                  // the buffer's index
+        Event events[EventsPerThread];
+    };
+
+    friend struct ThreadBufferHolder;
+
+    TraceRecorder();
+    TraceRecorder(const TraceRecorder &);
+    TraceRecorder &operator=(const TraceRecorder &);
+
+    ThreadBuffer *acquireBuffer();
+    void relinquishBuffer(ThreadBuffer *buffer);
+
+    std::mutex _mutex;                      // for the following
+    std::vector<ThreadBuffer *> _buffers;   // all, never freed
+    std::vector<ThreadBuffer *> _freeBuffers;
+    std::vector<std::string> _threadNames;  // by thread ID, of the latest thread to hold each buffer
+};
+
+// Records a span from its construction to its destruction on the current thread, e.g.
+//     TraceSpan span("analyze well", presentationTime, "well", i);
+class TraceSpan {
+public:
+    explicit TraceSpan(const char *name, double presentationTime = NAN, const char *argumentName = NULL, int argument = 0)
+        : _name(name), _argumentName(argumentName), _argument(argument), _presentationTime(presentationTime),
+          _startTime(TraceRecorder::now())
+    {
+    }
+
+    ~TraceSpan()
+    {
+        TraceRecorder::sharedRecorder().addSpan(_name, _startTime, TraceRecorder::now(), _presentationTime, _argumentName, _argument);
+    }
+
+private:
+    TraceSpan(const TraceSpan &);
+    TraceSpan &operator=(const TraceSpan &);
+
+    const char *_name;
+    const char *_argumentName;
+    int _argument;
+    double _presentationTime;
+    uint64_t _startTime;
+};
+
+#endif
@@ -12,22 +12,68 @@
 #import <CoreGraphics/CoreGraphics.h>
 #import <opencv2/core/core_c.h>
 
+// Flips (mirrorings) of a frame, which may be combined. Both together are a 180 degree rotation.
+typedef enum {
+    VideoFrameFlipNone = 0,
+    VideoFrameFlipHorizontal = 1 << 0,
+    VideoFrameFlipVertical = 1 << 1
+} VideoFrameFlip;
+
 // A reference-counted wrapper over IplImage to avoid unnecessary memory copying during the image pipeline.
 // The backing store is guaranteed to be valid and its address unchanged during the lifetime of the VideoFrame,
 // however the actual graphical contents of the image may be modified (i.e. as part of the image pipeline)
 // via access to the underlying IplImage's bytes and thus instances of this class should be considered
 // *mutable* even if the properties themselves are not.
+// Frames copied from 422YpCbCr8 pixel buffers keep the native packed YpCbCr (UYVY) data, which is half the size of BGRA.
+// The BGRA image and the luma plane are each only generated (once) when first requested, so that frames which are only
+// measured by luminance, or are never displayed, never pay for the color conversion.
+// Images are checked out from and returned to the shared FrameBufferPool, so they must not be released by callers.
 @interface VideoFrame : NSObject <NSCopying> {
-    IplImage *_image;
+    IplImage *_image;               // BGRA, NULL until generated
+    IplImage *_lumaImage;           // NULL until generated
+    IplImage *_ypCbCrImage;         // packed UYVY (2 channels), NULL if the frame was created from BGRA
+    VideoFrameFlip _flip;
     NSTimeInterval _presentationTime;
+    NSUInteger _maximumConcurrency;
 }
 
 - (id)initWithIplImageTakingOwnership:(IplImage *)image presentationTime:(NSTimeInterval)presentationTime;
-// Generates BGRA IplImages, converting if necessary from 422YpCbCr8.
+// Takes ownership of any non-NULL images, at least one of BGRA or UYVY is required. flip is the flip already applied to
+// the images, e.g. when they are replayed from a FrameRecording.
+- (id)initWithImage:(IplImage *)image
+          lumaImage:(IplImage *)lumaImage
+        ypCbCrImage:(IplImage *)ypCbCrImage
+               flip:(VideoFrameFlip)flip
+   presentationTime:(NSTimeInterval)presentationTime;
+// Keeps 422YpCbCr8 data natively (unless it must be rescaled), otherwise generates BGRA IplImages. The copy, any
+// rescaling to the natural size (e.g. for anamorphic sources), and the flip are all done in a single pass, over up to
+// maximumConcurrency cores.
+- (id)initByCopyingCVPixelBuffer:(CVPixelBufferRef)cvPixelBuffer
+                     naturalSize:(NSSize)naturalSize
+                            flip:(VideoFrameFlip)flip
+              maximumConcurrency:(NSUInteger)maximumConcurrency
+                presentationTime:(NSTimeInterval)presentationTime;
 - (id)initByCopyingCVPixelBuffer:(CVPixelBufferRef)cvPixelBuffer naturalSize:(NSSize)naturalSize presentationTime:(NSTimeInterval)presentationTime;
 
-@property(readonly) IplImage *image;
+@property(readonly) CvSize size;        // does not generate any image
 @property(readonly) NSTimeInterval presentationTime;
+// The number of cores that the frame's conversions are spread over, e.g. the share of the processor analyzing it (see
+// CoreBudget.hpp). Every processor by default.
+@property NSUInteger maximumConcurrency;
+
+// BGRA, converted from YpCbCr on first access if necessary. Thread-safe.
+@property(readonly) IplImage *image;
+// 8-bit luminance. For YpCbCr frames this is the Y' plane (in the same pixel order as -image), otherwise it is converted
+// from -image. Generated on first access. Thread-safe.
+@property(readonly) IplImage *lumaImage;
+// The native image of the frame: packed UYVY if the frame was copied from 422YpCbCr8, otherwise BGRA. Thread-safe.
+@property(readonly) IplImage *nativeImage;
+
+// The flips applied to the frame since it was captured
+@property(readonly) VideoFrameFlip flip;
+// Flips all of the frame's representations in place, combining it with the frame's flip. Use this rather than
+// modifying -image directly, since changes to one representation are not reflected in the others.
+- (void)applyFlip:(VideoFrameFlip)flip;
 
 // Note that these methods return objects that share the mutable data underlying the callee, and not copies of it.
 // They will retain the callee during its lifetime to ensure the backing store remains valid.
@@ -8,13 +8,23 @@
 
 #import "VideoFrame.h"
 #import <opencv2/imgproc/imgproc_c.h>
+#import "FrameBufferPool.hpp"
+#import "YpCbCrConversion.hpp"
+#import "FrameIngest.hpp"
+#import "CvUtilities.hpp"
+#import "Tracing.hpp"
+#import "TaskScheduler.h"
 
-static void YpCbCr422toBGRA8(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height);
+static const int MinimumRowsPerStripe = 128;
+
+static int cvFlipModeForFlip(VideoFrameFlip flip);
+static void performInParallelRowStripes(int rows, NSUInteger maximumConcurrency, void (^block)(int firstRow, int rowCount));
+static void YpCbCr422toBGRA8(const IplImage *src, IplImage *dest, NSUInteger maximumConcurrency);
 
 @implementation VideoFrame
 
-@synthesize image = _image;
 @synthesize presentationTime = _presentationTime;
+@synthesize maximumConcurrency = _maximumConcurrency;
 
 - (id)initWithIplImageTakingOwnership:(IplImage *)image presentationTime:(NSTimeInterval)presentationTime
 {
@@ -22,22 +32,68 @@ static void YpCbCr422toBGRA8(uint8_t *src, uint8_t *dest, uint32_t width, uint32
         NSAssert(image, @"image is required");
         _image = image;
         _presentationTime = presentationTime;
+        _maximumConcurrency = [[NSProcessInfo processInfo] activeProcessorCount];
+    }
+    return self;
+}
+
+- (id)initWithImage:(IplImage *)image
+          lumaImage:(IplImage *)lumaImage
+        ypCbCrImage:(IplImage *)ypCbCrImage
+               flip:(VideoFrameFlip)flip
+   presentationTime:(NSTimeInterval)presentationTime
+{
+    if ((self = [super init])) {
+        NSAssert(image || ypCbCrImage, @"image is required");
+        _image = image;
+        _lumaImage = lumaImage;
+        _ypCbCrImage = ypCbCrImage;
+        _flip = flip;
+        _presentationTime = presentationTime;
+        _maximumConcurrency = [[NSProcessInfo processInfo] activeProcessorCount];
     }
     return self;
 }
 
 - (void)dealloc
 {
-    cvReleaseImage(&_image);
+    FrameBufferPool &pool = FrameBufferPool::sharedPool();
+    pool.releaseImage(&_image);
+    pool.releaseImage(&_lumaImage);
+    pool.releaseImage(&_ypCbCrImage);
 }
 
 - (id)copyWithZone:(NSZone *)zone
 {
-    return [[[self class] alloc] initWithIplImageTakingOwnership:cvCloneImage(_image) presentationTime:_presentationTime];
+    // Copy only the representations that already exist
+    FrameBufferPool &pool = FrameBufferPool::sharedPool();
+    @synchronized (self) {
+        VideoFrame *copy = [[[self class] alloc] initWithImage:_image ? pool.cloneImage(_image) : NULL
+                                                     lumaImage:_lumaImage ? pool.cloneImage(_lumaImage) : NULL
+                                                   ypCbCrImage:_ypCbCrImage ? pool.cloneImage(_ypCbCrImage) : NULL
+                                                          flip:_flip
+                                              presentationTime:_presentationTime];
+        [copy setMaximumConcurrency:[self maximumConcurrency]];
+        return copy;
+    }
 }
 
 - (id)initByCopyingCVPixelBuffer:(CVPixelBufferRef)cvPixelBuffer naturalSize:(NSSize)naturalSize presentationTime:(NSTimeInterval)presentationTime
 {
+    return [self initByCopyingCVPixelBuffer:cvPixelBuffer
+                                naturalSize:naturalSize
+                                       flip:VideoFrameFlipNone
+                         maximumConcurrency:[[NSProcessInfo processInfo] activeProcessorCount]
+                           presentationTime:presentationTime];
+}
+
+- (id)initByCopyingCVPixelBuffer:(CVPixelBufferRef)cvPixelBuffer
+                     naturalSize:(NSSize)naturalSize
+                            flip:(VideoFrameFlip)flip
+              maximumConcurrency:(NSUInteger)maximumConcurrency
+                presentationTime:(NSTimeInterval)presentationTime
+{
+    TraceSpan span("ingest", presentationTime);
     CVPixelBufferLockBaseAddress(cvPixelBuffer, kCVPixelBufferLock_ReadOnly);    
     
     OSType formatType = CVPixelBufferGetPixelFormatType(cvPixelBuffer);
@@ -46,41 +102,150 @@ static void YpCbCr422toBGRA8(uint8_t *src, uint8_t *dest, uint32_t width, uint32
     int height = (int)CVPixelBufferGetHeight(cvPixelBuffer);
     int bytesPerRow = (int)CVPixelBufferGetBytesPerRow(cvPixelBuffer);
     
+    FrameBufferPool &pool = FrameBufferPool::sharedPool();
     IplImage *iplImage = NULL;
+    IplImage *ypCbCrImage = NULL;
     
+    int channels = 0;
     if (formatType == kCVPixelFormatType_422YpCbCr8) {
-        iplImage = cvCreateImage(cvSize(width, height), IPL_DEPTH_8U, 4);   // BGRA
-        YpCbCr422toBGRA8((uint8_t *)baseAddress, (uint8_t *)iplImage->imageData, width, height);
+        channels = 2;       // UYVY
     } else if (formatType == kCVPixelFormatType_32BGRA) {
-        // Create a header to hold the source image
-        IplImage *iplImageHeader = cvCreateImageHeader(cvSize(width, height), IPL_DEPTH_8U, 4);
-        iplImageHeader->widthStep = bytesPerRow;
-        iplImageHeader->imageSize = bytesPerRow * height;
-        iplImageHeader->imageData = iplImageHeader->imageDataOrigin = (char *)baseAddress;
-        
-        iplImage = cvCloneImage(iplImageHeader);
-        
-        cvReleaseImageHeader(&iplImageHeader);
+        channels = 4;
     }
-    NSAssert(iplImage, @"invalid format");
+    NSAssert(channels, @"invalid format");
     
-    CVPixelBufferUnlockBaseAddress(cvPixelBuffer, kCVPixelBufferLock_ReadOnly);
+    // Create a header to hold the source image
+    IplImage *iplImageHeader = cvCreateImageHeader(cvSize(width, height), IPL_DEPTH_8U, channels);
+    iplImageHeader->widthStep = bytesPerRow;
+    iplImageHeader->imageSize = bytesPerRow * height;
+    iplImageHeader->imageData = iplImageHeader->imageDataOrigin = (char *)baseAddress;
     
-    // Rescale the image if necessary in case the camera source is anamorphic
+    // Rescale the image if necessary in case the camera source is anamorphic. YpCbCr is converted to BGRA in that case
+    // since its chroma is shared between pixel pairs.
+    CvSize size = cvSize(width, height);
     if (naturalSize.width > 0 && (width != naturalSize.width || height != naturalSize.height)) {
-        IplImage *resizedImage = cvCreateImage(cvSize(naturalSize.width, naturalSize.height), iplImage->depth, iplImage->nChannels);
+        size = cvSize(naturalSize.width, naturalSize.height);
+    }
+    BOOL resize = !sizeEqualsSize(size, cvSize(width, height));
+    bool flipHorizontally = flip & VideoFrameFlipHorizontal;
+    bool flipVertically = flip & VideoFrameFlipVertical;
+    
+    if (!resize || canIngestImageByRows(cvSize(width, height), size)) {
+        // Copy, convert, resize and flip in a single pass over parallel row stripes
+        IplImage *destImage = pool.createImage(size, IPL_DEPTH_8U, resize ? 4 : channels);
+        performInParallelRowStripes(height, maximumConcurrency, ^(int firstRow, int rowCount) {
+            ingestImageRows(iplImageHeader, destImage, flipHorizontally, flipVertically, firstRow, rowCount);
+        });
+        if (destImage->nChannels == 2) {
+            ypCbCrImage = destImage;
+        } else {
+            iplImage = destImage;
+        }
+    } else {
+        // The height changes, so perform each step over the whole image
+        if (channels == 2) {
+            iplImage = pool.createImage(cvSize(width, height), IPL_DEPTH_8U, 4);   // BGRA
+            YpCbCr422toBGRA8(iplImageHeader, iplImage, maximumConcurrency);
+        } else {
+            iplImage = pool.cloneImage(iplImageHeader);
+        }
+        IplImage *resizedImage = pool.createImage(size, iplImage->depth, iplImage->nChannels);
         cvResize(iplImage, resizedImage, CV_INTER_AREA);
-        cvReleaseImage(&iplImage);
+        pool.releaseImage(&iplImage);
         iplImage = resizedImage;
+        if (flip != VideoFrameFlipNone) {
+            cvFlip(iplImage, NULL, cvFlipModeForFlip(flip));
+        }
     }
+    cvReleaseImageHeader(&iplImageHeader);
     
-    return [self initWithIplImageTakingOwnership:iplImage presentationTime:presentationTime];
+    CVPixelBufferUnlockBaseAddress(cvPixelBuffer, kCVPixelBufferLock_ReadOnly);
+    
+    if ((self = [self initWithImage:iplImage lumaImage:NULL ypCbCrImage:ypCbCrImage flip:flip presentationTime:presentationTime])) {
+        _maximumConcurrency = maximumConcurrency;
+    }
+    return self;
+}
+
+- (CvSize)size
+{
+    return cvGetSize(_ypCbCrImage ? _ypCbCrImage : _image);      // neither changes after init
+}
+
+- (IplImage *)image
+{
+    @synchronized (self) {
+        if (!_image) {
+            TraceSpan span("convert to BGRA", _presentationTime);
+            _image = FrameBufferPool::sharedPool().createImage(cvGetSize(_ypCbCrImage), IPL_DEPTH_8U, 4);   // BGRA
+            YpCbCr422toBGRA8(_ypCbCrImage, _image, [self maximumConcurrency]);
+        }
+        return _image;
+    }
+}
+
+- (IplImage *)lumaImage
+{
+    @synchronized (self) {
+        if (!_lumaImage) {
+            TraceSpan span("extract luma", _presentationTime);
+            _lumaImage = FrameBufferPool::sharedPool().createImage([self size], IPL_DEPTH_8U, 1);
+            if (_ypCbCrImage) {
+                extractYpCbCr422Luma8(_ypCbCrImage, _lumaImage);
+            } else {
+                cvCvtColor(_image, _lumaImage, _image->nChannels == 4 ? CV_BGRA2GRAY : CV_BGR2GRAY);
+            }
+        }
+        return _lumaImage;
+    }
+}
+
+- (IplImage *)nativeImage
+{
+    @synchronized (self) {
+        return _ypCbCrImage ? _ypCbCrImage : _image;
+    }
+}
+
+- (VideoFrameFlip)flip
+{
+    @synchronized (self) {
+        return _flip;
+    }
+}
+
+- (void)applyFlip:(VideoFrameFlip)flip
+{
+    if (flip == VideoFrameFlipNone) {
+        return;
+    }
+    TraceSpan span("flip", _presentationTime);
+    int flipMode = cvFlipModeForFlip(flip);
+    
+    @synchronized (self) {
+        if (_image) {
+            cvFlip(_image, NULL, flipMode);
+        }
+        if (_lumaImage) {
+            cvFlip(_lumaImage, NULL, flipMode);
+        }
+        if (_ypCbCrImage) {
+            if (flip & VideoFrameFlipHorizontal) {
+                flipYpCbCr422Horizontally(_ypCbCrImage);
+            }
+            if (flip & VideoFrameFlipVertical) {
+                cvFlip(_ypCbCrImage, NULL, 0);      // vertical flip just swaps rows
+            }
+        }
+        _flip = (VideoFrameFlip)(_flip ^ flip);
+    }
 }
 
 - (NSData *)imageData
 {
-    return [[NSData alloc] initWithBytesNoCopy:_image->imageData
-                                        length:_image->imageSize
+    IplImage *image = [self image];
+    return [[NSData alloc] initWithBytesNoCopy:image->imageData
+                                        length:image->imageSize
                                    deallocator:^(void *bytes, NSUInteger length) {
         // explicitly retain self (by calling a pointless method) so we can ensure that the backing
         // bytes are extant during the lifetime of the returned NSData even if they are mutable
@@ -90,10 +255,12 @@ static void YpCbCr422toBGRA8(uint8_t *src, uint8_t *dest, uint32_t width, uint32
 
 - (CGImageRef)createCGImage
 {
+    IplImage *image = [self image];
+    
     // Generate the bitmap info:
     // OpenCV uses BGRA, so tell CG to use XRGB in little endian mode to reverse it
     CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Little;
-    if (_image->nChannels == 4) {
+    if (image->nChannels == 4) {
         bitmapInfo |= kCGImageAlphaNoneSkipFirst; // can ignore the alpha channel when present since it is not used here
     } else {
         bitmapInfo |= kCGImageAlphaNone;
@@ -104,11 +271,11 @@ static void YpCbCr422toBGRA8(uint8_t *src, uint8_t *dest, uint32_t width, uint32
     
     // Create the data provider (this does not retain the VideoFrame so must only be local in scope)
     CGDataProviderRef dataProvider = CGDataProviderCreateWithCFData((CFDataRef)[self imageData]);
-    CGImageRef cgImage = CGImageCreate(_image->width,
-                                       _image->height,
-                                       _image->depth,
-                                       _image->depth * _image->nChannels,
-                                       _image->widthStep,
+    CGImageRef cgImage = CGImageCreate(image->width,
+                                       image->height,
+                                       image->depth,
+                                       image->depth * image->nChannels,
+                                       image->widthStep,
                                        colorSpace,
                                        bitmapInfo,
                                        dataProvider,
@@ -125,37 +292,36 @@ static void YpCbCr422toBGRA8(uint8_t *src, uint8_t *dest, uint32_t width, uint32
 @end
 
 
-// cb and cr are - 128 here
-#define YpCbCr2RGB(y, cb, cr, r, g, b)\
-r = y + ((cr * 1404) >> 10);\
-g = y - ((cr * 715 + cb * 344) >> 10);\
-b = y + ((cb * 1774) >> 10);\
-r = r < 0 ? 0 : r;\
-g = g < 0 ? 0 : g;\
-b = b < 0 ? 0 : b;\
-r = r > 255 ? 255 : r;\
-g = g > 255 ? 255 : g;\
-b = b > 255 ? 255 : b
-
-static void YpCbCr422toBGRA8(uint8_t *src, uint8_t *dest, uint32_t width, uint32_t height) {
-    // Byte order UYVY
-    int j = 0, i = 0;
-    const int srcMax = (width * height) * 2;
-    while (i < srcMax) {
-        int cb = (uint8_t)src[i++] - 128;
-        int y0 = (uint8_t)src[i++];
-        int cr = (uint8_t)src[i++] - 128;
-        int y1 = (uint8_t)src[i++];
-        int r, g, b;
-        YpCbCr2RGB(y1, cb, cr, r, g, b);
-        dest[j++] = b;
-        dest[j++] = g;
-        dest[j++] = r;
-        dest[j++] = 255;        // a
-        YpCbCr2RGB(y0, cb, cr, r, g, b);
-        dest[j++] = b;
-        dest[j++] = g;
-        dest[j++] = r;
-        dest[j++] = 255;        // a
+// Returns the flipMode argument to cvFlip() for a flip other than VideoFrameFlipNone
+static int cvFlipModeForFlip(VideoFrameFlip flip)
+{
+    switch (flip) {
+        case VideoFrameFlipHorizontal:
+            return 1;
+        case VideoFrameFlipVertical:
+            return 0;
+        default:
+            return -1;
     }
 }
+
+// Divides the rows into stripes of at least MinimumRowsPerStripe, up to one per core, and processes them in parallel
+static void performInParallelRowStripes(int rows, NSUInteger maximumConcurrency, void (^block)(int firstRow, int rowCount))
+{
+    NSUInteger stripes = MAX(MIN(maximumConcurrency, (NSUInteger)(rows / MinimumRowsPerStripe)), (NSUInteger)1);
+    [[TaskScheduler sharedScheduler] performInParallelWithInstances:stripes
+                                                 maximumConcurrency:stripes
+                                                           priority:TaskPriorityAnalysis
+                                                              block:^(NSUInteger i, id criticalSection) {
+        int firstRow = (int)(rows * i / stripes);
+        int endRow = (int)(rows * (i + 1) / stripes);
+        block(firstRow, endRow - firstRow);
+    }];
+}
+
+static void YpCbCr422toBGRA8(const IplImage *src, IplImage *dest, NSUInteger maximumConcurrency)
+{
+    performInParallelRowStripes(src->height, maximumConcurrency, ^(int firstRow, int rowCount) {
+        convertYpCbCr422ToBGRA8(src, dest, firstRow, rowCount);
+    });
+}
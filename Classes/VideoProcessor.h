@@ -8,18 +8,13 @@
 
 #import <Foundation/Foundation.h>
 #import <opencv2/core/core_c.h>
+#import "VideoFrame.h"
 
-@class VideoFrame;
+@class DebugFrame;
 @class PlateData;
 @protocol VideoProcessorDelegate;
 @protocol VideoProcessorRecordingDelegate;
 
-typedef enum {
-    ProcessingStateNoPlate,
-    ProcessingStatePlateFirstFrameIdentified,
-    ProcessingStateTrackingMotion
-} ProcessingState;
-
 typedef enum {
     PlateOrientationTopRead,
     PlateOrientationTopRead180DegreeRotated,
@@ -41,20 +36,59 @@ FOUNDATION_EXPORT CGAffineTransform TransformForPlateOrientation(PlateOrientatio
 - (id)initWithFileOutputDelegate:(id<VideoProcessorRecordingDelegate>)fileOutputDelegate
            fileSourceDisplayName:(NSString *)fileSourceDisplayName;     // for data labeling of file sources, pass nil if this is live
 @property(readonly) NSString *fileSourceDisplayName;       // nil if a device source
+@property(copy) NSString *displayName;      // the source's name (e.g. the camera's), for logging
+// For file sources analyzed faster than real time. Frames' presentation times are then media times, and well finding is
+// done synchronously so that the results don't depend on the decoding speed. Set before processing any frames.
+@property BOOL batchMode;
 
 - (void)setDelegate:(id<VideoProcessorDelegate>)delegate;
 
 - (void)setAssayAnalyzerClass:(Class)assayAnalyzerClass;
 - (void)setPlateOrientation:(PlateOrientation)plateOrietation;
+// The flip for the current plate orientation, which frames should be ingested with (see VideoFrame) to avoid a
+// separate flip. Frames ingested with a different flip are still corrected. If the "OrientPlateGeometrically" default
+// is set when the processor is created, frames are never flipped. Instead the orientation is applied to the order of
+// the wells, which are analyzed and drawn in the frame's native coordinates.
+- (VideoFrameFlip)currentFrameFlip;
+// The number of cores that each frame's work is spread over, i.e. the plate's share (see CoreBudget.hpp), which frames
+// should be ingested with (see VideoFrame)
+- (NSUInteger)coreShare;
 
 - (void)setShouldScanForWells:(BOOL)shouldScanForWells;
 - (void)reportFinalResultsBeforeRemoval;
 - (void)manuallyReportResultsAndReset;
 
-// Synchronously processes a video frame (e.g. at frame rate)
-- (void)processVideoFrame:(VideoFrame *)videoFrame debugFrameCallback:(void (^)(VideoFrame *image))callback;    // callback will be called on a background queue
+// Returns whether a frame delivered by the source at the given time (e.g. its sample buffer's presentation timestamp)
+// should be processed. Must be called for every frame, in order. When processing can't keep up with the source, the
+// frames are decimated uniformly to a rate that can be sustained, rather than dropping whichever frames arrive while
+// the pipeline is busy. Skipped frames are not counted as dropped.
+- (BOOL)shouldProcessFrameArrivingAtTime:(NSTimeInterval)sourceTime;
+
+// Enqueues a video frame on the processing pipeline (geometry, analysis, then overlay stages), blocking until the first
+// stage has room for it (e.g. at frame rate). Frames are analyzed in order, one at a time. The callback is passed the
+// frame with its debugging overlay. If the callback is nil (e.g. nothing is displayed), no debug drawing is done.
+- (void)processVideoFrame:(VideoFrame *)videoFrame debugFrameCallback:(void (^)(DebugFrame *debugFrame))callback;    // callback will be called on a background queue
+// The completion is called on a background queue once the frame has left the pipeline
+- (void)processVideoFrame:(VideoFrame *)videoFrame
+       debugFrameCallback:(void (^)(DebugFrame *debugFrame))callback
+               completion:(void (^)(void))completion;
+// Blocks until every frame enqueued so far has left the pipeline
+- (void)waitUntilAllFramesAreProcessed;
 - (void)noteVideoFrameWasDropped;
 
+// Records each frame exactly as it is analyzed (i.e. after conversion and flipping) with its presentation time, and each
+// dropped frame, to a frame recording (see FrameRecording.hpp) that can be replayed deterministically. Replaces any
+// recording in progress. The recording is closed when the processor is deallocated.
+- (BOOL)beginRecordingFramesToPath:(NSString *)path error:(NSError **)outError;
+
+// The rate at which the plate being tracked is being analyzed, the proportion of frames dropped and the plate's share of
+// the cores (see CoreBudget.hpp), or nil if no plate is being tracked
+- (NSString *)throughputSummary;
+
+// Writes the spans of work recently done by every processor, e.g. each frame's pipeline stages and wells, as a Chrome
+// trace (see Tracing.hpp) that chrome://tracing or ui.perfetto.dev can open
++ (BOOL)writePerformanceTraceToPath:(NSString *)path error:(NSError **)outError;
+
 @end
 
 
@@ -12,7 +12,17 @@
 #import "PlateData.h"
 #import "AssayAnalyzer.h"
 #import "WellFinding.hpp"
+#import "PlateTracker.hpp"
+#import "FrameBufferPool.hpp"
+#import "DebugOverlay.hpp"
+#import "DebugFrame.h"
 #import "NSOperationQueue-Utility.h"
+#import "TaskScheduler.h"
+#import "Tracing.hpp"
+#import "FramePipelineStage.h"
+#import "AnalysisRateScheduler.hpp"
+#import "FrameRecording.hpp"
+#import "CoreBudget.hpp"
 #import "VideoProcessorController.h"   // for RunLog()
 #import <Vision/Vision.h>
 // OpenCV
@@ -26,20 +36,30 @@
 #endif
 
 
-static const NSTimeInterval MinimumWellMatchTimeToBeginTracking = 0.500; // 500 ms
 static const NSTimeInterval BarcodeScanningPeriod = 0.5;
 static const NSTimeInterval BarcodeRepeatSuccessCount = 3;      // to avoid incidental capture
 static const NSTimeInterval PresentationTimeDistantPast = -DBL_MAX;
-static const double WellDetectingAverageDeltaEndIdleThreshold = 5.0;
+static const double WellDetectingAverageLumaDeltaEndIdleThreshold = 2.0;
 static const NSTimeInterval WellDetectingUnconditionalSearchPeriod = 10.0;
 
 // Time lapse defaults keys
+// If set, frames are not flipped for the plate orientation, and the well order is flipped instead
+static NSString *const OrientPlateGeometricallyKey = @"OrientPlateGeometrically";
 static NSString *const TimeLapseAnalyzeEnabled = @"TimeLapseAnalyzeEnabled";
 static NSString *const TimeLapseAnalyzeDuration = @"TimeLapseAnalyzeDuration";
 static NSString *const TimeLapseLockoutInterval = @"TimeLapseLockoutInterval";
 static const NSTimeInterval TimeLapseAnalyzeDurationDefault = 60.0;
 static const NSTimeInterval TimeLapseLockoutIntervalDefault = 5 * 60.0;
 
+// Stage timings carried along with a frame through the pipeline
+struct FrameTimes {
+    NSTimeInterval processingStartTime;
+    NSTimeInterval flipTime;
+    NSTimeInterval overlayTime;
+    NSTimeInterval geometryStageTime;
+    NSTimeInterval analysisStageTime;
+};
+
 
 CGAffineTransform TransformForPlateOrientation(PlateOrientation plateOrientation)
 {
@@ -62,38 +82,61 @@ CGAffineTransform TransformForPlateOrientation(PlateOrientation plateOrientation
     return transform;
 }
 
+// The same as TransformForPlateOrientation()
+static VideoFrameFlip FlipForPlateOrientation(PlateOrientation plateOrientation)
+{
+    switch (plateOrientation) {
+        case PlateOrientationTopRead:
+        case PlateOrientationNoWells:
+            return VideoFrameFlipNone;
+        case PlateOrientationTopRead180DegreeRotated:
+            return (VideoFrameFlip)(VideoFrameFlipHorizontal | VideoFrameFlipVertical);
+        case PlateOrientationBottomRead:
+            return VideoFrameFlipHorizontal;
+        case PlateOrientationBottomRead180DegreeRotated:
+            return VideoFrameFlipVertical;
+    }
+    return VideoFrameFlipNone;
+}
+
 
 // Here for C++ build safety
 @interface VideoProcessor() {
     __weak id<VideoProcessorDelegate> _delegate;                        // not retained
     __weak id<VideoProcessorRecordingDelegate> _fileOutputDelegate;     // not retained
     NSString *_fileSourceDisplayName;
+    NSString *_displayName;
     Class _assayAnalyzerClass;
     PlateOrientation _plateOrientation;
+    BOOL _orientsGeometrically;
+    BOOL _batchMode;
     NSURL *_fileOutputURL;
     
     BOOL _shouldScanForWells;
     BOOL _scanningForWells;
     BOOL _scanningForBarcodes;
+    __weak NSOperation *_wellFindingTask;       // the last scheduled, for cancellation while pending (not retained,
+    __weak NSOperation *_barcodeReadingTask;    // since the tasks retain self)
     
-    ProcessingState _processingState;
-    int _wellCountHint;
-    CvScalar _lastWellAnalyzedFrameAverageValues;
-    NSTimeInterval _firstWellFrameTime;     // not the beginning of tracking
+    PlateTracker _plateTracker;
+    double _lastWellAnalyzedFrameAverageLuma;
     NSTimeInterval _lastBarcodeScanTime;
-    NSTimeInterval _lastWellAnalysisBeginTime;  // the last time a well finding analysis was started. used to do idling when no plates present.
-    // These two are used only for the optional time lapse feature
-    NSTimeInterval _startOfTrackingFrameTime;
-    NSTimeInterval _lockoutStartFrameTime;
+    NSTimeInterval _lastWellAnalysisBeginTime;  // the last time a well finding analysis was started (the presentation time in batch mode). used to do idling when no plates present.
     
     id<AssayAnalyzer> _assayAnalyzer;
     PlateData *_plateData;
-    std::vector<Circle> _trackingWellCircles;    // circles used for tracking
     CvSize _trackedImageSize;
-    std::vector<Circle> _lastCircles;       // the last circles returned by the well finder (not necessarily same as tracking)
     
     NSString *_lastBarcodeThisProcessor;
     NSUInteger _lastBarcodeThisProcessorRepeatCount;
+    
+    AnalysisRateScheduler _analysisRateScheduler;
+    FrameRecordingWriter _frameRecordingWriter;     // thread-safe; writes nothing unless opened
+    
+    // Frames pass through these in order. Each holds one frame at a time, so successive frames overlap in different stages.
+    FramePipelineStage *_geometryStage;
+    FramePipelineStage *_analysisStage;
+    FramePipelineStage *_overlayStage;
 }
 
 @end
@@ -102,6 +145,8 @@ CGAffineTransform TransformForPlateOrientation(PlateOrientation plateOrientation
 @implementation VideoProcessor
 
 @synthesize fileSourceDisplayName = _fileSourceDisplayName;
+@synthesize displayName = _displayName;
+@synthesize batchMode = _batchMode;
 
 - (id)initWithFileOutputDelegate:(id<VideoProcessorRecordingDelegate>)fileOutputDelegate
            fileSourceDisplayName:(NSString *)fileSourceDisplayName
@@ -110,7 +155,11 @@ CGAffineTransform TransformForPlateOrientation(PlateOrientation plateOrientation
         _fileOutputDelegate = fileOutputDelegate;
         _fileSourceDisplayName = [fileSourceDisplayName copy];
         _lastWellAnalysisBeginTime = PresentationTimeDistantPast;
-        _lockoutStartFrameTime = PresentationTimeDistantPast;
+        _orientsGeometrically = [[NSUserDefaults standardUserDefaults] boolForKey:OrientPlateGeometricallyKey];
+        
+        _geometryStage = [[FramePipelineStage alloc] initWithName:@"geometry-stage" capacity:1];
+        _analysisStage = [[FramePipelineStage alloc] initWithName:@"analysis-stage" capacity:1];
+        _overlayStage = [[FramePipelineStage alloc] initWithName:@"overlay-stage" capacity:1];
     }
     return self;
 }
@@ -142,23 +191,65 @@ CGAffineTransform TransformForPlateOrientation(PlateOrientation plateOrientation
     };
 }
 
+- (VideoFrameFlip)currentFrameFlip
+{
+    @synchronized (self) {
+        return _orientsGeometrically ? VideoFrameFlipNone : FlipForPlateOrientation(_plateOrientation);
+    }
+}
+
+- (NSUInteger)coreShare
+{
+    return CoreBudget::sharedBudget().shareForClient((__bridge void *)self);
+}
+
 - (void)setShouldScanForWells:(BOOL)shouldScanForWells
 {
     @synchronized (self) {
         _shouldScanForWells = shouldScanForWells;
-        // If no longer scanning (e.g. another camera has a plate), reset our state
+        // If no longer scanning (e.g. another camera has a plate), reset our state and skip any pending search
         if (!shouldScanForWells) {
             [self resetCaptureStateAndReportResults];
+            [_wellFindingTask cancel];
         }
     };
 }
 
-- (void)processVideoFrame:(VideoFrame *)videoFrame debugFrameCallback:(void (^)(VideoFrame *image))callback
+- (BOOL)shouldProcessFrameArrivingAtTime:(NSTimeInterval)sourceTime
+{
+    @synchronized (self) {
+        return _analysisRateScheduler.shouldAnalyzeFrame(sourceTime);
+    }
+}
+
+- (void)processVideoFrame:(VideoFrame *)videoFrame debugFrameCallback:(void (^)(DebugFrame *debugFrame))callback
+{
+    [self processVideoFrame:videoFrame debugFrameCallback:callback completion:nil];
+}
+
+- (void)processVideoFrame:(VideoFrame *)videoFrame
+       debugFrameCallback:(void (^)(DebugFrame *debugFrame))callback
+               completion:(void (^)(void))completion
 {
-    NSTimeInterval processingStartTime = CACurrentMediaTime();
-    VideoFrame *debugFrame;
+    // This method blocks until the geometry stage can take the frame, so that we don't enqueue frames faster than they
+    // can be processed. The document will drop the overflow.
+    [videoFrame setMaximumConcurrency:[self coreShare]];       // e.g. for frames replayed from a recording
+    [_geometryStage addFrameOperationWithBlock:^{
+        [self performGeometryStageWithFrame:videoFrame debugFrameCallback:callback completion:completion];
+    }];
+}
+
+// Called on the geometry stage. Flips the frame, schedules barcode reading and well finding, and draws the well circles
+// and labels on the debug overlay so that they appear underneath the analyzers' drawing.
+- (void)performGeometryStageWithFrame:(VideoFrame *)videoFrame
+                   debugFrameCallback:(void (^)(DebugFrame *debugFrame))callback
+                           completion:(void (^)(void))completion
+{
+    uint64_t traceStartTime = TraceRecorder::now();
+    FrameTimes times;
+    times.processingStartTime = CACurrentMediaTime();
     
-    // This method is synchronous so that we don't enqueue frames faster than they should be processed. The document will drop the overflow.
+    VideoFrameFlip flip;
     @synchronized (self) {
         if (_plateData) {
             [_plateData incrementReceivedFrameCount];
@@ -166,180 +257,334 @@ CGAffineTransform TransformForPlateOrientation(PlateOrientation plateOrientation
         
         // Always look for barcodes since another camera might have a plate. Do this before rotating/flipping
         // since barcode stickers should always be plainly visible by a camera (except simple rotation may be needed.)
-        if (!_scanningForBarcodes && _lastBarcodeScanTime < [videoFrame presentationTime] - BarcodeScanningPeriod) {
+        // If the background share of the cores is in use, try again with the next frame.
+        if (!_scanningForBarcodes && _lastBarcodeScanTime < [videoFrame presentationTime] - BarcodeScanningPeriod &&
+            CoreBudget::sharedBudget().tryBeginBackgroundTask()) {
             _scanningForBarcodes = YES;
-            VideoFrame *copy = [videoFrame copy];       // copy prior to dispatching since we are going to flip the data below
-            // Perform the calculation on a concurrent queue so that we don't block the current thread
-            [NSOperationQueue addOperationToGlobalQueueWithBlock:^{
-                [self performBarcodeReadingSynchronouslyWithFrame:copy];
+            VideoFrame *copy = [videoFrame copy];       // copy prior to dispatching since we may flip the data below
+            // Perform the calculation in the background so that we don't block the current thread
+            _barcodeReadingTask = [[TaskScheduler sharedScheduler] addTaskWithPriority:TaskPriorityBarcode block:^(BOOL cancelled) {
+                if (cancelled) {
+                    @synchronized (self) {
+                        _scanningForBarcodes = NO;
+                    }
+                } else {
+                    [copy applyFlip:[copy flip]];           // undo any flip made at ingest
+                    [self performBarcodeReadingSynchronouslyWithFrame:copy];
+                }
+                CoreBudget::sharedBudget().endBackgroundTask();
             }];
         }
         
-        // Flip/rotate image if necessary
-        BOOL flip = NO;
-        int flipMode;
-        switch (_plateOrientation) {
-            case PlateOrientationTopRead:
-            case PlateOrientationNoWells:
-                break;
-            case PlateOrientationTopRead180DegreeRotated:
-                flip = YES;
-                flipMode = -1;
-                break;
-            case PlateOrientationBottomRead:
-                flip = YES;
-                flipMode = 1;
-                break;
-            case PlateOrientationBottomRead180DegreeRotated:
-                flip = YES;
-                flipMode = 0;
-                break;
-        }
-        if (flip) {
-            cvFlip([videoFrame image], NULL, flipMode);
-        }
-        
-        // If we're not already searching for wells, and no other processor has a plate, schedule an async processing
+        // Frames are normally flipped as they are ingested (see -currentFrameFlip), so only correct the flip of frames
+        // that were ingested before the orientation changed
+        flip = (VideoFrameFlip)([self currentFrameFlip] ^ [videoFrame flip]);
+    }
+    
+    // Flip/rotate image if necessary
+    NSTimeInterval flipStartTime = CACurrentMediaTime();
+    [videoFrame applyFlip:flip];
+    times.flipTime = CACurrentMediaTime() - flipStartTime;
+    
+    // Record the frame as it will be analyzed, in its native representation so that it replays bit-for-bit. This only
+    // copies the frame; the writer thread writes it to disk.
+    _frameRecordingWriter.appendFrame([videoFrame nativeImage], [videoFrame flip], [videoFrame presentationTime]);
+    
+    void (^wellDeterminationBlock)(void) = nil;
+    TaskPriority wellFindingPriority = TaskPriorityDetection;
+    BOOL drawCircles;
+    std::vector<Circle> circles;
+    CvScalar circleColor;
+    BOOL circleLabels;
+    NSMutableString *barcodeAndOrTimeText = [NSMutableString string];
+    @synchronized (self) {
+        // If we're not already searching for wells, and no other processor has a plate (unless several plates are
+        // tracked at once), schedule an async processing
         if (!_scanningForWells && _shouldScanForWells) {
             // See if this plate looks grossly different from the last one we scanned.
             // If so, scan immediately, otherwise conserve CPU by scanning periodically.
-            CvScalar currentAvg = cvAvg([videoFrame image]);
-            double averageDelta = ABS(currentAvg.val[0] - _lastWellAnalyzedFrameAverageValues.val[0]) +
-                                    ABS(currentAvg.val[1] - _lastWellAnalyzedFrameAverageValues.val[1]) +
-                                    ABS(currentAvg.val[2] - _lastWellAnalyzedFrameAverageValues.val[2]) / 3;
+            // (Luma is used so that idle frames need not be converted to BGRA.)
+            double currentAverageLuma = cvAvg([videoFrame lumaImage]).val[0];
+            double averageDelta = ABS(currentAverageLuma - _lastWellAnalyzedFrameAverageLuma);
             
             // Always scan if we are not idle, and scan if the average values change significantly or if we haven't scanned in a while
-            if (_processingState != ProcessingStateNoPlate ||
-                averageDelta > WellDetectingAverageDeltaEndIdleThreshold ||
-                _lastWellAnalysisBeginTime + WellDetectingUnconditionalSearchPeriod < CACurrentMediaTime()) {
+            // Unless in batch mode, wait for the next frame if the background share of the cores is in use. In batch mode,
+            // "a while" is in media time (as in wormassay-cli), so that the searches don't depend on the decoding speed.
+            NSTimeInterval searchTime = _batchMode ? [videoFrame presentationTime] : CACurrentMediaTime();
+            if ((_plateTracker.state() != PlateTracker::NoPlate ||
+                 averageDelta > WellDetectingAverageLumaDeltaEndIdleThreshold ||
+                 _lastWellAnalysisBeginTime + WellDetectingUnconditionalSearchPeriod < searchTime) &&
+                (_batchMode || CoreBudget::sharedBudget().tryBeginBackgroundTask())) {
                 // Begin an async well finding analysis
-                _lastWellAnalysisBeginTime = CACurrentMediaTime();
-                _lastWellAnalyzedFrameAverageValues = currentAvg;
+                _lastWellAnalysisBeginTime = searchTime;
+                _lastWellAnalyzedFrameAverageLuma = currentAverageLuma;
                 
-                [self performWellDeterminationCalculationAsyncWithFrame:videoFrame];
+                wellDeterminationBlock = [self wellDeterminationCalculationBlockWithFrame:videoFrame];
+                // Once a plate has been found, well finding verifies that it's still present, which must keep up
+                wellFindingPriority = _plateTracker.state() != PlateTracker::NoPlate ? TaskPriorityVerification : TaskPriorityDetection;
             }
         }
         
-        // Create a copy of the frame to draw debugging info/live feedback on, which we will send back
-        debugFrame = [videoFrame copy];
-        
-        // First, draw debugging well circles and labels on each frame so that they appear underneath other drawing
-        if (_shouldScanForWells) {
-            CvScalar circleColor = _processingState == ProcessingStateNoPlate ? CV_RGBA(255, 0, 0, 255) :
-            (_processingState == ProcessingStatePlateFirstFrameIdentified ? CV_RGBA(255, 255, 0, 255) : CV_RGBA(0, 255, 0, 255));
-            drawWellCirclesAndLabelsOnDebugImage(_processingState == ProcessingStateNoPlate ? _lastCircles : _trackingWellCircles,
-                                                 circleColor,
-                                                 _processingState == ProcessingStateTrackingMotion,
-                                                 [debugFrame image]);
-        }
+        // Snapshot what to draw so that the drawing can be done without the lock held
+        drawCircles = _shouldScanForWells;
+        PlateTracker::State state = _plateTracker.state();
+        circles = state == PlateTracker::NoPlate ? _plateTracker.lastCircles() : _plateTracker.trackingWellCircles();
+        circleColor = state == PlateTracker::NoPlate ? CV_RGBA(255, 0, 0, 255) :
+        (state == PlateTracker::PlateFirstFrameIdentified ? CV_RGBA(255, 255, 0, 255) : CV_RGBA(0, 255, 0, 255));
+        circleLabels = state == PlateTracker::TrackingMotion;
         
         // If this processor detected a barcode, draw it on the debug image
-        NSMutableString *barcodeAndOrTimeText = [NSMutableString string];
         if (_lastBarcodeThisProcessor && _lastBarcodeThisProcessorRepeatCount >= BarcodeRepeatSuccessCount) {
             [barcodeAndOrTimeText appendString:_lastBarcodeThisProcessor];
             [barcodeAndOrTimeText appendString:@" "];
         }
         // Print the tracked time on the debug image
-        if (_processingState == ProcessingStateTrackingMotion) {
+        if (state == PlateTracker::TrackingMotion) {
             unsigned elapsed = [videoFrame presentationTime] - [_plateData startPresentationTime];
             [barcodeAndOrTimeText appendFormat:@"%u:%02u", elapsed / 60, elapsed % 60];
         }
+    }
+    
+    // Perform well finding in the background so that we don't block the pipeline. In batch mode, it is done
+    // synchronously instead so that the results don't depend on how quickly frames are decoded relative to it.
+    if (wellDeterminationBlock) {
+        if (_batchMode) {
+            wellDeterminationBlock();
+        } else {
+            NSOperation *task = [[TaskScheduler sharedScheduler] addTaskWithPriority:wellFindingPriority block:^(BOOL cancelled) {
+                if (cancelled) {
+                    @synchronized (self) {
+                        _scanningForWells = NO;
+                    }
+                } else {
+                    wellDeterminationBlock();
+                }
+                CoreBudget::sharedBudget().endBackgroundTask();
+            }];
+            @synchronized (self) {
+                _wellFindingTask = task;
+            }
+        }
+    }
+    
+    // Create an overlay to draw debugging info/live feedback on, which is composited onto the frame only if it is
+    // displayed. If there is no callback, the overlay is disabled and ignores all drawing.
+    NSTimeInterval overlayStartTime = CACurrentMediaTime();
+    DebugOverlay debugOverlay = callback ? DebugOverlay([videoFrame size]) : DebugOverlay();
+    
+    // First, draw debugging well circles and labels on each frame so that they appear underneath other drawing
+    if (debugOverlay.enabled()) {
+        TraceSpan span("draw wells", [videoFrame presentationTime]);
+        if (drawCircles) {
+            drawWellCirclesAndLabelsOnDebugOverlay(circles, circleColor, circleLabels, debugOverlay);
+        }
         if ([barcodeAndOrTimeText length] > 0) {
-            CvFont font = fontForNormalizedScale(3.5, [debugFrame image]);
-            CvPoint point = cvPoint(10, [debugFrame image]->height - 10);
-            cvPutText([debugFrame image], [barcodeAndOrTimeText UTF8String], point, &font, CV_RGBA(232, 0, 217, 255));
+            CvFont font = fontForNormalizedScale(3.5, debugOverlay.size());
+            CvPoint point = cvPoint(10, debugOverlay.size().height - 10);
+            debugOverlay.drawText([barcodeAndOrTimeText UTF8String], point, font, CV_RGBA(232, 0, 217, 255));
         }
-        
-        // Analyze tracked images synchronously (at frame rate), so that we drop frames if we can't keep up.
-        if (_processingState == ProcessingStateTrackingMotion && sizeEqualsSize(_trackedImageSize, cvGetSize([videoFrame image]))) {
-            if ([_assayAnalyzer willBeginFrameProcessing:videoFrame debugImage:[debugFrame image] plateData:_plateData]) {
-                // Make a block to parallelize
-                void (^processWellBlock)(NSUInteger, id) = ^(NSUInteger i, id criticalSection){
-                    // Make stack copies of the headers so that they can have their own ROI's, etc.
-                    IplImage wellImage = *[videoFrame image];
-                    IplImage debugImage = *[debugFrame image];
-                    if (_trackingWellCircles.size() > 0) {
-                        CvRect boundingSquare = boundingSquareForCircle(_trackingWellCircles[i]);
-                        cvSetImageROI(&wellImage, boundingSquare);
-                        cvSetImageROI(&debugImage, boundingSquare);
-                    }
-                    [_assayAnalyzer processVideoFrameWellSynchronously:&wellImage
-                                                               forWell:_trackingWellCircles.size() > 0 ? (int)i : -1
-                                                            debugImage:&debugImage
-                                                      presentationTime:[videoFrame presentationTime]
-                                                             plateData:_plateData];
-                    cvResetImageROI(&wellImage);
-                    cvResetImageROI(&debugImage);
-                };
+    }
+    times.overlayTime = CACurrentMediaTime() - overlayStartTime;
+    times.geometryStageTime = CACurrentMediaTime() - times.processingStartTime;
+    TraceRecorder::sharedRecorder().addSpan("geometry stage", traceStartTime, TraceRecorder::now(), [videoFrame presentationTime], NULL, 0);
+    
+    // Hand the frame to the analysis stage, waiting if it is still analyzing the previous frame
+    [_analysisStage addFrameOperationWithBlock:^{
+        [self performAnalysisStageWithFrame:videoFrame debugOverlay:debugOverlay times:times debugFrameCallback:callback completion:completion];
+    }];
+}
+
+// Called on the analysis stage. Analyzes tracked images synchronously (at frame rate), so that we drop frames if we can't keep up.
+// The analyzer is only ever called from this stage (including at the end of tracking), so the lock is only held to
+// get the current analyzer and wells.
+- (void)performAnalysisStageWithFrame:(VideoFrame *)videoFrame
+                         debugOverlay:(DebugOverlay)debugOverlay
+                                times:(FrameTimes)times
+                   debugFrameCallback:(void (^)(DebugFrame *debugFrame))callback
+                           completion:(void (^)(void))completion
+{
+    uint64_t traceStartTime = TraceRecorder::now();
+    NSTimeInterval analysisStageStartTime = CACurrentMediaTime();
+    id<AssayAnalyzer> assayAnalyzer = nil;
+    PlateData *plateData = nil;
+    std::vector<Circle> wellCircles;
+    @synchronized (self) {
+        if (_plateTracker.state() == PlateTracker::TrackingMotion && sizeEqualsSize(_trackedImageSize, [videoFrame size])) {
+            assayAnalyzer = _assayAnalyzer;
+            plateData = _plateData;
+            wellCircles = _plateTracker.trackingWellCircles();
+        }
+    }
+    
+    if (assayAnalyzer) {
+        NSTimeInterval analysisStartTime = CACurrentMediaTime();
+        unsigned maximumConcurrency = (unsigned)[self coreShare];
+        // Previously, this was conditionalized to only parallelize well analysis if we had at least 4 physical
+        // cores to be conservative, since doing so on a 2.1 ghz Core 2 Duo (with 2 virtual/physical cores) decreased
+        // performance 50% due to contention with decoding threads, however, the minimum linked version of the
+        // OS now means that all computers will meet this requirement, and libdispatch has also improved somewhat since then.
+        // The wells are spread over this plate's share of the cores, which is all of them unless several plates
+        // are being tracked at once, in the analysis lane of the TaskScheduler.
+        analyzePlateFrame([assayAnalyzer plateAnalyzer],
+                          AnalysisFrameForVideoFrame(videoFrame),
+                          wellCircles,
+                          maximumConcurrency,
+                          [maximumConcurrency](size_t iterations, const std::function<void(size_t)> &body) {
+                              const std::function<void(size_t)> *bodyPointer = &body;     // so that the block doesn't copy it
+                              [[TaskScheduler sharedScheduler] performInParallelWithInstances:iterations
+                                                                           maximumConcurrency:maximumConcurrency
+                                                                                     priority:TaskPriorityAnalysis
+                                                                                        block:^(NSUInteger i, id criticalSection) {
+                                  (*bodyPointer)(i);
+                              }];
+                          },
+                          debugOverlay,
+                          [plateData results]);
+        [plateData addProcessingTime:CACurrentMediaTime() - analysisStartTime forStage:ProcessingStageAnalysis];
+    }
+    times.analysisStageTime = CACurrentMediaTime() - analysisStageStartTime;
+    TraceRecorder::sharedRecorder().addSpan("analysis stage", traceStartTime, TraceRecorder::now(), [videoFrame presentationTime], NULL, 0);
+    
+    // Hand the frame to the overlay stage, waiting if it is still drawing the previous frame
+    [_overlayStage addFrameOperationWithBlock:^{
+        [self performOverlayStageWithFrame:videoFrame
+                              debugOverlay:debugOverlay
+                                 plateData:plateData
+                               wellCircles:wellCircles
+                                     times:times
+                        debugFrameCallback:callback
+                                completion:completion];
+    }];
+}
+
+// Called on the overlay stage. Draws the results and statistics for tracked frames (plateData is nil otherwise) and
+// presents the debug frame.
+- (void)performOverlayStageWithFrame:(VideoFrame *)videoFrame
+                        debugOverlay:(DebugOverlay)debugOverlay
+                           plateData:(PlateData *)plateData
+                         wellCircles:(const std::vector<Circle> &)wellCircles
+                               times:(FrameTimes)times
+                  debugFrameCallback:(void (^)(DebugFrame *debugFrame))callback
+                          completion:(void (^)(void))completion
+{
+    TraceSpan stageSpan("overlay stage", [videoFrame presentationTime]);
+    NSTimeInterval overlayStageStartTime = CACurrentMediaTime();
+    if (plateData && debugOverlay.enabled()) {
+        TraceSpan span("draw results", [videoFrame presentationTime]);
+        // Print the results in the wells averaged over the last 30 seconds (to limit computational complexity)
+        NSTimeInterval overlayStartTime = CACurrentMediaTime();
+        CvFont wellFont = fontForNormalizedScale(0.75, debugOverlay.size());
+        size_t labels = wellCircles.size() > 0 ? wellCircles.size() : 1;
+        std::vector<double> means(labels), stddevs(labels);
+        [plateData movementUnitsMeans:&means[0] stdDevs:&stddevs[0] inLastSeconds:30];
+        for (size_t i = 0; i < labels; i++) {
+            if (!isnan(means[i])) {
+                char text[20];
+                if (wellCircles.size() <= 24) {        // Draw the SD if the wells are large enough
+                    snprintf(text, sizeof(text), "%.0f (SD: %.0f)", means[i], stddevs[i]);
+                } else {
+                    snprintf(text, sizeof(text), "%.0f", means[i]);
+                }
                 
-                // Previously, this was conditionalized to only parallelize well analysis if we had at least 4 physical
-                // cores to be conservative, since doing so on a 2.1 ghz Core 2 Duo (with 2 virtual/physical cores) decreased
-                // performance 50% due to contention with decoding threads, however, the minimum linked version of the
-                // OS now means that all computers will meet this requirement, and libdispatch has also improved somewhat since then.
-                size_t iterations = _trackingWellCircles.size() > 0 ? _trackingWellCircles.size() : 1;      // i.e. wells
-                if ([_assayAnalyzer canProcessInParallel]) {
-                    [NSOperationQueue addOperationsInParallelWithInstances:iterations onGlobalQueueForBlock:processWellBlock];
+                CvPoint textPoint;
+                if (wellCircles.size() > 0) {
+                    float radius = wellCircles[i].radius;
+                    textPoint = cvPoint(wellCircles[i].center[0] - radius * 0.5, wellCircles[i].center[1]);
                 } else {
-                    for (size_t i = 0; i < iterations; i++) {
-                        processWellBlock(i, nil);
-                    }
+                    CvSize frameSize = [videoFrame size];
+                    textPoint = cvPoint(frameSize.width / 2, frameSize.height / 2);
                 }
+                debugOverlay.drawText(text, textPoint, wellFont, CV_RGBA(0, 255, 255, 255));
             }
-            [_assayAnalyzer didEndFrameProcessing:videoFrame plateData:_plateData];
+        }
+        
+        // Print performance statistics. The mean/stddev are for just the processing time. The frame rate is the total net rate.
+        // The percentiles are of the total processing time and of the end-to-end latency from capture over the last 300
+        // frames, to show the tail latency.
+        double mean, stddev, p50, p90, p99, max;
+        if ([plateData processingTimeMean:&mean stdDev:&stddev inLastFrames:15]) {
+            char text[100];
+            snprintf(text, sizeof(text), "%.0f ms/f (SD: %.0f ms), %.1f fps, %.0f%% drop",
+                     mean * 1000, stddev * 1000, [plateData averageFramesPerSecond], [plateData droppedFrameProportion] * 100);
+            CvFont font;
+            cvInitFont(&font, CV_FONT_HERSHEY_DUPLEX, 0.6, 0.6, 0, 0.6);
+            debugOverlay.drawText(text, cvPoint(0, 15), font, CV_RGBA(232, 0, 217, 255));
             
-            // Print the results in the wells averaged over the last 30 seconds (to limit computational complexity)
-            CvFont wellFont = fontForNormalizedScale(0.75, [debugFrame image]);
-            size_t labels = _trackingWellCircles.size() > 0 ? _trackingWellCircles.size() : 1;
-            for (size_t i = 0; i < labels; i++) {
-                double mean, stddev;
-                if ([_plateData movementUnitsMean:&mean stdDev:&stddev forWell:(int)i inLastSeconds:30]) {
-                    char text[20];
-                    if (_trackingWellCircles.size() <= 24) {        // Draw the SD if the wells are large enough
-                        snprintf(text, sizeof(text), "%.0f (SD: %.0f)", mean, stddev);
-                    } else {
-                        snprintf(text, sizeof(text), "%.0f", mean);
-                    }
-                    
-                    CvPoint textPoint;
-                    if (_trackingWellCircles.size() > 0) {
-                        float radius = _trackingWellCircles[i].radius;
-                        textPoint = cvPoint(_trackingWellCircles[i].center[0] - radius * 0.5, _trackingWellCircles[i].center[1]);
-                    } else {
-                        CvSize frameSize = cvGetSize([videoFrame image]);
-                        textPoint = cvPoint(frameSize.width / 2, frameSize.height / 2);
-                    }
-                    cvPutText([debugFrame image],
-                              text,
-                              textPoint,
-                              &wellFont,
-                              CV_RGBA(0, 255, 255, 255));
-                }
+            if ([plateData processingTimeP50:&p50 p90:&p90 p99:&p99 max:&max forStage:ProcessingStageTotal wholeRun:NO]) {
+                snprintf(text, sizeof(text), "p50 %.0f / p90 %.0f / p99 %.0f / max %.0f ms",
+                         p50 * 1000, p90 * 1000, p99 * 1000, max * 1000);
+                debugOverlay.drawText(text, cvPoint(0, 33), font, CV_RGBA(232, 0, 217, 255));
             }
-            
-            // Print performance statistics. The mean/stddev are for just the processing time. The frame rate is the total net rate.
-            double mean, stddev;
-            if ([_plateData processingTimeMean:&mean stdDev:&stddev inLastFrames:15]) {
-                char text[100];
-                snprintf(text, sizeof(text), "%.0f ms/f (SD: %.0f ms), %.1f fps, %.0f%% drop",
-                         mean * 1000, stddev * 1000, [_plateData averageFramesPerSecond], [_plateData droppedFrameProportion] * 100);
-                CvFont font;
-                cvInitFont(&font, CV_FONT_HERSHEY_DUPLEX, 0.6, 0.6, 0, 0.6);
-                cvPutText([debugFrame image], text, cvPoint(0, 15), &font, CV_RGBA(232, 0, 217, 255));
+            if ([plateData processingTimeP50:&p50 p90:&p90 p99:&p99 max:&max forStage:ProcessingStageEndToEnd wholeRun:NO]) {
+                snprintf(text, sizeof(text), "latency p50 %.0f / p90 %.0f / p99 %.0f / max %.0f ms",
+                         p50 * 1000, p90 * 1000, p99 * 1000, max * 1000);
+                debugOverlay.drawText(text, cvPoint(0, 51), font, CV_RGBA(232, 0, 217, 255));
             }
         }
-        
-        // Add the processing time
-        if (_plateData) {
-            [_plateData addProcessingTime:CACurrentMediaTime() - processingStartTime];
+        times.overlayTime += CACurrentMediaTime() - overlayStartTime;
+    }
+    
+    if (plateData) {
+        // Add the processing times. The total is the time from the frame entering the geometry stage to it being presented.
+        [plateData addProcessingTime:times.flipTime forStage:ProcessingStageFlip];
+        [plateData addProcessingTime:times.overlayTime forStage:ProcessingStageOverlay];
+        [plateData addProcessingTime:CACurrentMediaTime() - times.processingStartTime];
+    }
+    
+    // The stages overlap, so the sustainable frame rate is limited by the slowest one. (The debug frame callback is
+    // excluded since it only hands the frame off for display.)
+    NSTimeInterval overlayStageTime = CACurrentMediaTime() - overlayStageStartTime;
+    [self addFrameCost:MAX(MAX(times.geometryStageTime, times.analysisStageTime), overlayStageTime) forFrame:videoFrame];
+    
+    // Dispatch the debug frame callback block last. The overlay is composited only if the frame is drawn.
+    if (callback) {
+        callback([[DebugFrame alloc] initWithVideoFrame:videoFrame debugOverlay:debugOverlay]);
+    }
+    
+    // The end-to-end latency runs from the frame's capture (its presentation time) until its debug frame has been handed
+    // off for display, or until its results are available if it isn't displayed. Batch presentation times are media
+    // times, so there is no latency to measure.
+    if (plateData && !_batchMode) {
+        [plateData addProcessingTime:CACurrentMediaTime() - [videoFrame presentationTime] forStage:ProcessingStageEndToEnd];
+    }
+    
+    if (completion) {
+        completion();
+    }
+}
+
+- (void)waitUntilAllFramesAreProcessed
+{
+    // Each stage only hands frames forward, so once a stage is empty, nothing more can enter the stages after it
+    [_geometryStage waitUntilAllOperationsAreFinished];
+    [_analysisStage waitUntilAllOperationsAreFinished];
+    [_overlayStage waitUntilAllOperationsAreFinished];
+}
+
+// Adjusts the analysis rate (see -shouldProcessFrameArrivingAtTime:) for the cost of a processed frame
+- (void)addFrameCost:(NSTimeInterval)cost forFrame:(VideoFrame *)videoFrame
+{
+    @synchronized (self) {
+        if (_analysisRateScheduler.addFrameCost(cost)) {
+            RunLog(@"Analyzing every %i of %.2f fps to keep up (%.0f ms/frame).",
+                   _analysisRateScheduler.decimation(), 1.0 / _analysisRateScheduler.sourceFrameInterval(), cost * 1000);
+            [self noteAnalysisRateInPlateDataAtPresentationTime:[videoFrame presentationTime]];
         }
     }
-        
-    // Dispatch the debug image callback block last
-    callback(debugFrame);
 }
 
 // requires lock to be held
-- (void)performWellDeterminationCalculationAsyncWithFrame:(VideoFrame *)videoFrame
+- (void)noteAnalysisRateInPlateDataAtPresentationTime:(NSTimeInterval)presentationTime
+{
+    if (_plateData && _analysisRateScheduler.sourceFrameInterval() > 0) {
+        [_plateData noteAnalysisDecimation:_analysisRateScheduler.decimation()
+                           sourceFrameRate:1.0 / _analysisRateScheduler.sourceFrameInterval()
+                        atPresentationTime:presentationTime];
+    }
+}
+
+// requires lock to be held. Returns the block that performs the calculation, which must be called (e.g. asynchronously).
+- (void (^)(void))wellDeterminationCalculationBlockWithFrame:(VideoFrame *)videoFrame
 {
     // If well finding is disabled, report success and bail
     bool wellFindingDisabled = _plateOrientation == PlateOrientationNoWells;
@@ -347,20 +592,26 @@ CGAffineTransform TransformForPlateOrientation(PlateOrientation plateOrientation
     _scanningForWells = YES;
     
     // Get instance variables while locked for thread-safety
-    int wellCountHint = _wellCountHint;
-    bool searchAllPlateSizes = _processingState == ProcessingStateNoPlate;
+    int wellCountHint = _plateTracker.wellCountHint();
+    bool searchAllPlateSizes = _plateTracker.shouldSearchAllPlateSizes();
+    // Any part of the plate orientation that has not been applied to the frame's pixels is applied to the well order
+    VideoFrameFlip wellOrderFlip = (VideoFrameFlip)(FlipForPlateOrientation(_plateOrientation) ^ [videoFrame flip]);
     
-    // Perform the calculation on a concurrent queue so that we don't block the current thread
-    [NSOperationQueue addOperationToGlobalQueueWithBlock:^{
-        // Get wells in row major order
+    return ^{
+        TraceSpan span("find wells", [videoFrame presentationTime]);
+        // Get wells in row major order. The search is background work, so it is spread over the background share.
         std::vector<Circle> wellCircles;
         bool plateFound;
+        unsigned maximumConcurrency = CoreBudget::sharedBudget().backgroundShare();
         if (wellFindingDisabled) {
             plateFound = YES;
         } else if (searchAllPlateSizes) {
-            plateFound = findWellCircles([videoFrame image], wellCircles, wellCountHint);
+            plateFound = findWellCircles([videoFrame image], wellCircles, maximumConcurrency, wellCountHint);
         } else {
-            plateFound = findWellCirclesForWellCount([videoFrame image], wellCountHint, wellCircles);
+            plateFound = findWellCirclesForWellCount([videoFrame image], wellCountHint, wellCircles, maximumConcurrency);
+        }
+        if (plateFound && wellOrderFlip != VideoFrameFlipNone) {
+            orderWellCirclesForFlippedImage(wellCircles, wellOrderFlip & VideoFrameFlipHorizontal, wellOrderFlip & VideoFrameFlipVertical);
         }
         
         // Process and store the results while locked
@@ -368,102 +619,71 @@ CGAffineTransform TransformForPlateOrientation(PlateOrientation plateOrientation
             _scanningForWells = NO;
             // If the device was removed, etc., ignore any detected plates
             if (_shouldScanForWells) {
-                // Store the circles for debugging later
-                _lastCircles = wellCircles;
-                // If we've found a plate, store the well count to improve the performance of future searches
-                if (plateFound) {
-                    _wellCountHint = (int)wellCircles.size();
-                }
-                
-                switch (_processingState) {
-                    case ProcessingStateNoPlate:
-                        if (plateFound) {
-                            _processingState = ProcessingStatePlateFirstFrameIdentified;
-                            _trackingWellCircles = wellCircles;     // store the first circles as the baseline for the second set
-                            _firstWellFrameTime = [videoFrame presentationTime];
-                        }
-                        break;
+                switch (_plateTracker.wellsFound(plateFound, wellCircles, [videoFrame presentationTime])) {
+                    case PlateTracker::BeganTracking:
+                        _trackedImageSize = [videoFrame size];
+                        _lastBarcodeScanTime = PresentationTimeDistantPast;     // Now that plate is in place, immediately retry barcode capture
                         
-                    case ProcessingStatePlateFirstFrameIdentified:
-                        if (plateFound) {
-                            // If the second identification yields matching results as the first, and they are spread by at least
-                            // 250 ms, begin motion tracking and video recording
-                            if (plateSequentialCirclesAppearSameAndStationary(_trackingWellCircles, wellCircles) &&
-                                [videoFrame presentationTime] - _firstWellFrameTime >= MinimumWellMatchTimeToBeginTracking &&
-                                [videoFrame presentationTime] > _lockoutStartFrameTime) {
-                                _startOfTrackingFrameTime = [videoFrame presentationTime];
-                                _processingState = ProcessingStateTrackingMotion;
-                                _trackingWellCircles = wellCircles; // store the second set as the baseline for all remaining sets
-                                _trackedImageSize = cvGetSize([videoFrame image]);
-                                _lastBarcodeScanTime = PresentationTimeDistantPast;     // Now that plate is in place, immediately retry barcode capture
-                                
-                                // Notify the delegate
-                                [_delegate videoProcessor:self didBeginTrackingPlateAtPresentationTime:[videoFrame presentationTime]];
-                                
-                                // Create plate data and analyzer
-                                if (_trackingWellCircles.size () > 0) {
-                                    RunLog(@"Began tracking %li well plate using %@ analyzer.", _trackingWellCircles.size(), [_assayAnalyzerClass analyzerName]);
-                                } else {
-                                    RunLog(@"Began tracking entire plate using %@ analyzer.", [_assayAnalyzerClass analyzerName]);
-                                }
-                                NSAssert(!_plateData && !_assayAnalyzer, @"plate data or motion analyzer already exists");
-                                _plateData = [[PlateData alloc] initWithWellCount:wellCircles.size() startPresentationTime:[videoFrame presentationTime]];
-                                _assayAnalyzer = [[_assayAnalyzerClass alloc] init];
-                                NSAssert1(_assayAnalyzer, @"failed to allocate AssayAnalyzer %@", _assayAnalyzerClass);
-                                [_assayAnalyzer willBeginPlateTrackingWithPlateData:_plateData];
-                                
-                                // Start recording if we have a session to record from (e.g. this is a device source)
-                                _fileOutputURL = nil;
-                                if (_fileOutputDelegate) {
-                                    _fileOutputURL = [_delegate outputFileURLForVideoProcessor:self];
-                                    [_fileOutputDelegate videoProcessor:self shouldBeginRecordingToURL:_fileOutputURL withNaturalOrientation:_plateOrientation];
-                                }
-                            } else {
-                                // There is still a plate, but it doesn't match or more likely is still moving moved, or not enough
-                                // time has lapsed, so we stay in this state, but update the circles
-                                _trackingWellCircles = wellCircles;
-                            }
+                        // Notify the delegate
+                        [_delegate videoProcessor:self didBeginTrackingPlateAtPresentationTime:[videoFrame presentationTime]];
+                        
+                        // Create plate data and analyzer
+                        if (wellCircles.size () > 0) {
+                            RunLog(@"Began tracking %li well plate using %@ analyzer.", wellCircles.size(), [_assayAnalyzerClass analyzerName]);
                         } else {
-                            // Plate is gone so reset
-                            [self resetCaptureStateAndReportResults];
+                            RunLog(@"Began tracking entire plate using %@ analyzer.", [_assayAnalyzerClass analyzerName]);
                         }
+                        NSAssert(!_plateData && !_assayAnalyzer, @"plate data or motion analyzer already exists");
+                        _plateData = [[PlateData alloc] initWithWellCount:wellCircles.size() startPresentationTime:[videoFrame presentationTime]];
+                        _assayAnalyzer = [[_assayAnalyzerClass alloc] init];
+                        NSAssert1(_assayAnalyzer, @"failed to allocate AssayAnalyzer %@", _assayAnalyzerClass);
+                        [_assayAnalyzer willBeginPlateTrackingWithPlateData:_plateData];
+                        [self noteAnalysisRateInPlateDataAtPresentationTime:[videoFrame presentationTime]];
+                        CoreBudget::sharedBudget().addClient((__bridge void *)self);
+                        
+                        // Start recording if we have a session to record from (e.g. this is a device source)
+                        _fileOutputURL = nil;
+                        if (_fileOutputDelegate) {
+                            _fileOutputURL = [_delegate outputFileURLForVideoProcessor:self];
+                            [_fileOutputDelegate videoProcessor:self shouldBeginRecordingToURL:_fileOutputURL withNaturalOrientation:_plateOrientation];
+                        }
+                        break;
+                        
+                    case PlateTracker::PlateLost:
+                        [self resetCaptureStateAndReportResults];
                         break;
                         
-                    case ProcessingStateTrackingMotion: {
-                        // Get values for the optional time lapse feature
-                        NSTimeInterval trackingLimit, lockoutTime;
-                        BOOL timeLapseEnabled = [[NSUserDefaults standardUserDefaults] boolForKey:TimeLapseAnalyzeEnabled];
-                        if (timeLapseEnabled) {
-                            trackingLimit = [[NSUserDefaults standardUserDefaults] doubleForKey:TimeLapseAnalyzeDuration];
+                    case PlateTracker::NoTransition:
+                        // Stop tracking if the optional time lapse feature's tracking limit has been reached, and wait
+                        // until we aren't locked out
+                        if (_plateTracker.state() == PlateTracker::TrackingMotion &&
+                            [[NSUserDefaults standardUserDefaults] boolForKey:TimeLapseAnalyzeEnabled]) {
                             // Set sensible defaults
+                            NSTimeInterval trackingLimit = [[NSUserDefaults standardUserDefaults] doubleForKey:TimeLapseAnalyzeDuration];
                             if (trackingLimit <= 0.0) {
                                 trackingLimit = TimeLapseAnalyzeDurationDefault;
                             }
-                            lockoutTime = [[NSUserDefaults standardUserDefaults] doubleForKey:TimeLapseLockoutInterval];
+                            NSTimeInterval lockoutTime = [[NSUserDefaults standardUserDefaults] doubleForKey:TimeLapseLockoutInterval];
                             if (lockoutTime <= 0.0) {
                                 lockoutTime = TimeLapseLockoutIntervalDefault;
                             }
+                            
+                            if ([videoFrame presentationTime] > _plateTracker.startOfTrackingTime() + trackingLimit) {
+                                [self resetCaptureStateAndReportResults];       // clears the lockout
+                                _plateTracker.lockOutUntil([videoFrame presentationTime] + lockoutTime);
+                                RunLog(@"Pausing capture for %u:%02g for time lapse recording.", (unsigned)lockoutTime / 60, fmod(lockoutTime, 60.0));
+                            }
                         }
-                        
-                        // Since we've seen a plate in one camera, ignore any pending results from others.
-                        // But if the plate is gone, moved or different, reset
-                        if (!plateFound || !plateSequentialCirclesAppearSameAndStationary(_trackingWellCircles, wellCircles)) {
-                            [self resetCaptureStateAndReportResults];
-                        } else if (timeLapseEnabled && [videoFrame presentationTime] > _startOfTrackingFrameTime + trackingLimit) {
-                            // We've hit the tracking limit, so stop capturing and wait until we aren't locked out
-                            [self resetCaptureStateAndReportResults];       // clears _lockoutStartFrameTime
-                            _lockoutStartFrameTime = [videoFrame presentationTime] + lockoutTime;
-                            RunLog(@"Pausing capture for %u:%02g for time lapse recording.", (unsigned)lockoutTime / 60, fmod(lockoutTime, 60.0));
-                        }
-                    }
+                        break;
                 }
             }
         };
-    }];
+    };
 }
 
 - (void)performBarcodeReadingSynchronouslyWithFrame:(VideoFrame *)videoFrame
 {
+    TraceSpan span("read barcode", [videoFrame presentationTime]);
     CGImageRef cgImage = [videoFrame createCGImage];
     
     // Create the request
@@ -525,35 +745,57 @@ CGAffineTransform TransformForPlateOrientation(PlateOrientation plateOrientation
 
 - (void)resetCaptureStateAndReportResults       // requires lock to be held
 {
-    [_assayAnalyzer didEndTrackingPlateWithPlateData:_plateData];
-    
-    // Send the stats and video file information to the video controller
-    if (_plateData) {
-        NSTimeInterval trackingDuration = [_plateData lastPresentationTime] - [_plateData startPresentationTime];
-        BOOL longEnough = trackingDuration >= [_assayAnalyzer minimumTimeIntervalProcessedToReportData] &&
-                            [_plateData sampleCount] > [_assayAnalyzer minimumSamplesProcessedToReportData];
-        if (longEnough) {
-            RunLog(@"Ended tracking after %.3f seconds (%.1f fps)", trackingDuration, [_plateData averageFramesPerSecond]);
-        } else {
-            RunLog(@"Ignoring truncated run of %.3f seconds", trackingDuration);
-        }
-        
-        // Notify the two delegates in a delayed fashion to avoid re-entry, and without using instance variables
-        // since they can change, and instead snapshot with local variables
+    if (_assayAnalyzer || _plateData) {
+        // Finish on the analysis stage, after any frame still being analyzed has been committed, so that the analyzer
+        // is never called concurrently. Snapshot with local variables since the instance variables can change.
+        id<AssayAnalyzer> assayAnalyzer = _assayAnalyzer;
         PlateData *plateData = _plateData;
         NSURL *fileOutputURL = _fileOutputURL;   // esp. since two in flight encodings could overlap e.g. during a short recording after a long one
         
-        [NSOperationQueue addOperationToGlobalQueueWithBlock:^{
-            [_delegate videoProcessor:self
-          didFinishAcquiringPlateData:plateData
-                         successfully:longEnough
-     willStopRecordingToOutputFileURL:fileOutputURL];
+        [_analysisStage addControlOperationWithBlock:^{
+            [assayAnalyzer didEndTrackingPlateWithPlateData:plateData];
             
-            [_fileOutputDelegate videoProcessorShouldStopRecording:self completion:^(NSError *error) {
-                [_delegate videoProcessorDidFinishRecordingToFileURL:fileOutputURL error:error];
-            }];
+            // Send the stats and video file information to the video controller
+            if (plateData) {
+                NSTimeInterval trackingDuration = [plateData lastPresentationTime] - [plateData startPresentationTime];
+                BOOL longEnough = trackingDuration >= [assayAnalyzer minimumTimeIntervalProcessedToReportData] &&
+                                    [plateData sampleCount] > [assayAnalyzer minimumSamplesProcessedToReportData];
+                if (longEnough) {
+                    RunLog(@"Ended tracking after %.3f seconds (%.1f fps)", trackingDuration, [plateData averageFramesPerSecond]);
+                    NSString *processingTimeSummary = [plateData processingTimeSummary];
+                    RunLog(@"%@", processingTimeSummary);
+                    [plateData appendToAdditionalResultsText:[processingTimeSummary stringByAppendingString:@"\n"]];
+                    NSString *sampleIntervalSummary = [plateData sampleIntervalSummary];
+                    RunLog(@"%@", sampleIntervalSummary);
+                    [plateData appendToAdditionalResultsText:[sampleIntervalSummary stringByAppendingString:@"\n"]];
+                    
+                    FrameBufferPool::Statistics poolStatistics = FrameBufferPool::sharedPool().statistics();
+                    RunLog(@"Frame buffer pool: %.1f%% hit rate, %.0f MB outstanding high water, %.0f MB pooled high water",
+                           poolStatistics.hitRate() * 100,
+                           poolStatistics.outstandingBytesHighWater / 1048576.0,
+                           poolStatistics.pooledBytesHighWater / 1048576.0);
+                    RunLog(@"%@", [[TaskScheduler sharedScheduler] utilizationSummary]);
+                } else {
+                    RunLog(@"Ignoring truncated run of %.3f seconds", trackingDuration);
+                }
+                
+                // Notify the two delegates in a delayed fashion to avoid re-entry
+                [NSOperationQueue addOperationToGlobalQueueWithBlock:^{
+                    [_delegate videoProcessor:self
+                  didFinishAcquiringPlateData:plateData
+                                 successfully:longEnough
+             willStopRecordingToOutputFileURL:fileOutputURL];
+                    
+                    [_fileOutputDelegate videoProcessorShouldStopRecording:self completion:^(NSError *error) {
+                        [_delegate videoProcessorDidFinishRecordingToFileURL:fileOutputURL error:error];
+                    }];
+                }];
+            }
         }];
         
+        // Give up this plate's share of the cores
+        CoreBudget::sharedBudget().removeClient((__bridge void *)self);
+        
         // Release the plate data and output URL
         _plateData = nil;
         _fileOutputURL = nil;
@@ -564,13 +806,9 @@ CGAffineTransform TransformForPlateOrientation(PlateOrientation plateOrientation
     NSAssert(!_assayAnalyzer && !_plateData, @"inconsistent state");
     
     // Reset state
-    _processingState = ProcessingStateNoPlate;
-    _firstWellFrameTime = PresentationTimeDistantPast;
-    _startOfTrackingFrameTime = PresentationTimeDistantPast;
-    _lockoutStartFrameTime = PresentationTimeDistantPast;
+    _plateTracker.reset();
     _lastBarcodeScanTime = PresentationTimeDistantPast;
     _lastWellAnalysisBeginTime = PresentationTimeDistantPast;
-    _trackingWellCircles.clear();
     _trackedImageSize = cvSize(0, 0);
 }
 
@@ -579,6 +817,7 @@ CGAffineTransform TransformForPlateOrientation(PlateOrientation plateOrientation
     @synchronized (self) {
         [self resetCaptureStateAndReportResults];
         [self setShouldScanForWells:NO];
+        [_barcodeReadingTask cancel];
     };
 }
 
@@ -596,6 +835,55 @@ CGAffineTransform TransformForPlateOrientation(PlateOrientation plateOrientation
             [_plateData incrementFrameDropCount];
         }
     };
+    // Live presentation times are CACurrentMediaTime() at arrival, so this is close to the time of the dropped frame
+    _frameRecordingWriter.appendDrop(CACurrentMediaTime());
+}
+
+- (BOOL)beginRecordingFramesToPath:(NSString *)path error:(NSError **)outError
+{
+    std::string error;
+    if (!_frameRecordingWriter.open([path fileSystemRepresentation], error)) {
+        if (outError) {
+            *outError = [NSError errorWithDomain:NSCocoaErrorDomain
+                                            code:NSFileWriteUnknownError
+                                        userInfo:@{ NSLocalizedDescriptionKey : [NSString stringWithUTF8String:error.c_str()],
+                                                    NSFilePathErrorKey : path }];
+        }
+        return NO;
+    }
+    return YES;
+}
+
++ (BOOL)writePerformanceTraceToPath:(NSString *)path error:(NSError **)outError
+{
+    std::string error;
+    if (!TraceRecorder::sharedRecorder().writeChromeTrace([path fileSystemRepresentation], error)) {
+        if (outError) {
+            *outError = [NSError errorWithDomain:NSCocoaErrorDomain
+                                            code:NSFileWriteUnknownError
+                                        userInfo:@{ NSLocalizedDescriptionKey : [NSString stringWithUTF8String:error.c_str()],
+                                                    NSFilePathErrorKey : path }];
+        }
+        return NO;
+    }
+    return YES;
+}
+
+- (NSString *)throughputSummary
+{
+    @synchronized (self) {
+        if (!_plateData) {
+            return nil;
+        }
+        CoreBudget &coreBudget = CoreBudget::sharedBudget();
+        NSMutableString *summary = [NSMutableString stringWithFormat:@"%.1f fps analyzed", [_plateData averageFramesPerSecond]];
+        if (_analysisRateScheduler.decimation() > 1) {
+            [summary appendFormat:@" (every %i of %.2f fps)", _analysisRateScheduler.decimation(), 1.0 / _analysisRateScheduler.sourceFrameInterval()];
+        }
+        [summary appendFormat:@", %.0f%% dropped, %u of %u cores", [_plateData droppedFrameProportion] * 100,
+         coreBudget.shareForClient((__bridge void *)self), coreBudget.cores()];
+        return summary;
+    }
 }
 
 @end
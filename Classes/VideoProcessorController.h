@@ -13,9 +13,7 @@
 
 @interface VideoProcessorController : NSObject <VideoProcessorDelegate> {
     NSMutableArray *_videoProcessors;
-    VideoProcessor *_currentlyTrackingProcessor;
-    NSTimeInterval _trackingBeginTime;
-    NSCountedSet *_barcodesSinceTrackingBegan;
+    NSMapTable *_trackingRecordsByProcessor;       // at most one unless tracking multiple plates concurrently
     NSMutableDictionary *_videoTempURLsToDestinationURLs;
     NSMutableSet *_filesToEmail;
     
@@ -25,6 +23,7 @@
     NSString *_runID;
     NSTimeInterval _currentOutputLastWriteTime;     // in CPU time
     NSTimer *_logEmailingTimer;
+    NSTimer *_throughputReportingTimer;
 }
 
 + (VideoProcessorController *)sharedInstance;
@@ -34,11 +33,14 @@
 @property(assign) PlateOrientation plateOrientation;
 @property(copy) NSString *runOutputFolderPath;
 @property BOOL disableVideoSaving;
+// If set, every camera tracks and records its own plate, and the cores are shared among the plates (see CoreBudget.hpp).
+// Otherwise, the other cameras stop scanning for wells once one begins tracking a plate (though they still read barcodes).
+@property BOOL trackMultiplePlatesConcurrently;
 - (NSString *)runOutputFolderPathCreatingIfNecessary:(BOOL)create;
 - (NSString *)videoFolderPathCreatingIfNecessary:(BOOL)create;
 @property(copy) NSString *notificationEmailRecipients;
 
-- (void)manuallyReportResultsForCurrentProcessor;
+- (void)manuallyReportResultsForCurrentProcessor;     // i.e. every processor tracking a plate
 
 - (void)addVideoProcessor:(VideoProcessor *)videoProcessor;
 - (void)removeVideoProcessor:(VideoProcessor *)videoProcessor;
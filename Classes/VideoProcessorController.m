@@ -21,6 +21,7 @@ static NSString *const PlateOrientationKey = @"PlateOrientation";
 
 static NSString *const RunOutputFolderPathKey = @"RunOutputFolderPath";
 static NSString *const DisableVideoSavingKey = @"DisableVideoSaving";
+static NSString *const TrackMultiplePlatesConcurrentlyKey = @"TrackMultiplePlatesConcurrently";
 static NSString *const SortableLoggingDateFormat = @"yyyy-MM-dd HH:mm zzz";
 static NSString *const SortableLoggingFilenameSafeDateFormat = @"yyyy-MM-dd HHmm zzz";
 static NSString *const RunIDDateFormat = @"yyyyMMddHHmm";
@@ -28,6 +29,33 @@ static NSString *const UnlabeledPlateLabel = @"Unlabeled Plate";
 
 // Logs are turned and results emailed after an idle period of this duration
 static const NSTimeInterval LogTurnoverIdleInterval = 10 * 60.0;
+// Each camera's throughput is logged at this interval while tracking multiple plates concurrently
+static const NSTimeInterval ThroughputReportingInterval = 60.0;
+
+
+// A plate being tracked by a processor
+@interface PlateTrackingRecord : NSObject
+
+@property NSTimeInterval beginTime;
+@property(readonly) NSCountedSet *barcodes;     // read since tracking began
+
+@end
+
+
+@implementation PlateTrackingRecord
+
+@synthesize beginTime = _beginTime;
+@synthesize barcodes = _barcodes;
+
+- (id)init
+{
+    if ((self = [super init])) {
+        _barcodes = [[NSCountedSet alloc] init];
+    }
+    return self;
+}
+
+@end
 
 
 @implementation VideoProcessorController
@@ -50,7 +78,7 @@ static const NSTimeInterval LogTurnoverIdleInterval = 10 * 60.0;
 {
     if ((self = [super init])) {
         _videoProcessors = [[NSMutableArray alloc] init];
-        _barcodesSinceTrackingBegan = [[NSCountedSet alloc] init];
+        _trackingRecordsByProcessor = [NSMapTable strongToStrongObjectsMapTable];
         _videoTempURLsToDestinationURLs = [[NSMutableDictionary alloc] init];
         _filesToEmail = [[NSMutableSet alloc] init];
     }
@@ -166,6 +194,23 @@ static const NSTimeInterval LogTurnoverIdleInterval = 10 * 60.0;
     [[NSUserDefaults standardUserDefaults] setBool:flag forKey:DisableVideoSavingKey];
 }
 
+- (BOOL)trackMultiplePlatesConcurrently
+{
+    return [[NSUserDefaults standardUserDefaults] boolForKey:TrackMultiplePlatesConcurrentlyKey];
+}
+
+- (void)setTrackMultiplePlatesConcurrently:(BOOL)flag
+{
+    [[NSUserDefaults standardUserDefaults] setBool:flag forKey:TrackMultiplePlatesConcurrentlyKey];
+    
+    @synchronized (self) {
+        // Plates already being tracked continue either way, but otherwise only the processors that may begin tracking scan for wells
+        for (VideoProcessor *processor in _videoProcessors) {
+            [processor setShouldScanForWells:flag || [_trackingRecordsByProcessor count] == 0 || [_trackingRecordsByProcessor objectForKey:processor]];
+        }
+    }
+}
+
 static void createFolderIfNecessary(NSString *path)
 {
     NSFileManager *fileManager = [[NSFileManager alloc] init];
@@ -204,8 +249,12 @@ static void createFolderIfNecessary(NSString *path)
 
 - (void)manuallyReportResultsForCurrentProcessor
 {
-    if (_currentlyTrackingProcessor) {
-        [_currentlyTrackingProcessor manuallyReportResultsAndReset];
+    NSArray *trackingProcessors;
+    @synchronized (self) {
+        trackingProcessors = [[_trackingRecordsByProcessor keyEnumerator] allObjects];
+    }
+    for (VideoProcessor *processor in trackingProcessors) {
+        [processor manuallyReportResultsAndReset];
     }
 }
 
@@ -238,7 +287,7 @@ static void createFolderIfNecessary(NSString *path)
 - (BOOL)isTracking
 {
     @synchronized (self) {
-        return _currentlyTrackingProcessor != nil;
+        return [_trackingRecordsByProcessor count] > 0;
     }
 }
 
@@ -252,20 +301,27 @@ static void createFolderIfNecessary(NSString *path)
 - (void)videoProcessor:(VideoProcessor *)vp didBeginTrackingPlateAtPresentationTime:(NSTimeInterval)presentationTime
 {
     @synchronized (self) {
-        if ([_videoProcessors containsObject:vp] && !_currentlyTrackingProcessor) {
-            _currentlyTrackingProcessor = vp;
-            _trackingBeginTime = presentationTime;
+        BOOL trackMultiplePlates = [self trackMultiplePlatesConcurrently];
+        if ([_videoProcessors containsObject:vp] &&
+            (trackMultiplePlates ? ![_trackingRecordsByProcessor objectForKey:vp] : [_trackingRecordsByProcessor count] == 0)) {
+            PlateTrackingRecord *record = [[PlateTrackingRecord alloc] init];
+            [record setBeginTime:presentationTime];
+            [_trackingRecordsByProcessor setObject:record forKey:vp];
             
             // Ensure that the plate tracking processor has the intended orientation
             [vp setPlateOrientation:[self plateOrientation]];
             
-            // Clear the past barcodes
-            [_barcodesSinceTrackingBegan removeAllObjects];
-            
-            for (VideoProcessor *processor in _videoProcessors) {
-                // Prevent all other processors from scanning for wells to conserve CPU time and avoid tracking more than one plate
-                if (vp != processor) {
-                    [processor setShouldScanForWells:NO];
+            if (trackMultiplePlates) {
+                if ([_trackingRecordsByProcessor count] > 1) {
+                    RunLog(@"Tracking %lu plates concurrently (%@ began).", (unsigned long)[_trackingRecordsByProcessor count], [vp displayName]);
+                }
+                [self updateThroughputReportingTimer];
+            } else {
+                for (VideoProcessor *processor in _videoProcessors) {
+                    // Prevent all other processors from scanning for wells to conserve CPU time and avoid tracking more than one plate
+                    if (vp != processor) {
+                        [processor setShouldScanForWells:NO];
+                    }
                 }
             }
         }
@@ -287,10 +343,15 @@ didFinishAcquiringPlateData:(PlateData *)plateData
 willStopRecordingToOutputFileURL:(NSURL *)outputFileURL     // nil if not recording
 {
     @synchronized (self) {
-        if (_currentlyTrackingProcessor == vp) {        // may have already been removed from _videoProcessors if device was unplugged/file closed
-            for (VideoProcessor *processor in _videoProcessors) {
-                [processor setShouldScanForWells:YES];
+        PlateTrackingRecord *record = [_trackingRecordsByProcessor objectForKey:vp];
+        if (record) {        // vp may have already been removed from _videoProcessors if device was unplugged/file closed
+            [_trackingRecordsByProcessor removeObjectForKey:vp];
+            if ([_trackingRecordsByProcessor count] == 0) {
+                for (VideoProcessor *processor in _videoProcessors) {
+                    [processor setShouldScanForWells:YES];
+                }
             }
+            [self updateThroughputReportingTimer];
             
             // Determine the filename prefix to log to. Rotate the log files if we've been idle for a time and update the run date if necessary
             if (!_currentOutputFilenamePrefix || _currentOutputLastWriteTime + LogTurnoverIdleInterval < CACurrentMediaTime()) {
@@ -316,8 +377,9 @@ willStopRecordingToOutputFileURL:(NSURL *)outputFileURL     // nil if not record
                 // Find the likely barcode corresponding to this plate or use a placeholder if there isn't one
                 NSString *plateID = nil;
                 NSUInteger count = 0;
-                for (NSString *barcode in _barcodesSinceTrackingBegan) {
-                    NSUInteger barcodeCount = [_barcodesSinceTrackingBegan countForObject:barcode];
+                NSCountedSet *barcodes = [record barcodes];
+                for (NSString *barcode in barcodes) {
+                    NSUInteger barcodeCount = [barcodes countForObject:barcode];
                     if (barcodeCount > count) {
                         count = barcodeCount;
                         plateID = barcode;
@@ -366,8 +428,6 @@ willStopRecordingToOutputFileURL:(NSURL *)outputFileURL     // nil if not record
                     [_videoTempURLsToDestinationURLs setObject:destinationURL forKey:outputFileURL];
                 }
             }
-            
-            _currentlyTrackingProcessor = nil;
         }
         
         // Clear any prior log emailing timer and arm a new one on the main run loop
@@ -387,12 +447,56 @@ willStopRecordingToOutputFileURL:(NSURL *)outputFileURL     // nil if not record
 - (void)videoProcessor:(VideoProcessor *)vp didCaptureBarcodeText:(NSString *)text atTime:(NSTimeInterval)presentationTime
 {
     @synchronized (self) {
-        // If we have a barcode on a camera that isn't the tracking camera, don't rotate the image		
-        if (vp != _currentlyTrackingProcessor && [_videoProcessors count] > 1) {		
-            [vp setPlateOrientation:PlateOrientationTopRead];		
+        if ([self trackMultiplePlatesConcurrently]) {
+            // Each camera reads its own plate's barcode
+            PlateTrackingRecord *record = [_trackingRecordsByProcessor objectForKey:vp];
+            if ([_videoProcessors containsObject:vp] && presentationTime >= [record beginTime]) {
+                [[record barcodes] addObject:text];
+            }
+        } else {
+            // If we have a barcode on a camera that isn't the tracking camera, don't rotate the image
+            if (![_trackingRecordsByProcessor objectForKey:vp] && [_videoProcessors count] > 1) {
+                [vp setPlateOrientation:PlateOrientationTopRead];
+            }
+            // Attribute it to the plate being tracked by any camera
+            for (VideoProcessor *processor in _trackingRecordsByProcessor) {
+                PlateTrackingRecord *record = [_trackingRecordsByProcessor objectForKey:processor];
+                if ([_videoProcessors containsObject:vp] && presentationTime >= [record beginTime]) {
+                    [[record barcodes] addObject:text];
+                }
+            }
+        }
+    }
+}
+
+// requires lock to be held. Arms or clears the timer to log each camera's throughput while tracking multiple plates.
+- (void)updateThroughputReportingTimer
+{
+    BOOL shouldReport = [self trackMultiplePlatesConcurrently] && [_trackingRecordsByProcessor count] > 0;
+    [[NSOperationQueue mainQueue] addOperationWithBlock:^{
+        if (shouldReport && !_throughputReportingTimer) {
+            _throughputReportingTimer = [NSTimer scheduledTimerWithTimeInterval:ThroughputReportingInterval
+                                                                         target:self
+                                                                       selector:@selector(reportThroughput)
+                                                                       userInfo:nil
+                                                                        repeats:YES];
+        } else if (!shouldReport && _throughputReportingTimer) {
+            [_throughputReportingTimer invalidate];
+            _throughputReportingTimer = nil;
         }
-        if ([_videoProcessors containsObject:vp] && presentationTime >= _trackingBeginTime) {
-            [_barcodesSinceTrackingBegan addObject:text];
+    }];
+}
+
+- (void)reportThroughput        // must call on main thread
+{
+    NSArray *trackingProcessors;
+    @synchronized (self) {
+        trackingProcessors = [[_trackingRecordsByProcessor keyEnumerator] allObjects];
+    }
+    for (VideoProcessor *processor in trackingProcessors) {
+        NSString *throughputSummary = [processor throughputSummary];
+        if (throughputSummary) {
+            RunLog(@"%@: %@", [processor displayName], throughputSummary);
         }
     }
 }
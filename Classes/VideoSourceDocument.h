@@ -14,6 +14,8 @@
 
 @class VideoProcessor;
 @class BitmapView;
+@class FrameMailbox;
+@class FrameRecordingSource;
 
 extern NSString *const CaptureDeviceWasConnectedOrDisconnectedNotification;
 
@@ -23,21 +25,23 @@ extern NSString *const AVFCaptureDeviceFileType;
 extern NSString *const BlackmagicDeckLinkCaptureDeviceScheme;
 extern NSString *const BlackmagicDeckLinkCaptureDeviceFileType;
 
+extern NSString *const FrameRecordingFileType;      // .waframes (see FrameRecording.hpp)
+
 
 // A VideoSourceDocument corresponds to each document window and hence camera input
 @interface VideoSourceDocument : NSDocument <AVCaptureVideoDataOutputSampleBufferDelegate, DeckLinkCaptureDeviceSampleBufferDelegate, VideoProcessorRecordingDelegate> {
     NSOperationQueue *_frameArrivalQueue;           // serial; protects instance variables
-    NSOperationQueue *_frameProcessingQueue;        // serial; protects nothing (for background processing)
+    FrameMailbox *_conversionMailbox;               // protects nothing (converts the latest frame for the processor's pipeline)
     
     VideoProcessor *_processor;
     BitmapView *_bitmapMetalView;
     BOOL _closeCalled;
+    BOOL _analyzingInBatch;                         // video files only
     NSSize _frameSize;
     
     // Shared video encoders
     AVAssetWriter *_assetWriter;
     AVAssetWriterInput *_assetWriterInput;
-    BOOL _currentlyProcessingFrame;
     BOOL _sendFramesToAssetWriter;
     BOOL _firstFrameToAssetWriter;
     NSUInteger _recordingFrameDropCount;
@@ -58,6 +62,9 @@ extern NSString *const BlackmagicDeckLinkCaptureDeviceFileType;
     // Blackmagic DeckLink capture device
     DeckLinkCaptureDevice *_deckLinkCaptureDevice;
     DeckLinkCaptureMode *_lastMode;
+    
+    // Frame recording replay (always in batch)
+    FrameRecordingSource *_frameRecordingSource;
 }
 
 // unique urls for each camera device (only meaningful to this class)
@@ -15,6 +15,8 @@
 #import "VideoFrame.h"
 #import "DeckLinkCaptureDevice.h"
 #import "NSOperationQueue-Utility.h"
+#import "FrameMailbox.h"
+#import "FrameRecordingSource.h"
 
 NSString *const CaptureDeviceWasConnectedOrDisconnectedNotification = @"CaptureDeviceWasConnectedOrDisconnectedNotification";
 
@@ -24,10 +26,21 @@ NSString *const AVFCaptureDeviceFileType = @"dyn.avfcapturedevice";
 NSString *const BlackmagicDeckLinkCaptureDeviceScheme = @"blackmagicdecklink";
 NSString *const BlackmagicDeckLinkCaptureDeviceFileType = @"dyn.blackmagicdecklink";
 
+NSString *const FrameRecordingFileType = @"org.chrismarcellino.wormassay.frame-recording";
+
 NSString *const DontSetRotationMetadataOnSavedVideosKey = @"DontSetRotationMetadataOnSavedVideos";
 
 NSString *const DeckLinkDevicesModelID = @"DeckLink";       // on recent versions of Desktop Video (unknown when this changed
 
+// If set, video files are analyzed as fast as possible rather than at their frame rate, without dropping frames. The
+// frames in flight across all files are limited to the core budget (the number of active processors by default).
+static NSString *const AnalyzeVideoFilesInBatchKey = @"AnalyzeVideoFilesInBatch";
+static NSString *const BatchAnalysisCoreBudgetKey = @"BatchAnalysisCoreBudget";
+// If set to a folder, the frames analyzed from each source (other than frame recordings) are recorded there as frame
+// recordings, which can be opened to replay them exactly, as fast as possible, for regression and performance testing.
+static NSString *const RecordAnalyzedFramesFolderKey = @"RecordAnalyzedFramesFolder";
+static NSString *const FrameRecordingFilenameSafeDateFormat = @"yyyy-MM-dd HHmmss";
+
 
 NSURL *URLForAVCaptureDevice(AVCaptureDevice *device)
 {
@@ -72,6 +85,21 @@ BOOL DeviceIsUVCDevice(AVCaptureDevice *device)
     return modelID && [modelID rangeOfString:@"UVC"].location != NSNotFound;
 }
 
+// Shared by all documents analyzing files in batch. Each frame holds one unit from submission until it leaves the pipeline.
+static dispatch_semaphore_t BatchAnalysisCoreBudget()
+{
+    static dispatch_semaphore_t budget;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSInteger cores = [[NSUserDefaults standardUserDefaults] integerForKey:BatchAnalysisCoreBudgetKey];
+        if (cores <= 0) {
+            cores = [[NSProcessInfo processInfo] activeProcessorCount];
+        }
+        budget = dispatch_semaphore_create(cores);
+    });
+    return budget;
+}
+
 @interface VideoSourceDocument ()
 
 @property NSSize frameSize;
@@ -138,7 +166,7 @@ BOOL DeviceIsUVCDevice(AVCaptureDevice *device)
 
 + (NSArray *)readableTypes
 {
-    return @[ AVFCaptureDeviceFileType, BlackmagicDeckLinkCaptureDeviceFileType, @"public.movie" ];
+    return @[ AVFCaptureDeviceFileType, BlackmagicDeckLinkCaptureDeviceFileType, FrameRecordingFileType, @"public.movie" ];
 }
 
 + (NSArray *)writableTypes
@@ -159,9 +187,7 @@ BOOL DeviceIsUVCDevice(AVCaptureDevice *device)
         [_frameArrivalQueue setName:@"frame-arrival-queue"];
         [_frameArrivalQueue setMaxConcurrentOperationCount:1];
         
-        _frameProcessingQueue = [[NSOperationQueue alloc] init];
-        [_frameProcessingQueue setName:@"frame-processing-queue"];
-        [_frameProcessingQueue setMaxConcurrentOperationCount:1];
+        _conversionMailbox = [[FrameMailbox alloc] initWithName:@"conversion-mailbox"];
     }
     
     return self;
@@ -204,7 +230,7 @@ BOOL DeviceIsUVCDevice(AVCaptureDevice *device)
     
     // Create the window to hold the content view and contrain it to preserve the aspect ratio
     NSUInteger styleMask = NSWindowStyleMaskTitled | NSWindowStyleMaskMiniaturizable | NSWindowStyleMaskResizable;
-    if (_urlAsset) {
+    if (_urlAsset || _frameRecordingSource) {
         styleMask |= NSWindowStyleMaskClosable;
     }
     NSWindow *window = [[NSWindow alloc] initWithContentRect:contentRect styleMask:styleMask backing:NSBackingStoreBuffered defer:YES];
@@ -355,6 +381,15 @@ BOOL DeviceIsUVCDevice(AVCaptureDevice *device)
         [_deckLinkCaptureDevice setSampleBufferDelegate:self queue:_frameArrivalQueue];
         [_deckLinkCaptureDevice startCaptureWithSearchForModeWithModes:captureModes];
         success = YES;      // async and indefinite search
+    } else if ([typeName isEqual:FrameRecordingFileType]) {      // Frame recordings
+        RunLog(@"Opening frame recording \"%@\".", [self sourceIdentifier]);
+        _frameRecordingSource = [[FrameRecordingSource alloc] initWithPath:[absoluteURL path] error:outError];
+        if (_frameRecordingSource) {
+            [self setFrameSize:[_frameRecordingSource frameSize]];
+            success = YES;
+        }
+        fileSourceDisplayName = [[[self fileURL] path] lastPathComponent];
+        _analyzingInBatch = YES;        // replay is only useful if deterministic
     } else if ([absoluteURL isFileURL]) {           // Video files
         _urlAsset = [AVAsset assetWithURL:absoluteURL];
         if (_urlAsset && [[_urlAsset tracksWithMediaType:AVMediaTypeVideo] count] > 0) {
@@ -376,21 +411,61 @@ BOOL DeviceIsUVCDevice(AVCaptureDevice *device)
         }
         
         fileSourceDisplayName = [[[self fileURL] path] lastPathComponent];
-        
-        // Get the first frame (async)
-        NSTimeInterval frameInterval = 1.0 / [videoTrack nominalFrameRate];
-        [_frameArrivalQueue addOperationWithBlock:^{
-            [self getNextVideoFileFrameWithStartTime:CACurrentMediaTime() firstFrameTime:NAN frameInterval:frameInterval];
-        }];
+        _analyzingInBatch = [[NSUserDefaults standardUserDefaults] boolForKey:AnalyzeVideoFilesInBatchKey];
     }
     
     NSAssert(!_processor, @"processor already exists");
     _processor = [[VideoProcessor alloc] initWithFileOutputDelegate:self fileSourceDisplayName:fileSourceDisplayName];
+    [_processor setBatchMode:_analyzingInBatch];
+    [_processor setDisplayName:[self displayName]];
     [[VideoProcessorController sharedInstance] addVideoProcessor:_processor];
     
+    NSString *frameRecordingFolder = [[NSUserDefaults standardUserDefaults] stringForKey:RecordAnalyzedFramesFolderKey];
+    if (success && frameRecordingFolder && !_frameRecordingSource) {
+        [self beginRecordingAnalyzedFramesInFolder:frameRecordingFolder];
+    }
+    
+    // Get the first frame of a video file or frame recording (async)
+    if (_frameRecordingSource) {
+        RunLog(@"Replaying %lu frames (and %lu dropped frames) from \"%@\".", (unsigned long)[_frameRecordingSource frameCount],
+               (unsigned long)[_frameRecordingSource dropCount], [self sourceIdentifier]);
+        [_frameArrivalQueue addOperationWithBlock:^{
+            [self getNextRecordedFrame];
+        }];
+    } else if (_assetReaderOutput) {
+        if (_analyzingInBatch) {
+            RunLog(@"Analyzing \"%@\" in batch.", [self sourceIdentifier]);
+            [_frameArrivalQueue addOperationWithBlock:^{
+                [self getNextVideoFileFrameInBatch];
+            }];
+        } else {
+            NSTimeInterval frameInterval = 1.0 / [[_assetReaderOutput track] nominalFrameRate];
+            [_frameArrivalQueue addOperationWithBlock:^{
+                [self getNextVideoFileFrameWithStartTime:CACurrentMediaTime() firstFrameTime:NAN frameInterval:frameInterval];
+            }];
+        }
+    }
+    
     return success;
 }
 
+- (void)beginRecordingAnalyzedFramesInFolder:(NSString *)folder
+{
+    NSDateFormatter *dateFormatter = [[NSDateFormatter alloc] init];
+    [dateFormatter setDateFormat:FrameRecordingFilenameSafeDateFormat];
+    NSString *sourceName = [[self displayName] stringByReplacingOccurrencesOfString:@"/" withString:@"-"];
+    NSString *filename = [NSString stringWithFormat:@"%@ %@", sourceName, [dateFormatter stringFromDate:[NSDate date]]];
+    NSString *path = [[[folder stringByExpandingTildeInPath] stringByAppendingPathComponent:filename]
+                      stringByAppendingPathExtension:@"waframes"];
+    
+    NSError *error = nil;
+    if ([_processor beginRecordingFramesToPath:path error:&error]) {
+        RunLog(@"Recording analyzed frames to \"%@\".", path);
+    } else {
+        RunLog(@"Unable to record analyzed frames to \"%@\": %@", path, [error localizedDescription]);
+    }
+}
+
 // Called on main thread
 - (void)close
 {
@@ -416,6 +491,7 @@ BOOL DeviceIsUVCDevice(AVCaptureDevice *device)
         _sendFramesToAssetWriter = NO;
     }];
     [_frameArrivalQueue waitUntilAllOperationsAreFinished];
+    [_conversionMailbox close];
     
     [super close];
 }
@@ -457,6 +533,76 @@ BOOL DeviceIsUVCDevice(AVCaptureDevice *device)
     }
 }
 
+// For video file sources in batch mode. Called on _frameArrivalQueue, which is blocked while the pipeline is full, so that
+// frames are decoded only as fast as they can be processed and none are dropped.
+- (void)getNextVideoFileFrameInBatch
+{
+    if (_closeCalled) {
+        return;
+    }
+    
+    CMSampleBufferRef sampleBuffer = [_assetReaderOutput copyNextSampleBuffer];
+    if (sampleBuffer) {
+        // Use the media time as the presentation time, since the frames aren't processed at their frame rate
+        NSTimeInterval frameTime = CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sampleBuffer));
+        NSAssert(isfinite(frameTime), @"invalid frame time");
+        
+        dispatch_semaphore_t budget = BatchAnalysisCoreBudget();
+        dispatch_semaphore_wait(budget, DISPATCH_TIME_FOREVER);
+        [self processPixelBufferSynchronously:CMSampleBufferGetImageBuffer(sampleBuffer)
+                             presentationTime:frameTime
+                                   completion:^{
+                                       dispatch_semaphore_signal(budget);
+                                   }];
+        CFRelease(sampleBuffer);
+        
+        // Enqueue the next frame rather than looping so that the close operation can interleave
+        [_frameArrivalQueue addOperationWithBlock:^{
+            [self getNextVideoFileFrameInBatch];
+        }];
+    } else {
+        // Let the last frames finish before the results are reported on closing
+        [_processor waitUntilAllFramesAreProcessed];
+        [self videoPlaybackDidEnd];
+    }
+}
+
+// For frame recording sources, which are always replayed in batch, like getNextVideoFileFrameInBatch. The frames were
+// converted and flipped when recorded, so they go straight to the processor.
+- (void)getNextRecordedFrame
+{
+    if (_closeCalled) {
+        return;
+    }
+    
+    NSUInteger droppedFrameCount = 0;
+    VideoFrame *frame = [_frameRecordingSource nextFrameWithDroppedFrameCount:&droppedFrameCount];
+    for (NSUInteger i = 0; i < droppedFrameCount; i++) {
+        [_processor noteVideoFrameWasDropped];
+    }
+    if (frame) {
+        dispatch_semaphore_t budget = BatchAnalysisCoreBudget();
+        dispatch_semaphore_wait(budget, DISPATCH_TIME_FOREVER);
+        void (^debugFrameCallback)(DebugFrame *) = nil;
+        if ([_bitmapMetalView isVisible]) {
+            debugFrameCallback = ^(DebugFrame *debugFrame) {
+                [_bitmapMetalView renderImage:debugFrame];
+            };
+        }
+        [_processor processVideoFrame:frame debugFrameCallback:debugFrameCallback completion:^{
+            dispatch_semaphore_signal(budget);
+        }];
+        
+        // Enqueue the next frame rather than looping so that the close operation can interleave
+        [_frameArrivalQueue addOperationWithBlock:^{
+            [self getNextRecordedFrame];
+        }];
+    } else {
+        [_processor waitUntilAllFramesAreProcessed];
+        [self videoPlaybackDidEnd];
+    }
+}
+
 // Called on _frameArrivalQueue
 - (void)captureOutput:(AVCaptureOutput *)captureOutput didOutputSampleBuffer:(CMSampleBufferRef)sampleBuffer fromConnection:(AVCaptureConnection *)connection
 {
@@ -496,25 +642,26 @@ BOOL DeviceIsUVCDevice(AVCaptureDevice *device)
 // this is called on _frameArrivalQueue
 - (void)cmSampleBufferHasArrived:(CMSampleBufferRef)sampleBuffer
 {
-    if (_currentlyProcessingFrame) {
-        [_processor noteVideoFrameWasDropped];
-    } else {
-        _currentlyProcessingFrame = YES;
-        
-        // Get a Core Video image buffer for the media data
-        CVPixelBufferRef pixelBuffer = CVPixelBufferRetain(CMSampleBufferGetImageBuffer(sampleBuffer));
-        
-        // Do processing work on another (serial) queue so the arrival queue isn't blocked
-        // and new frames can be dropped in the interim
-        [_frameProcessingQueue addOperationWithBlock:^{
-            [self processPixelBufferSynchronously:pixelBuffer];
-            CVPixelBufferRelease(pixelBuffer);
-            
-            // Mark that we're done
-            [_frameArrivalQueue addOperationWithBlock:^{
-                _currentlyProcessingFrame = NO;
-            }];
+    // Use CPU (Mach) time to ensure a monotonically increasing time. It can later be subtracted from the current time
+    // to determine the sample time/date. Taking it at arrival lets the processor measure the end-to-end latency.
+    NSTimeInterval captureTime = CACurrentMediaTime();
+    
+    // Decimate to a rate that the processor can keep up with. Otherwise, hand the frame to the conversion thread so
+    // the arrival queue isn't blocked. If the previous frame is still waiting there (i.e. the pipeline is backed up
+    // anyway), it is dropped in favor of this one so that the freshest frame is processed next.
+    NSTimeInterval sourceTime = CMTimeGetSeconds(CMSampleBufferGetPresentationTimeStamp(sampleBuffer));
+    if (!isfinite(sourceTime)) {
+        sourceTime = captureTime;
+    }
+    if ([_processor shouldProcessFrameArrivingAtTime:sourceTime]) {
+        // Bridge the pixel buffer to an object so that the block retains it, including if the block is dropped
+        id pixelBuffer = (__bridge id)CMSampleBufferGetImageBuffer(sampleBuffer);
+        BOOL replaced = ![_conversionMailbox depositFrameOperationWithBlock:^{
+            [self processPixelBufferSynchronously:(__bridge CVPixelBufferRef)pixelBuffer presentationTime:captureTime completion:nil];
         }];
+        if (replaced) {
+            [_processor noteVideoFrameWasDropped];
+        }
     }
     
     // Send all frames to the asset writer if enabled
@@ -534,8 +681,10 @@ BOOL DeviceIsUVCDevice(AVCaptureDevice *device)
     }
 }
 
-// called on _frameProcessingQueue to avoid blocking the arrival queue
+// called on the _conversionMailbox thread to avoid blocking the arrival queue, or on the arrival queue in batch mode
 - (void)processPixelBufferSynchronously:(CVImageBufferRef)pixelBuffer
+                       presentationTime:(NSTimeInterval)presentationTime
+                             completion:(void (^)(void))completion
 {
     // Get the proper frame size for this device, correcting for non-square pixels.
     // AVCaptureDecompressedVideoOutput is guaranteed to be a CVPixelBufferRef.
@@ -581,11 +730,21 @@ BOOL DeviceIsUVCDevice(AVCaptureDevice *device)
         [self performSelectorOnMainThread:@selector(adjustWindowSizing) withObject:nil waitUntilDone:NO];
     }
     
-    // Use CPU (Mach) time to ensure a monotonically increasing time. It can later be subtracted from the current time to determine the sample time/date.
-    VideoFrame *image = [[VideoFrame alloc] initByCopyingCVPixelBuffer:pixelBuffer naturalSize:[self frameSize] presentationTime:CACurrentMediaTime()];
-    [_processor processVideoFrame:image debugFrameCallback:^(VideoFrame *image) {
-        [_bitmapMetalView renderImage:image];
-    }];
+    // The frame is flipped to the plate orientation as it is copied, rather than separately by the processor, and is
+    // copied over the processor's share of the cores.
+    VideoFrame *image = [[VideoFrame alloc] initByCopyingCVPixelBuffer:pixelBuffer
+                                                           naturalSize:[self frameSize]
+                                                                  flip:[_processor currentFrameFlip]
+                                                    maximumConcurrency:[_processor coreShare]
+                                                      presentationTime:presentationTime];
+    // Only request the debug frame if it would be seen, so that no debug drawing is done otherwise
+    void (^debugFrameCallback)(DebugFrame *) = nil;
+    if ([_bitmapMetalView isVisible]) {
+        debugFrameCallback = ^(DebugFrame *debugFrame) {
+            [_bitmapMetalView renderImage:debugFrame];
+        };
+    }
+    [_processor processVideoFrame:image debugFrameCallback:debugFrameCallback completion:completion];
 }
 
 - (void)videoPlaybackDidEnd
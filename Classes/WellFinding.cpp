@@ -6,21 +6,29 @@
 //  Copyright 2011 Chris Marcellino. All rights reserved.
 //
 
-#import <math.h>
-#import <dispatch/dispatch.h>
-#import <opencv2/core/core.hpp>
-#import <opencv2/imgproc/imgproc.hpp>
-#import <opencv2/imgproc/imgproc_c.h>
-#import "WellFinding.hpp"
-#import "CvUtilities.hpp"
-#import "NSOperationQueue-Utility.h"
+#include <math.h>
+#include <float.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <sstream>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/imgproc/imgproc_c.h>
+#include "WellFinding.hpp"
+#include "CvUtilities.hpp"
+#include "DebugOverlay.hpp"
+#include "ParallelReduce.hpp"
+#include "Tracing.hpp"
 
-static bool findWellCirclesForWellCounts(IplImage* inputImage, std::vector<int> wellCounts, std::vector<Circle> &circles);
+static bool findWellCirclesForWellCounts(IplImage* inputImage, std::vector<int> wellCounts, std::vector<Circle> &circles,
+                                         unsigned maximumConcurrency);
 
 static bool findWellCirclesForWellCountsUsingImage(IplImage* image,
                                                    const std::vector<int> &wellCounts,
                                                    std::vector<Circle> *circles,
                                                    double *score,
+                                                   unsigned maximumConcurrency,
                                                    int expectedRadius = -1);
 
 static bool findWellCirclesForWellCountUsingImage(IplImage* image,
@@ -76,7 +84,7 @@ bool getPlateConfigurationForWellCount(int wellCount, int &rows, int &columns)
     return valid;
 }
 
-bool findWellCircles(IplImage* inputImage, std::vector<Circle> &circles, int wellCountHint)
+bool findWellCircles(IplImage* inputImage, std::vector<Circle> &circles, unsigned maximumConcurrency, int wellCountHint)
 {
     // Create the array of counts that we will try in order, but move the hinted value to the front
     std::vector<int> wellCounts = knownPlateWellCounts();
@@ -90,15 +98,16 @@ bool findWellCircles(IplImage* inputImage, std::vector<Circle> &circles, int wel
         wellCounts.insert(wellCounts.begin(), wellCountHint);
     }
     
-    return findWellCirclesForWellCounts(inputImage, wellCounts, circles);
+    return findWellCirclesForWellCounts(inputImage, wellCounts, circles, maximumConcurrency);
 }
 
-bool findWellCirclesForWellCount(IplImage* inputImage, int wellCount, std::vector<Circle> &circlesVec)
+bool findWellCirclesForWellCount(IplImage* inputImage, int wellCount, std::vector<Circle> &circlesVec, unsigned maximumConcurrency)
 {
-    return findWellCirclesForWellCounts(inputImage, std::vector<int>(1, wellCount), circlesVec);
+    return findWellCirclesForWellCounts(inputImage, std::vector<int>(1, wellCount), circlesVec, maximumConcurrency);
 }
 
-static bool findWellCirclesForWellCounts(IplImage* inputImage, std::vector<int> wellCounts, std::vector<Circle> &circles)
+static bool findWellCirclesForWellCounts(IplImage* inputImage, std::vector<int> wellCounts, std::vector<Circle> &circles,
+                                         unsigned maximumConcurrency)
 {
     // Only report failed circle sets if they are not too noisy
     double score = 0.75;
@@ -106,13 +115,13 @@ static bool findWellCirclesForWellCounts(IplImage* inputImage, std::vector<int>
     // Convert the input image to grayscale
     IplImage* grayscaleImage = cvCreateImage(cvGetSize(inputImage), IPL_DEPTH_8U, 1);
     cvCvtColor(inputImage, grayscaleImage, CV_BGRA2GRAY);
-    bool success = findWellCirclesForWellCountsUsingImage(grayscaleImage, wellCounts, &circles, &score);
+    bool success = findWellCirclesForWellCountsUsingImage(grayscaleImage, wellCounts, &circles, &score, maximumConcurrency);
     
     // If not found and we didn't have an expected radius, try again but seed with the mean radius of the wells that were found.
     if (!success) {
         int meanRadiusFound = (int)meanRadiusForCircles(circles);
         if (meanRadiusFound > 0) {
-            success = findWellCirclesForWellCountsUsingImage(grayscaleImage, wellCounts, &circles, &score, meanRadiusFound);
+            success = findWellCirclesForWellCountsUsingImage(grayscaleImage, wellCounts, &circles, &score, maximumConcurrency, meanRadiusFound);
         }
     }
     cvReleaseImage(&grayscaleImage);
@@ -124,11 +133,11 @@ static bool findWellCirclesForWellCounts(IplImage* inputImage, std::vector<int>
         cvCvtColor(unsharpMask, grayscaleUnsharpMaskImage, CV_BGRA2GRAY);
         cvReleaseImage(&unsharpMask);
         
-        success = findWellCirclesForWellCountsUsingImage(grayscaleUnsharpMaskImage, wellCounts, &circles, &score);
+        success = findWellCirclesForWellCountsUsingImage(grayscaleUnsharpMaskImage, wellCounts, &circles, &score, maximumConcurrency);
         if (!success) {
             int meanRadiusFound = (int)meanRadiusForCircles(circles);
             if (meanRadiusFound > 0) {
-                success = findWellCirclesForWellCountsUsingImage(grayscaleUnsharpMaskImage, wellCounts, &circles, &score, meanRadiusFound);
+                success = findWellCirclesForWellCountsUsingImage(grayscaleUnsharpMaskImage, wellCounts, &circles, &score, maximumConcurrency, meanRadiusFound);
             }
         }
         cvReleaseImage(&grayscaleUnsharpMaskImage);
@@ -141,26 +150,31 @@ static bool findWellCirclesForWellCountsUsingImage(IplImage* image,
                                                    const std::vector<int> &wellCounts,
                                                    std::vector<Circle> *circles,
                                                    double *score,           // if unsuccessful, will return wells and false if we meet this score, and sets score
+                                                   unsigned maximumConcurrency,
                                                    int expectedRadius)
 {
-    __block bool success = false;
-    
-    // Execute searches for different plate sizes in parallel
-    [NSOperationQueue addOperationsInParallelWithInstances:wellCounts.size() onGlobalQueueForBlock:^(NSUInteger i, id criticalSection) {
-        std::vector<Circle> currentCircles;
-        double currentScore = DBL_MIN;
-        bool currentSuccess = findWellCirclesForWellCountUsingImage(image, wellCounts[i], currentCircles, currentScore, expectedRadius);
-        
-        @synchronized(criticalSection) {
-            if (!success && (currentSuccess || currentScore > *score)) {
-                success = currentSuccess;
-                *score = currentScore;
-                *circles = currentCircles;
-            }
-        }
-    }];
-    
-    return success;
+    // Execute searches for different plate sizes in parallel. The first plate size (in the order given) that is found
+    // wins, or failing that the best scoring one that beats the given score, as if they were searched one at a time.
+    struct Search {
+        bool success;
+        double score;
+        std::vector<Circle> circles;
+    };
+    Search initialSearch = { false, *score, std::vector<Circle>() };
+    Search search = parallelReduce(wellCounts.size(), maximumConcurrency, initialSearch, [&](size_t i) {
+        TraceSpan span("find wells for count", NAN, "wells", wellCounts[i]);
+        Search currentSearch = { false, DBL_MIN, std::vector<Circle>() };
+        currentSearch.success = findWellCirclesForWellCountUsingImage(image, wellCounts[i], currentSearch.circles, currentSearch.score, expectedRadius);
+        return currentSearch;
+    }, [](const Search &a, const Search &b) {
+        return a.success || (!b.success && b.score <= a.score) ? a : b;
+    });
+
+    if (search.success || search.score > *score) {
+        *score = search.score;
+        *circles = search.circles;
+    }
+    return search.success;
 }
 
 static bool findWellCirclesForWellCountUsingImage(IplImage* image,
@@ -400,7 +414,7 @@ bool plateSequentialCirclesAppearSameAndStationary(const std::vector<Circle> &ci
     return averageMagnitude < radiusCurrent / 4;
 }
 
-static IplImage* createUnsharpMaskImage(IplImage* image, float radius, float amount, float threshold)
+static IplImage* createUnsharpMaskImage(IplImage* image, float radius, float amount, float /* threshold */)
 {
     IplImage* source = cvCreateImage(cvGetSize(image), IPL_DEPTH_32F, image->nChannels);
     cvConvert(image, source);
@@ -422,25 +436,43 @@ static IplImage* createUnsharpMaskImage(IplImage* image, float radius, float amo
     return result;
 }
 
-void drawWellCirclesAndLabelsOnDebugImage(std::vector<Circle> circles, CvScalar circleColor, bool drawLabels, IplImage* debugImage)
+void orderWellCirclesForFlippedImage(std::vector<Circle> &circles, bool flipHorizontally, bool flipVertically)
+{
+    int rows, columns;
+    if (!getPlateConfigurationForWellCount((int)circles.size(), rows, columns)) {
+        return;
+    }
+    
+    std::vector<Circle> ordered;
+    ordered.reserve(circles.size());
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+            int unflippedRow = flipVertically ? rows - 1 - row : row;
+            int unflippedColumn = flipHorizontally ? columns - 1 - column : column;
+            ordered.push_back(circles[unflippedRow * columns + unflippedColumn]);
+        }
+    }
+    circles.swap(ordered);
+}
+
+void drawWellCirclesAndLabelsOnDebugOverlay(const std::vector<Circle> &circles, CvScalar circleColor, bool drawLabels, DebugOverlay &debugOverlay)
 {
-    CvFont wellFont = fontForNormalizedScale(1.0, debugImage);
+    CvFont wellFont = fontForNormalizedScale(1.0, debugOverlay.size());
     
     for (int i = 0; i < (int)circles.size(); i++) {
         CvPoint center = cvPoint(circles[i].center[0], circles[i].center[1]);
         int radius = circles[i].radius;
         
         // Draw the circle outline
-        cvCircle(debugImage, center, radius, circleColor, 3, 8, 0);
+        debugOverlay.drawCircle(center, radius, circleColor, 3);
         
         // Draw the well labels
         if (drawLabels) {
             CvPoint textPoint = cvPoint(center.x - radius, center.y - 0.9 * radius);
-            cvPutText(debugImage,
-                      wellIdentifierStringForIndex(i, (int)circles.size()).c_str(),
-                      textPoint,
-                      &wellFont,
-                      CV_RGBA(0, 255, 255, 255));
+            debugOverlay.drawText(wellIdentifierStringForIndex(i, (int)circles.size()),
+                                  textPoint,
+                                  wellFont,
+                                  CV_RGBA(0, 255, 255, 255));
         }
     }
 }
@@ -6,8 +6,14 @@
 //  Copyright 2011 Chris Marcellino. All rights reserved.
 //
 
-#import <vector>
-#import <opencv2/core/core_c.h>
+#ifndef WellFinding_hpp
+#define WellFinding_hpp
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core_c.h>
+
+class DebugOverlay;
 
 // C compatible Circle structure
 typedef struct {
@@ -24,9 +30,10 @@ extern bool getPlateConfigurationForWellCount(int wellCount, int &rows, int &col
 
 // Returns true if the circles found correspond to the intended plate configuration. Well circles are returned in 
 // row major order, as (x-center, y-center, radius) triples. The first version determines the well count automatically.
-// The second provides a lower latency to failure when the number of wells expected is known. 
-extern bool findWellCircles(IplImage* inputImage, std::vector<Circle> &circles, int wellCountHint = -1);
-extern bool findWellCirclesForWellCount(IplImage* inputImage, int wellCount, std::vector<Circle> &circlesVec);
+// The second provides a lower latency to failure when the number of wells expected is known. The plate sizes are
+// searched in parallel over up to maximumConcurrency cores (e.g. the background share, see CoreBudget).
+extern bool findWellCircles(IplImage* inputImage, std::vector<Circle> &circles, unsigned maximumConcurrency, int wellCountHint = -1);
+extern bool findWellCirclesForWellCount(IplImage* inputImage, int wellCount, std::vector<Circle> &circlesVec, unsigned maximumConcurrency);
 
 // Calcualtes the arithmetic mean of the circles' centers
 extern CvPoint plateCenterForWellCircles(const std::vector<Circle> &circles);
@@ -35,8 +42,13 @@ extern CvPoint plateCenterForWellCircles(const std::vector<Circle> &circles);
 extern bool plateSequentialCirclesAppearSameAndStationary(const std::vector<Circle> &circlesPrevious,
                                                           const std::vector<Circle> &circlesCurrent);
 
-// Draws circles and labels on an image
-extern void drawWellCirclesAndLabelsOnDebugImage(std::vector<Circle> circles, CvScalar circleColor, bool drawLabels, IplImage* debugImage);
+// Reorders circles returned in row major order from an image into the row major order they would have been returned in
+// had the image been flipped, without changing their coordinates. This applies a plate orientation to the well indices
+// (see wellIdentifierStringForIndex) without flipping the image itself.
+extern void orderWellCirclesForFlippedImage(std::vector<Circle> &circles, bool flipHorizontally, bool flipVertically);
+
+// Draws circles and labels on a debug overlay
+extern void drawWellCirclesAndLabelsOnDebugOverlay(const std::vector<Circle> &circles, CvScalar circleColor, bool drawLabels, DebugOverlay &debugOverlay);
 
 // Returns the canonical identifier string (e.g. "A3") for the index in the given plate type.
 extern std::string wellIdentifierStringForIndex(int index, int wellCount);
@@ -46,3 +58,5 @@ static inline CvRect boundingSquareForCircle(Circle circle)
     float radius = circle.radius;
     return cvRect(circle.center[0] - radius, circle.center[1] - radius, 2 * radius, 2 * radius);
 }
+
+#endif
@@ -0,0 +1,179 @@
+//
+//  WorkDecomposer.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef WorkDecomposer_hpp
+#define WorkDecomposer_hpp
+
+#include <math.h>
+#include <stddef.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "ParallelFor.hpp"
+
+// Divides a parallel loop over items of varying cost (e.g. the wells of a plate) into units of work sized to the cores
+// available, using a cost model learned from how long each item took in recent loops. Consecutive cheap items are
+// batched into one unit, so that e.g. a 96 well plate doesn't pay to schedule each of its small wells. If the caller
+// can split an item into bands of rows (tiles), costly items are split into several units, so that e.g. a 1 or 6 well
+// plate can use more cores than it has wells. The costliest units are started first. Until every item has been timed,
+// each item is its own unit, as with parallelFor(). Not thread-safe; each loop (e.g. each stage of a plate's analysis)
+// should have its own.
+class WorkDecomposer {
+public:
+    struct Unit {
+        size_t firstItem;
+        size_t itemCount;               // 1 if the item is tiled
+        int tile;                       // in [0, tileCount)
+        int tileCount;                  // 1 unless the item is split
+        double estimatedSeconds;
+    };
+
+    explicit WorkDecomposer(double minimumUnitSeconds = DefaultMinimumUnitSeconds)
+        : _minimumUnitSeconds(minimumUnitSeconds)
+    {
+    }
+
+    // Sets units to those to run itemCount items on up to maximumConcurrency threads, splitting each item into at most
+    // maximumTileCount tiles (1 if the items can't be split). The vector's storage is reused.
+    void decompose(size_t itemCount, unsigned maximumConcurrency, int maximumTileCount, std::vector<Unit> &units)
+    {
+        if (_itemSeconds.size() != itemCount) {
+            _itemSeconds.assign(itemCount, NAN);
+        }
+        unsigned workerCount = std::max(maximumConcurrency, 1U);
+        bool measured = std::none_of(_itemSeconds.begin(), _itemSeconds.end(), [](double seconds) { return isnan(seconds); });
+
+        units.clear();
+        if (!measured || workerCount == 1) {
+            for (size_t i = 0; i < itemCount; i++) {
+                Unit unit = { i, 1, 0, 1, measured ? _itemSeconds[i] : 0.0 };
+                units.push_back(unit);
+            }
+            return;
+        }
+
+        // Aim for several units per worker, so that they balance even if the estimates are off, but none so small that
+        // scheduling it costs more than it saves
+        double totalSeconds = 0.0;
+        for (size_t i = 0; i < itemCount; i++) {
+            totalSeconds += _itemSeconds[i];
+        }
+        double targetSeconds = std::max(totalSeconds / (workerCount * UnitsPerWorker), _minimumUnitSeconds);
+
+        Unit batch = { 0, 0, 0, 1, 0.0 };
+        for (size_t i = 0; i < itemCount; i++) {
+            double seconds = _itemSeconds[i];
+            int tileCount = std::min<int>(std::min<double>(ceil(seconds / targetSeconds), maximumTileCount), workerCount);
+            if (tileCount > 1 && seconds > targetSeconds * TilingThreshold) {
+                if (batch.itemCount > 0) {
+                    units.push_back(batch);
+                    batch.itemCount = 0;
+                }
+                for (int tile = 0; tile < tileCount; tile++) {
+                    Unit unit = { i, 1, tile, tileCount, seconds / tileCount };
+                    units.push_back(unit);
+                }
+            } else {
+                if (batch.itemCount > 0 && batch.estimatedSeconds + seconds > targetSeconds) {
+                    units.push_back(batch);
+                    batch.itemCount = 0;
+                }
+                if (batch.itemCount == 0) {
+                    batch.firstItem = i;
+                    batch.estimatedSeconds = 0.0;
+                }
+                batch.itemCount++;
+                batch.estimatedSeconds += seconds;
+            }
+        }
+        if (batch.itemCount > 0) {
+            units.push_back(batch);
+        }
+
+        std::stable_sort(units.begin(), units.end(), [](const Unit &a, const Unit &b) {
+            return a.estimatedSeconds > b.estimatedSeconds;
+        });
+    }
+
+    // Adds the time an item took (over all of its tiles) to its moving average
+    void addItemSeconds(size_t item, double seconds)
+    {
+        double &mean = _itemSeconds[item];
+        mean = isnan(mean) ? seconds : mean + (seconds - mean) * CostSmoothing;
+    }
+
+    // Calls body(item, tile, tileCount) for each tile of each item, running the units with
+    // parallelLoop(unitCount, runUnit), which must call runUnit(u) for each u in [0, unitCount) concurrently (e.g.
+    // parallelFor() or a TaskScheduler lane), and then learns from the items' times. The items' results must not depend
+    // on how they were divided. Once the decomposer has run a loop of as many items, this makes no heap allocations.
+    template <typename ParallelLoop, typename Body>
+    void run(size_t itemCount, unsigned maximumConcurrency, int maximumTileCount, const ParallelLoop &parallelLoop, const Body &body)
+    {
+        std::vector<Unit> &units = _units;
+        decompose(itemCount, maximumConcurrency, maximumTileCount, units);
+        std::vector<double> &itemSeconds = _runItemSeconds;     // each written by only the unit that has the item
+        std::vector<double> &tileSeconds = _runTileSeconds;
+        itemSeconds.assign(itemCount, 0.0);
+        tileSeconds.assign(units.size(), 0.0);
+        auto runUnit = [&](size_t u) {
+            const Unit &unit = units[u];
+            for (size_t i = unit.firstItem; i < unit.firstItem + unit.itemCount; i++) {
+                std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+                body(i, unit.tile, unit.tileCount);
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+                if (unit.tileCount > 1) {
+                    tileSeconds[u] = seconds;
+                } else {
+                    itemSeconds[i] = seconds;
+                }
+            }
+        };
+        parallelLoop(units.size(), runUnit);
+
+        for (size_t u = 0; u < units.size(); u++) {
+            if (units[u].tileCount > 1) {
+                itemSeconds[units[u].firstItem] += tileSeconds[u];
+            }
+        }
+        for (size_t i = 0; i < itemCount; i++) {
+            addItemSeconds(i, itemSeconds[i]);
+        }
+    }
+
+    // As above, running the units with parallelFor()
+    template <typename Body>
+    void run(size_t itemCount, unsigned maximumConcurrency, int maximumTileCount, const Body &body)
+    {
+        run(itemCount, maximumConcurrency, maximumTileCount, [&](size_t unitCount, const auto &runUnit) {
+            parallelFor(unitCount, maximumConcurrency, runUnit);
+        }, body);
+    }
+
+    // The rows of a tile of an image (or ROI) of the given height, which are divided as evenly as possible
+    static void rowsForTile(int height, int tile, int tileCount, int &firstRow, int &rowCount)
+    {
+        firstRow = (int)((long long)height * tile / tileCount);
+        rowCount = (int)((long long)height * (tile + 1) / tileCount) - firstRow;
+    }
+
+private:
+    static constexpr double DefaultMinimumUnitSeconds = 100e-6;
+    static constexpr double UnitsPerWorker = 4.0;
+    static constexpr double TilingThreshold = 1.5;      // of the target unit cost, to be worth splitting
+    static constexpr double CostSmoothing = 0.2;
+
+    std::vector<double> _itemSeconds;           // moving averages, NAN until timed
+    double _minimumUnitSeconds;
+
+    // The storage of run(), kept between loops
+    std::vector<Unit> _units;
+    std::vector<double> _runItemSeconds;
+    std::vector<double> _runTileSeconds;
+};
+
+#endif
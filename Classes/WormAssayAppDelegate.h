@@ -28,6 +28,7 @@
 - (IBAction)showLoggingAndNotificationSettings:(id)sender;
 - (IBAction)plateOrientationWasSelected:(id)sender;
 - (IBAction)manuallyReportResultsAndResetProcessor:(id)sender;
+- (IBAction)savePerformanceTrace:(id)sender;
 
 @end
 
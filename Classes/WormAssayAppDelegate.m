@@ -295,6 +295,24 @@ static NSString *const UseBlackmagicDeckLinkDriverDefaultsKey = @"UseBlackmagicD
     [[VideoProcessorController sharedInstance] manuallyReportResultsForCurrentProcessor];
 }
 
+- (IBAction)savePerformanceTrace:(id)sender
+{
+    NSSavePanel *savePanel = [NSSavePanel savePanel];
+    [savePanel setAllowedFileTypes:@[ @"json" ]];
+    [savePanel setNameFieldStringValue:@"WormAssay Performance Trace.json"];
+    [savePanel beginWithCompletionHandler:^(NSModalResponse result) {
+        if (result == NSModalResponseOK) {
+            NSString *path = [[savePanel URL] path];
+            NSError *error = nil;
+            if ([VideoProcessor writePerformanceTraceToPath:path error:&error]) {
+                RunLog(@"Saved performance trace to \"%@\".", path);
+            } else {
+                [[NSAlert alertWithError:error] runModal];
+            }
+        }
+    }];
+}
+
 @end
 
 NSString *formattedDataSize(unsigned long long bytes)
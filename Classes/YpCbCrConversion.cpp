@@ -0,0 +1,263 @@
+//
+//  YpCbCrConversion.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#include "YpCbCrConversion.hpp"
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// The vector paths compute the same three chroma terms per pixel pair in 32-bit lanes with arithmetic right shifts,
+// then add the luma in 16-bit lanes and clamp by saturating to 8 bits, which is exactly the scalar math below.
+
+// cb and cr are - 128 here
+#define YpCbCr2RGB(y, cb, cr, r, g, b)\
+r = y + ((cr * 1404) >> 10);\
+g = y - ((cr * 715 + cb * 344) >> 10);\
+b = y + ((cb * 1774) >> 10);\
+r = r < 0 ? 0 : r;\
+g = g < 0 ? 0 : g;\
+b = b < 0 ? 0 : b;\
+r = r > 255 ? 255 : r;\
+g = g > 255 ? 255 : g;\
+b = b > 255 ? 255 : b
+
+// Converts pairs [firstPair, pairCount) of a row
+static void convertRowScalar(const uint8_t *src, uint8_t *dest, int firstPair, int pairCount)
+{
+    // Byte order UYVY
+    int i = firstPair * 4, j = firstPair * 8;
+    const int srcMax = pairCount * 4;
+    while (i < srcMax) {
+        int cb = (uint8_t)src[i++] - 128;
+        int y0 = (uint8_t)src[i++];
+        int cr = (uint8_t)src[i++] - 128;
+        int y1 = (uint8_t)src[i++];
+        int r, g, b;
+        YpCbCr2RGB(y1, cb, cr, r, g, b);
+        dest[j++] = b;
+        dest[j++] = g;
+        dest[j++] = r;
+        dest[j++] = 255;        // a
+        YpCbCr2RGB(y0, cb, cr, r, g, b);
+        dest[j++] = b;
+        dest[j++] = g;
+        dest[j++] = r;
+        dest[j++] = 255;        // a
+    }
+}
+
+#if defined(__SSE2__)
+
+// Converts 4 pairs (one per 32-bit lane) to 8 pixels
+static inline void convertPairsSSE2(__m128i v, uint8_t *dest)
+{
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    const __m128i lowMask = _mm_set1_epi32(0xFFFF);
+    const __m128i bias = _mm_set1_epi32(128);
+    __m128i cb = _mm_sub_epi32(_mm_and_si128(v, byteMask), bias);
+    __m128i y0 = _mm_and_si128(_mm_srli_epi32(v, 8), byteMask);
+    __m128i cr = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(v, 16), byteMask), bias);
+    __m128i y1 = _mm_srli_epi32(v, 24);
+
+    // The 16-bit multiply-adds sum the low and high halves of each lane, so the chroma goes in the low half with
+    // a zero (or the other chroma term) in the high half
+    __m128i crLow = _mm_and_si128(cr, lowMask);
+    __m128i cbLow = _mm_and_si128(cb, lowMask);
+    __m128i dr = _mm_srai_epi32(_mm_madd_epi16(crLow, _mm_set1_epi32(1404)), 10);
+    __m128i dg = _mm_srai_epi32(_mm_madd_epi16(_mm_or_si128(crLow, _mm_slli_epi32(cb, 16)), _mm_set1_epi32(715 | (344 << 16))), 10);
+    __m128i db = _mm_srai_epi32(_mm_madd_epi16(cbLow, _mm_set1_epi32(1774)), 10);
+
+    // 16-bit channel values, with the y1 pixels in the low half and the y0 pixels in the high half
+    __m128i b = _mm_packs_epi32(_mm_add_epi32(y1, db), _mm_add_epi32(y0, db));
+    __m128i g = _mm_packs_epi32(_mm_sub_epi32(y1, dg), _mm_sub_epi32(y0, dg));
+    __m128i r = _mm_packs_epi32(_mm_add_epi32(y1, dr), _mm_add_epi32(y0, dr));
+
+    // Clamp to bytes and interleave to BGRA
+    __m128i bg = _mm_packus_epi16(b, g);                            // b1 x4, b0 x4, g1 x4, g0 x4
+    __m128i ra = _mm_packus_epi16(r, _mm_set1_epi16(255));          // r1 x4, r0 x4, 255 x8
+    bg = _mm_unpacklo_epi8(bg, _mm_srli_si128(bg, 8));
+    ra = _mm_unpacklo_epi8(ra, _mm_srli_si128(ra, 8));
+    __m128i pixels1 = _mm_unpacklo_epi16(bg, ra);
+    __m128i pixels0 = _mm_unpackhi_epi16(bg, ra);
+    _mm_storeu_si128((__m128i *)dest, _mm_unpacklo_epi32(pixels1, pixels0));
+    _mm_storeu_si128((__m128i *)(dest + 16), _mm_unpackhi_epi32(pixels1, pixels0));
+}
+
+static void convertRowSSE2(const uint8_t *src, uint8_t *dest, int pairCount)
+{
+    int i = 0;
+    for (; i + 4 <= pairCount; i += 4) {
+        convertPairsSSE2(_mm_loadu_si128((const __m128i *)(src + i * 4)), dest + i * 8);
+    }
+    convertRowScalar(src, dest, i, pairCount);
+}
+
+// As above, but 8 pairs at once. The packs and unpacks operate within each 128-bit half, so the halves are reordered
+// at the end.
+__attribute__((target("avx2")))
+static void convertRowAVX2(const uint8_t *src, uint8_t *dest, int pairCount)
+{
+    const __m256i byteMask = _mm256_set1_epi32(0xFF);
+    const __m256i lowMask = _mm256_set1_epi32(0xFFFF);
+    const __m256i bias = _mm256_set1_epi32(128);
+    int i = 0;
+    for (; i + 8 <= pairCount; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+        __m256i cb = _mm256_sub_epi32(_mm256_and_si256(v, byteMask), bias);
+        __m256i y0 = _mm256_and_si256(_mm256_srli_epi32(v, 8), byteMask);
+        __m256i cr = _mm256_sub_epi32(_mm256_and_si256(_mm256_srli_epi32(v, 16), byteMask), bias);
+        __m256i y1 = _mm256_srli_epi32(v, 24);
+
+        __m256i crLow = _mm256_and_si256(cr, lowMask);
+        __m256i cbLow = _mm256_and_si256(cb, lowMask);
+        __m256i dr = _mm256_srai_epi32(_mm256_madd_epi16(crLow, _mm256_set1_epi32(1404)), 10);
+        __m256i dg = _mm256_srai_epi32(_mm256_madd_epi16(_mm256_or_si256(crLow, _mm256_slli_epi32(cb, 16)), _mm256_set1_epi32(715 | (344 << 16))), 10);
+        __m256i db = _mm256_srai_epi32(_mm256_madd_epi16(cbLow, _mm256_set1_epi32(1774)), 10);
+
+        __m256i b = _mm256_packs_epi32(_mm256_add_epi32(y1, db), _mm256_add_epi32(y0, db));
+        __m256i g = _mm256_packs_epi32(_mm256_sub_epi32(y1, dg), _mm256_sub_epi32(y0, dg));
+        __m256i r = _mm256_packs_epi32(_mm256_add_epi32(y1, dr), _mm256_add_epi32(y0, dr));
+
+        __m256i bg = _mm256_packus_epi16(b, g);
+        __m256i ra = _mm256_packus_epi16(r, _mm256_set1_epi16(255));
+        bg = _mm256_unpacklo_epi8(bg, _mm256_srli_si256(bg, 8));
+        ra = _mm256_unpacklo_epi8(ra, _mm256_srli_si256(ra, 8));
+        __m256i pixels1 = _mm256_unpacklo_epi16(bg, ra);
+        __m256i pixels0 = _mm256_unpackhi_epi16(bg, ra);
+        __m256i pairs0145 = _mm256_unpacklo_epi32(pixels1, pixels0);
+        __m256i pairs2367 = _mm256_unpackhi_epi32(pixels1, pixels0);
+        _mm256_storeu_si256((__m256i *)(dest + i * 8), _mm256_permute2x128_si256(pairs0145, pairs2367, 0x20));
+        _mm256_storeu_si256((__m256i *)(dest + i * 8 + 32), _mm256_permute2x128_si256(pairs0145, pairs2367, 0x31));
+    }
+    convertRowScalar(src, dest, i, pairCount);
+}
+
+#endif
+
+#if defined(__ARM_NEON)
+
+static inline int16x8_t chromaTermNEON(int16x8_t c, int16_t coefficient)
+{
+    int32x4_t low = vshrq_n_s32(vmull_n_s16(vget_low_s16(c), coefficient), 10);
+    int32x4_t high = vshrq_n_s32(vmull_n_s16(vget_high_s16(c), coefficient), 10);
+    return vcombine_s16(vmovn_s32(low), vmovn_s32(high));
+}
+
+static void convertRowNEON(const uint8_t *src, uint8_t *dest, int pairCount)
+{
+    const int16x8_t bias = vdupq_n_s16(128);
+    int i = 0;
+    for (; i + 8 <= pairCount; i += 8) {
+        uint8x8x4_t uyvy = vld4_u8(src + i * 4);        // deinterleaves to cb, y0, cr, y1
+        int16x8_t cb = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(uyvy.val[0])), bias);
+        int16x8_t y0 = vreinterpretq_s16_u16(vmovl_u8(uyvy.val[1]));
+        int16x8_t cr = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(uyvy.val[2])), bias);
+        int16x8_t y1 = vreinterpretq_s16_u16(vmovl_u8(uyvy.val[3]));
+
+        int16x8_t dr = chromaTermNEON(cr, 1404);
+        int16x8_t db = chromaTermNEON(cb, 1774);
+        int32x4_t dgLow = vshrq_n_s32(vmlal_n_s16(vmull_n_s16(vget_low_s16(cr), 715), vget_low_s16(cb), 344), 10);
+        int32x4_t dgHigh = vshrq_n_s32(vmlal_n_s16(vmull_n_s16(vget_high_s16(cr), 715), vget_high_s16(cb), 344), 10);
+        int16x8_t dg = vcombine_s16(vmovn_s32(dgLow), vmovn_s32(dgHigh));
+
+        // Saturate to bytes, then interleave the y1 and y0 pixels of each pair
+        uint8x8x2_t b = vzip_u8(vqmovun_s16(vaddq_s16(y1, db)), vqmovun_s16(vaddq_s16(y0, db)));
+        uint8x8x2_t g = vzip_u8(vqmovun_s16(vsubq_s16(y1, dg)), vqmovun_s16(vsubq_s16(y0, dg)));
+        uint8x8x2_t r = vzip_u8(vqmovun_s16(vaddq_s16(y1, dr)), vqmovun_s16(vaddq_s16(y0, dr)));
+        uint8x8x4_t bgra;
+        bgra.val[3] = vdup_n_u8(255);
+        for (int half = 0; half < 2; half++) {
+            bgra.val[0] = b.val[half];
+            bgra.val[1] = g.val[half];
+            bgra.val[2] = r.val[half];
+            vst4_u8(dest + i * 8 + half * 32, bgra);
+        }
+    }
+    convertRowScalar(src, dest, i, pairCount);
+}
+
+#endif
+
+YpCbCrConversionPath bestYpCbCrConversionPath()
+{
+#if defined(__ARM_NEON)
+    return YpCbCrConversionPathNEON;
+#elif defined(__SSE2__)
+    static const YpCbCrConversionPath path = __builtin_cpu_supports("avx2") ? YpCbCrConversionPathAVX2 : YpCbCrConversionPathSSE2;
+    return path;
+#else
+    return YpCbCrConversionPathScalar;
+#endif
+}
+
+void convertYpCbCr422ToBGRA8(const IplImage *src, IplImage *dest, int firstRow, int rowCount, YpCbCrConversionPath path)
+{
+    assert(src->nChannels == 2 && dest->nChannels == 4 && src->width % 2 == 0);
+    assert(src->width == dest->width && src->height == dest->height && firstRow + rowCount <= src->height);
+
+    int pairCount = src->width / 2;
+    for (int row = firstRow; row < firstRow + rowCount; row++) {
+        const uint8_t *srcRow = (const uint8_t *)src->imageData + row * src->widthStep;
+        uint8_t *destRow = (uint8_t *)dest->imageData + row * dest->widthStep;
+        switch (path) {
+#if defined(__SSE2__)
+            case YpCbCrConversionPathSSE2:
+                convertRowSSE2(srcRow, destRow, pairCount);
+                break;
+            case YpCbCrConversionPathAVX2:
+                convertRowAVX2(srcRow, destRow, pairCount);
+                break;
+#endif
+#if defined(__ARM_NEON)
+            case YpCbCrConversionPathNEON:
+                convertRowNEON(srcRow, destRow, pairCount);
+                break;
+#endif
+            default:
+                assert(path == YpCbCrConversionPathScalar);
+                convertRowScalar(srcRow, destRow, 0, pairCount);
+                break;
+        }
+    }
+}
+
+void extractYpCbCr422Luma8(const IplImage *src, IplImage *dest)
+{
+    for (int row = 0; row < src->height; row++) {
+        const uint8_t *srcRow = (const uint8_t *)src->imageData + row * src->widthStep;
+        uint8_t *destRow = (uint8_t *)dest->imageData + row * dest->widthStep;
+        for (int i = 0; i < src->width; i += 2) {
+            destRow[i] = srcRow[i * 2 + 3];
+            destRow[i + 1] = srcRow[i * 2 + 1];
+        }
+    }
+}
+
+// Reverses the order of the pixel pairs in each row. Since the converter writes the second luma value of a pair
+// first, the luma values are also swapped within each pair so that the converted image is the mirror image.
+void flipYpCbCr422Horizontally(IplImage *image)
+{
+    int pairs = image->width / 2;
+    for (int row = 0; row < image->height; row++) {
+        uint8_t *pixels = (uint8_t *)image->imageData + row * image->widthStep;
+        for (int i = 0, j = pairs - 1; i <= j; i++, j--) {
+            uint8_t *a = pixels + i * 4;
+            uint8_t *b = pixels + j * 4;
+            uint8_t flippedA[4] = { a[0], a[3], a[2], a[1] };
+            uint8_t flippedB[4] = { b[0], b[3], b[2], b[1] };
+            memcpy(a, flippedB, 4);
+            memcpy(b, flippedA, 4);
+        }
+    }
+}
@@ -0,0 +1,39 @@
+//
+//  YpCbCrConversion.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef YpCbCrConversion_hpp
+#define YpCbCrConversion_hpp
+
+#include <opencv2/core/core_c.h>
+
+// Packed 4:2:2 Y'CbCr (UYVY) images are 2 channel, 8-bit IplImages with an even width.
+
+typedef enum {
+    YpCbCrConversionPathScalar,
+    YpCbCrConversionPathSSE2,
+    YpCbCrConversionPathAVX2,
+    YpCbCrConversionPathNEON
+} YpCbCrConversionPath;
+
+// The fastest path supported by this CPU
+YpCbCrConversionPath bestYpCbCrConversionPath();
+
+// Converts the rows [firstRow, firstRow + rowCount) of a UYVY image to a BGRA image of the same size, so that separate
+// row stripes can be converted in parallel. The integer arithmetic (including its clamping) is identical in every path,
+// so all paths produce bit-identical results, and match the scalar reference for reproducibility. Note that the second
+// luma value of each pair is written to the first pixel, as the converter always has.
+void convertYpCbCr422ToBGRA8(const IplImage *src, IplImage *dest, int firstRow, int rowCount,
+                             YpCbCrConversionPath path = bestYpCbCrConversionPath());
+
+// Extracts the 8-bit luma plane in the same pixel order as convertYpCbCr422ToBGRA8()
+void extractYpCbCr422Luma8(const IplImage *src, IplImage *dest);
+
+// Mirrors a UYVY image horizontally in place, such that its BGRA conversion is the mirror of the original's
+void flipYpCbCr422Horizontally(IplImage *image);
+
+#endif
@@ -0,0 +1,344 @@
+//
+//  FrameReader.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#include "FrameReader.hpp"
+#include "YpCbCrConversion.hpp"
+#include <opencv2/imgproc/imgproc_c.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const Y4MSignature = "YUV4MPEG2";
+static const char *const Y4MFrameSignature = "FRAME";
+static const size_t Y4MMaximumHeaderLength = 4096;
+static const char *const SyntheticPlatePathPrefix = "synthetic:";
+
+// Reads up to and including the next newline, returning false at the end of the file or if the line is too long
+static bool readLine(FILE *file, std::string &line)
+{
+    line.clear();
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        if (c == '\n') {
+            return true;
+        }
+        if (line.size() >= Y4MMaximumHeaderLength) {
+            return false;
+        }
+        line.push_back((char)c);
+    }
+    return false;
+}
+
+FrameReader::FrameReader()
+    : _file(NULL), _rawFormat(RawFormatNone), _chroma(Chroma420), _size(cvSize(0, 0)), _frameRate(0.0), _frameNumber(0),
+      _uyvyImage(NULL), _recording(NULL), _recordingEventIndex(0), _syntheticPlate(NULL),
+      _droppedFrameCount(0)
+{
+}
+
+FrameReader::~FrameReader()
+{
+    if (_file) {
+        fclose(_file);
+    }
+    if (_uyvyImage) {
+        cvReleaseImage(&_uyvyImage);
+    }
+    delete _recording;
+    delete _syntheticPlate;
+}
+
+bool FrameReader::open(const std::string &path, RawFormat rawFormat, CvSize rawSize, double rawFrameRate, std::string &error)
+{
+    if (rawFormat == RawFormatNone && path.compare(0, strlen(SyntheticPlatePathPrefix), SyntheticPlatePathPrefix) == 0) {
+        // synthetic:SEED[:WELLS[:WIDTHxHEIGHT]]
+        unsigned long seed = 0;
+        int wellCount = 6, rows, columns;
+        CvSize size = cvSize(1280, 720);
+        int fieldCount = sscanf(path.c_str() + strlen(SyntheticPlatePathPrefix), "%lu:%d:%dx%d", &seed, &wellCount,
+                                &size.width, &size.height);
+        if (fieldCount < 1 || fieldCount == 3 || !getPlateConfigurationForWellCount(wellCount, rows, columns) ||
+            size.width <= 0 || size.height <= 0) {
+            error = "invalid synthetic plate";
+            return false;
+        }
+        _syntheticPlate = new SyntheticPlate((uint32_t)seed, wellCount, size);
+        _size = _syntheticPlate->size();
+        _frameRate = SyntheticPlate::frameRate();
+        return true;
+    }
+    if (rawFormat == RawFormatNone && FrameRecordingReader::fileIsRecording(path)) {
+        return openFrameRecording(path, error);
+    }
+    
+    _file = fopen(path.c_str(), "rb");
+    if (!_file) {
+        error = std::string("unable to open file: ") + strerror(errno);
+        return false;
+    }
+    _rawFormat = rawFormat;
+    
+    size_t frameBytes;
+    if (rawFormat == RawFormatNone) {
+        if (!parseY4MHeader(error)) {
+            return false;
+        }
+        size_t lumaBytes = (size_t)_size.width * _size.height;
+        switch (_chroma) {
+            case Chroma420:
+                frameBytes = lumaBytes + 2 * (size_t)((_size.width + 1) / 2) * ((_size.height + 1) / 2);
+                break;
+            case Chroma422:
+                frameBytes = lumaBytes + 2 * (size_t)((_size.width + 1) / 2) * _size.height;
+                break;
+            case Chroma444:
+                frameBytes = 3 * lumaBytes;
+                break;
+            case ChromaMono:
+                frameBytes = lumaBytes;
+                break;
+            default:
+                error = "unsupported chroma subsampling";
+                return false;
+        }
+    } else {
+        if (rawSize.width <= 0 || rawSize.height <= 0 || rawFrameRate <= 0.0) {
+            error = "raw files require a frame size and frame rate";
+            return false;
+        }
+        _size = rawSize;
+        _frameRate = rawFrameRate;
+        size_t bytesPerPixel = rawFormat == RawFormatBGRA ? 4 : (rawFormat == RawFormatUYVY ? 2 : 1);
+        frameBytes = (size_t)_size.width * _size.height * bytesPerPixel;
+    }
+    
+    if (rawFormat != RawFormatNone ? rawFormat == RawFormatUYVY : _chroma != ChromaMono) {
+        if (_size.width % 2 != 0) {
+            error = "Y'CbCr frames must have an even width";
+            return false;
+        }
+        _uyvyImage = cvCreateImage(_size, IPL_DEPTH_8U, 2);
+    }
+    _frameBuffer.resize(frameBytes);
+    return true;
+}
+
+bool FrameReader::parseY4MHeader(std::string &error)
+{
+    std::string header;
+    if (!readLine(_file, header) || header.compare(0, strlen(Y4MSignature), Y4MSignature) != 0) {
+        error = "not a YUV4MPEG2 file";
+        return false;
+    }
+    
+    _chroma = Chroma420;        // the default
+    int rateNumerator = 0, rateDenominator = 0;
+    size_t start = strlen(Y4MSignature);
+    while (start < header.size()) {
+        size_t end = header.find(' ', start);
+        if (end == std::string::npos) {
+            end = header.size();
+        }
+        std::string token = header.substr(start, end - start);
+        start = end + 1;
+        if (token.empty()) {
+            continue;
+        }
+        
+        std::string value = token.substr(1);
+        switch (token[0]) {
+            case 'W':
+                _size.width = atoi(value.c_str());
+                break;
+            case 'H':
+                _size.height = atoi(value.c_str());
+                break;
+            case 'F':
+                if (sscanf(value.c_str(), "%d:%d", &rateNumerator, &rateDenominator) != 2) {
+                    rateNumerator = rateDenominator = 0;
+                }
+                break;
+            case 'C':
+                if (value == "420" || value == "420jpeg" || value == "420mpeg2" || value == "420paldv") {
+                    _chroma = Chroma420;        // 420jpeg, 420mpeg2 and 420paldv differ only in chroma siting
+                } else if (value == "422") {
+                    _chroma = Chroma422;
+                } else if (value == "444") {
+                    _chroma = Chroma444;
+                } else if (value == "mono") {
+                    _chroma = ChromaMono;
+                } else {
+                    error = "unsupported YUV4MPEG2 colorspace " + value + " (only 8-bit 420, 422, 444 and mono are supported)";
+                    return false;
+                }
+                break;
+            default:
+                break;          // e.g. interlacing, pixel aspect ratio and comments, which are ignored
+        }
+    }
+    
+    if (_size.width <= 0 || _size.height <= 0) {
+        error = "YUV4MPEG2 header is missing the frame size";
+        return false;
+    }
+    if (rateNumerator <= 0 || rateDenominator <= 0) {
+        error = "YUV4MPEG2 header is missing the frame rate";
+        return false;
+    }
+    _frameRate = (double)rateNumerator / rateDenominator;
+    return true;
+}
+
+bool FrameReader::openFrameRecording(const std::string &path, std::string &error)
+{
+    _recording = new FrameRecordingReader();
+    if (!_recording->open(path, error)) {
+        return false;
+    }
+    for (const FrameRecordingReader::Event &event : _recording->events()) {
+        if (event.type == FrameRecordingEventFrame) {
+            _size = event.size;
+            break;
+        }
+    }
+    if (_size.width <= 0) {
+        error = "frame recording contains no frames";
+        return false;
+    }
+    _frameRate = _recording->frameRate();
+    return true;
+}
+
+IplImage *FrameReader::readRecordedFrame(double &presentationTime, std::string &error)
+{
+    const std::vector<FrameRecordingReader::Event> &events = _recording->events();
+    while (_recordingEventIndex < events.size() && events[_recordingEventIndex].type == FrameRecordingEventDrop) {
+        _droppedFrameCount++;
+        _recordingEventIndex++;
+    }
+    if (_recordingEventIndex >= events.size()) {
+        return NULL;
+    }
+    
+    const FrameRecordingReader::Event &event = events[_recordingEventIndex++];
+    if (event.size.width != _size.width || event.size.height != _size.height) {
+        error = "frame size changed within frame recording";
+        return NULL;
+    }
+    IplImage recordedImage;
+    FrameRecordingReader::initImageHeader(event, &recordedImage);
+    IplImage *bgraImage = cvCreateImage(_size, IPL_DEPTH_8U, 4);
+    if (event.channels == 2) {
+        convertYpCbCr422ToBGRA8(&recordedImage, bgraImage, 0, _size.height);
+    } else {
+        cvCopy(&recordedImage, bgraImage);
+    }
+    presentationTime = event.presentationTime;
+    return bgraImage;
+}
+
+IplImage *FrameReader::readFrame(double &presentationTime, std::string &error)
+{
+    if (_recording) {
+        return readRecordedFrame(presentationTime, error);
+    }
+    if (_syntheticPlate) {
+        return _syntheticPlate->readFrame(presentationTime);
+    }
+    
+    if (_rawFormat == RawFormatNone) {
+        std::string frameHeader;
+        if (!readLine(_file, frameHeader)) {
+            if (!frameHeader.empty()) {
+                error = "truncated frame header";
+            }
+            return NULL;
+        }
+        if (frameHeader.compare(0, strlen(Y4MFrameSignature), Y4MFrameSignature) != 0) {
+            error = "invalid frame header";
+            return NULL;
+        }
+    }
+    
+    size_t bytesRead = fread(&_frameBuffer[0], 1, _frameBuffer.size(), _file);
+    if (bytesRead < _frameBuffer.size()) {
+        if (bytesRead > 0 || _rawFormat == RawFormatNone) {
+            error = "truncated frame";
+        }
+        return NULL;
+    }
+    
+    IplImage *bgraImage = cvCreateImage(_size, IPL_DEPTH_8U, 4);
+    if (_rawFormat == RawFormatNone) {
+        convertY4MFrame(bgraImage);
+    } else if (_rawFormat == RawFormatBGRA) {
+        size_t rowBytes = (size_t)_size.width * 4;
+        for (int i = 0; i < _size.height; i++) {
+            memcpy(bgraImage->imageData + i * bgraImage->widthStep, &_frameBuffer[i * rowBytes], rowBytes);
+        }
+    } else if (_rawFormat == RawFormatUYVY) {
+        size_t rowBytes = (size_t)_size.width * 2;
+        for (int i = 0; i < _size.height; i++) {
+            memcpy(_uyvyImage->imageData + i * _uyvyImage->widthStep, &_frameBuffer[i * rowBytes], rowBytes);
+        }
+        convertYpCbCr422ToBGRA8(_uyvyImage, bgraImage, 0, _size.height);
+    } else {
+        IplImage grayImage;
+        cvInitImageHeader(&grayImage, _size, IPL_DEPTH_8U, 1);
+        cvSetData(&grayImage, &_frameBuffer[0], _size.width);
+        cvCvtColor(&grayImage, bgraImage, CV_GRAY2BGRA);
+    }
+    
+    presentationTime = _frameNumber++ / _frameRate;
+    return bgraImage;
+}
+
+// Converts the planar frame in the frame buffer to BGRA by way of packed 4:2:2 (UYVY)
+void FrameReader::convertY4MFrame(IplImage *bgraImage)
+{
+    const uint8_t *luma = &_frameBuffer[0];
+    int width = _size.width;
+    int height = _size.height;
+    
+    if (_chroma == ChromaMono) {
+        IplImage grayImage;
+        cvInitImageHeader(&grayImage, _size, IPL_DEPTH_8U, 1);
+        cvSetData(&grayImage, (void *)luma, width);
+        cvCvtColor(&grayImage, bgraImage, CV_GRAY2BGRA);
+        return;
+    }
+    
+    int chromaWidth = _chroma == Chroma444 ? width : (width + 1) / 2;
+    int chromaHeight = _chroma == Chroma420 ? (height + 1) / 2 : height;
+    const uint8_t *cb = luma + (size_t)width * height;
+    const uint8_t *cr = cb + (size_t)chromaWidth * chromaHeight;
+    
+    for (int y = 0; y < height; y++) {
+        int chromaRow = _chroma == Chroma420 ? y / 2 : y;
+        const uint8_t *lumaRow = luma + (size_t)y * width;
+        const uint8_t *cbRow = cb + (size_t)chromaRow * chromaWidth;
+        const uint8_t *crRow = cr + (size_t)chromaRow * chromaWidth;
+        uint8_t *dest = (uint8_t *)_uyvyImage->imageData + y * _uyvyImage->widthStep;
+        for (int pair = 0; pair < width / 2; pair++) {
+            if (_chroma == Chroma444) {
+                // Average the chroma of the pair (rounding half up)
+                dest[0] = (uint8_t)((cbRow[2 * pair] + cbRow[2 * pair + 1] + 1) / 2);
+                dest[2] = (uint8_t)((crRow[2 * pair] + crRow[2 * pair + 1] + 1) / 2);
+            } else {
+                dest[0] = cbRow[pair];
+                dest[2] = crRow[pair];
+            }
+            dest[1] = lumaRow[2 * pair];
+            dest[3] = lumaRow[2 * pair + 1];
+            dest += 4;
+        }
+    }
+    
+    convertYpCbCr422ToBGRA8(_uyvyImage, bgraImage, 0, height);
+}
@@ -0,0 +1,82 @@
+//
+//  FrameReader.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef FrameReader_hpp
+#define FrameReader_hpp
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <opencv2/core/core_c.h>
+#include "FrameRecording.hpp"
+#include "SyntheticPlate.hpp"
+
+// Reads the frames of an uncompressed video file as BGRA images, as VideoFrame would provide them to the analyzers.
+// YUV4MPEG2 (.y4m) files with 4:2:0, 4:2:2, 4:4:4 or mono chroma are supported, as are headerless raw files of
+// fixed size BGRA, UYVY or 8-bit grayscale frames (whose geometry and rate must be specified). Frame recordings
+// (.waframes) saved by the app are replayed exactly as the app analyzed them, with their recorded presentation times.
+// The path "synthetic:SEED" reads a SyntheticPlate generated from the seed instead of a file, and
+// "synthetic:SEED:WELLS" and "synthetic:SEED:WELLS:WIDTHxHEIGHT" one with another well count and frame size.
+// Y'CbCr is converted with the same converter as live capture. Not thread-safe.
+class FrameReader {
+public:
+    enum RawFormat {
+        RawFormatNone,          // i.e. the file is YUV4MPEG2
+        RawFormatBGRA,
+        RawFormatUYVY,
+        RawFormatGray
+    };
+
+    FrameReader();
+    ~FrameReader();
+
+    // Opens a YUV4MPEG2 file, frame recording or synthetic plate if rawFormat is RawFormatNone, else a raw file with
+    // the given frame size and rate. Returns false and sets error on failure.
+    bool open(const std::string &path, RawFormat rawFormat, CvSize rawSize, double rawFrameRate, std::string &error);
+
+    CvSize size() const { return _size; }
+    double frameRate() const { return _frameRate; }
+    bool isFrameRecording() const { return _recording != NULL; }
+    uint64_t droppedFrameCount() const { return _droppedFrameCount; }      // recorded drops read so far
+
+    // Returns a new BGRA image (owned by the caller) and its presentation time, or NULL at the end of the file
+    // (or if the file is truncated, in which case error is set).
+    IplImage *readFrame(double &presentationTime, std::string &error);
+
+private:
+    enum Chroma {
+        Chroma420,
+        Chroma422,
+        Chroma444,
+        ChromaMono
+    };
+
+    FrameReader(const FrameReader &);
+    FrameReader &operator=(const FrameReader &);
+
+    bool parseY4MHeader(std::string &error);
+    void convertY4MFrame(IplImage *bgraImage);
+    bool openFrameRecording(const std::string &path, std::string &error);
+    IplImage *readRecordedFrame(double &presentationTime, std::string &error);
+
+    FILE *_file;
+    RawFormat _rawFormat;
+    Chroma _chroma;
+    CvSize _size;
+    double _frameRate;
+    uint64_t _frameNumber;
+    std::vector<uint8_t> _frameBuffer;      // the planes (or packed pixels) of the frame being read
+    IplImage *_uyvyImage;                   // the Y'CbCr of the frame being converted
+    FrameRecordingReader *_recording;       // NULL unless reading a frame recording
+    size_t _recordingEventIndex;
+    SyntheticPlate *_syntheticPlate;        // NULL unless reading a synthetic plate
+    uint64_t _droppedFrameCount;
+};
+
+#endif
@@ -0,0 +1,189 @@
+//
+//  GoldenResults.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#include "GoldenResults.hpp"
+#include "PlateResults.hpp"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+
+static const char *const GoldenResultsSignature = "# WormAssay golden results 1";
+static const char *const PresentationTimeColumnID = "Presentation Time";
+
+void GoldenResults::addPlate(const std::string &fileName, int plateNumber, const PlateResults &results)
+{
+    Series timeAxis;
+    timeAxis.fileName = fileName;
+    timeAxis.plateNumber = plateNumber;
+    timeAxis.columnID = PresentationTimeColumnID;
+    timeAxis.well = -1;
+    timeAxis.values = results.framePresentationTimes();
+    _series.push_back(timeAxis);
+
+    std::vector<std::string> columnIDs = results.sortedColumnIDsWithData();
+    int wellCount = results.wellCount();
+    for (size_t i = 0; i < columnIDs.size(); i++) {
+        for (int j = 0; j < std::max(wellCount, 1); j++) {
+            Series series;
+            series.fileName = fileName;
+            series.plateNumber = plateNumber;
+            series.columnID = columnIDs[i];
+            series.well = wellCount > 0 ? j : -1;
+            series.values = results.values(columnIDs[i], series.well);
+            _series.push_back(series);
+        }
+    }
+}
+
+bool GoldenResults::write(const std::string &path, std::string &error) const
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (!file) {
+        error = std::string("unable to create file: ") + strerror(errno);
+        return false;
+    }
+    fprintf(file, "%s\n", GoldenResultsSignature);
+    for (size_t i = 0; i < _series.size(); i++) {
+        const Series &series = _series[i];
+        fprintf(file, "%s\t%d\t%s\t%d", series.fileName.c_str(), series.plateNumber, series.columnID.c_str(), series.well);
+        for (size_t j = 0; j < series.values.size(); j++) {
+            fprintf(file, "\t%.17g", series.values[j]);
+        }
+        fputc('\n', file);
+    }
+    if (fclose(file) != 0) {
+        error = std::string("unable to write file: ") + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool GoldenResults::read(const std::string &path, std::string &error)
+{
+    FILE *file = fopen(path.c_str(), "r");
+    if (!file) {
+        error = std::string("unable to open file: ") + strerror(errno);
+        return false;
+    }
+
+    _series.clear();
+    std::string line;
+    bool signatureFound = false;
+    int c;
+    do {
+        c = fgetc(file);
+        if (c != '\n' && c != EOF) {
+            line.push_back((char)c);
+            continue;
+        }
+        if (!signatureFound) {
+            signatureFound = line == GoldenResultsSignature;
+            if (!signatureFound) {
+                break;
+            }
+        } else if (!line.empty()) {
+            // Split the fields at tabs
+            std::vector<std::string> fields;
+            size_t start = 0, end;
+            while ((end = line.find('\t', start)) != std::string::npos) {
+                fields.push_back(line.substr(start, end - start));
+                start = end + 1;
+            }
+            fields.push_back(line.substr(start));
+            if (fields.size() < 4) {
+                error = "invalid series in golden results: " + line.substr(0, 80);
+                fclose(file);
+                return false;
+            }
+
+            Series series;
+            series.fileName = fields[0];
+            series.plateNumber = atoi(fields[1].c_str());
+            series.columnID = fields[2];
+            series.well = atoi(fields[3].c_str());
+            for (size_t i = 4; i < fields.size(); i++) {
+                series.values.push_back(strtod(fields[i].c_str(), NULL));
+            }
+            _series.push_back(series);
+        }
+        line.clear();
+    } while (c != EOF);
+    fclose(file);
+
+    if (!signatureFound) {
+        error = "not a golden results file";
+        return false;
+    }
+    return true;
+}
+
+std::string GoldenResults::Series::key() const
+{
+    return fileName + " plate " + std::to_string(plateNumber) + " '" + columnID + "' well " + std::to_string(well);
+}
+
+size_t GoldenResults::compare(const GoldenResults &expected,
+                              double absoluteTolerance,
+                              double relativeTolerance,
+                              size_t maximumReportedMismatches,
+                              std::string &report) const
+{
+    size_t mismatchCount = 0;
+    char buffer[512];
+    auto reportMismatch = [&](const std::string &description) {
+        if (mismatchCount++ < maximumReportedMismatches) {
+            report += description + "\n";
+        }
+    };
+
+    std::map<std::string, const Series *> actualSeriesByKey;
+    for (size_t i = 0; i < _series.size(); i++) {
+        actualSeriesByKey[_series[i].key()] = &_series[i];
+    }
+
+    for (size_t i = 0; i < expected._series.size(); i++) {
+        const Series &expectedSeries = expected._series[i];
+        std::string key = expectedSeries.key();
+        std::map<std::string, const Series *>::iterator it = actualSeriesByKey.find(key);
+        if (it == actualSeriesByKey.end()) {
+            reportMismatch(key + ": missing");
+            continue;
+        }
+        const Series &actualSeries = *it->second;
+        actualSeriesByKey.erase(it);
+
+        if (actualSeries.values.size() != expectedSeries.values.size()) {
+            snprintf(buffer, sizeof(buffer), ": %zu values, expected %zu", actualSeries.values.size(), expectedSeries.values.size());
+            reportMismatch(key + buffer);
+            continue;
+        }
+        for (size_t j = 0; j < expectedSeries.values.size(); j++) {
+            double actual = actualSeries.values[j];
+            double golden = expectedSeries.values[j];
+            bool matches = isnan(golden) ? isnan(actual) :
+                           fabs(actual - golden) <= absoluteTolerance + relativeTolerance * fabs(golden);
+            if (!matches) {
+                snprintf(buffer, sizeof(buffer), " [%zu]: %.17g, expected %.17g", j, actual, golden);
+                reportMismatch(key + buffer);
+            }
+        }
+    }
+
+    for (std::map<std::string, const Series *>::iterator it = actualSeriesByKey.begin(); it != actualSeriesByKey.end(); it++) {
+        reportMismatch(it->first + ": not in the golden results");
+    }
+    if (mismatchCount > maximumReportedMismatches) {
+        snprintf(buffer, sizeof(buffer), "(and %zu more)\n", mismatchCount - maximumReportedMismatches);
+        report += buffer;
+    }
+    return mismatchCount;
+}
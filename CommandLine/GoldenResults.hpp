@@ -0,0 +1,57 @@
+//
+//  GoldenResults.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef GoldenResults_hpp
+#define GoldenResults_hpp
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+class PlateResults;
+
+// The per-frame results of a run (every column, e.g. movement units and occupancy, of every well of every plate, and the
+// plates' time axes), saved as a golden file so that later runs over the same frames can be checked against it, e.g.
+// when optimizing the analyzers. Values are written with enough digits to be read back exactly. The file is text, with
+// a line per series: the file's name, the plate number, the column, the well and then the values, separated by tabs.
+class GoldenResults {
+public:
+    // Adds a plate's results. Plates are numbered from 1 within each file.
+    void addPlate(const std::string &fileName, int plateNumber, const PlateResults &results);
+
+    // Return false and set error on failure
+    bool write(const std::string &path, std::string &error) const;
+    bool read(const std::string &path, std::string &error);
+
+    // Compares these results to the expected (golden) results. Values match if they differ by no more than
+    // absoluteTolerance + relativeTolerance * |expected|, so zero tolerances require exact equality. NANs (skipped
+    // frames) only match NANs. Describes up to maximumReportedMismatches mismatches in report and returns the count of
+    // mismatched values, counting each missing, extra or differently sized series as one.
+    size_t compare(const GoldenResults &expected,
+                   double absoluteTolerance,
+                   double relativeTolerance,
+                   size_t maximumReportedMismatches,
+                   std::string &report) const;
+
+    size_t seriesCount() const { return _series.size(); }
+
+private:
+    struct Series {
+        std::string fileName;
+        int plateNumber;
+        std::string columnID;
+        int well;               // -1 for the time axis and non-well plates
+        std::vector<double> values;
+
+        std::string key() const;
+    };
+
+    std::vector<Series> _series;
+};
+
+#endif
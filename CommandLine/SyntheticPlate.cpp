@@ -0,0 +1,123 @@
+//
+//  SyntheticPlate.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#include "SyntheticPlate.hpp"
+#include <opencv2/imgproc/imgproc_c.h>
+#include <assert.h>
+#include <math.h>
+#include <algorithm>
+
+// The default plate's layout, which others are scaled from
+static const int DefaultWellSpacing = 320;
+static const double DefaultWellRadius = 150.0;
+static const double DefaultWormRangeRadius = 100.0;     // worms stay well clear of the well walls
+static const int PlateMargin = 40;                      // above and below the wells
+static const int BackgroundLuma = 20;
+static const int WellLuma = 150;
+static const int WormLuma = 40;
+
+SyntheticPlate::SyntheticPlate(uint32_t seed, int wellCount, CvSize size)
+    : _generator(seed), _size(size), _frameNumber(0)
+{
+    int rows = 0, columns = 0;
+    bool valid = getPlateConfigurationForWellCount(wellCount, rows, columns);
+    assert(valid);
+    (void)valid;
+
+    int spacing = std::min(size.width / (columns + 1), (size.height - 2 * PlateMargin) / rows);
+    _scale = (double)spacing / DefaultWellSpacing;
+    _wellRadius = DefaultWellRadius * _scale;
+    CvPoint origin = cvPoint((size.width - (columns - 1) * spacing) / 2, (size.height - (rows - 1) * spacing) / 2);
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+            _wellCenters.push_back(cvPoint(origin.x + column * spacing, origin.y + row * spacing));
+        }
+    }
+
+    // Draw the wells as bright discs with antialiased edges, which the well finder expects of real plates. Only the
+    // pixels near each well are visited, since a well's edge covers none beyond 2 pixels out.
+    _plateImage = cvCreateImage(size, IPL_DEPTH_8U, 1);
+    cvSet(_plateImage, cvRealScalar(BackgroundLuma));
+    int reach = (int)ceil(_wellRadius) + 3;
+    for (size_t i = 0; i < _wellCenters.size(); i++) {
+        CvPoint center = _wellCenters[i];
+        for (int y = std::max(center.y - reach, 0); y < std::min(center.y + reach, size.height); y++) {
+            uint8_t *row = (uint8_t *)_plateImage->imageData + y * _plateImage->widthStep;
+            for (int x = std::max(center.x - reach, 0); x < std::min(center.x + reach, size.width); x++) {
+                double distance = hypot(x - center.x, y - center.y);
+                double coverage = std::min(std::max((_wellRadius - distance) / 4.0 + 0.5, 0.0), 1.0);
+                row[x] = (uint8_t)std::max((int)row[x], (int)(BackgroundLuma + (WellLuma - BackgroundLuma) * coverage));
+            }
+        }
+    }
+
+    // Every well but the last has a worm
+    for (size_t i = 0; i + 1 < _wellCenters.size(); i++) {
+        Worm worm;
+        double angle = 2.0 * M_PI * uniform();
+        double distance = DefaultWormRangeRadius * _scale * uniform();
+        worm.x = distance * cos(angle);
+        worm.y = distance * sin(angle);
+        worm.heading = 2.0 * M_PI * uniform();
+        worm.speed = (2.0 + 10.0 * uniform()) * _scale;
+        _worms.push_back(worm);
+    }
+}
+
+SyntheticPlate::~SyntheticPlate()
+{
+    cvReleaseImage(&_plateImage);
+}
+
+std::vector<Circle> SyntheticPlate::wellCircles() const
+{
+    std::vector<Circle> circles;
+    for (size_t i = 0; i < _wellCenters.size(); i++) {
+        Circle circle = { { (float)_wellCenters[i].x, (float)_wellCenters[i].y }, (float)_wellRadius };
+        circles.push_back(circle);
+    }
+    return circles;
+}
+
+// Uses the engine's output directly, since the standard distributions' algorithms are implementation defined
+double SyntheticPlate::uniform()
+{
+    return _generator() / 4294967296.0;
+}
+
+IplImage *SyntheticPlate::readFrame(double &presentationTime)
+{
+    if (_frameNumber >= FrameCount) {
+        return NULL;
+    }
+
+    IplImage *lumaImage = cvCloneImage(_plateImage);
+    for (size_t i = 0; i < _worms.size(); i++) {
+        Worm &worm = _worms[i];
+        CvPoint center = cvPoint(_wellCenters[i].x + (int)lround(worm.x), _wellCenters[i].y + (int)lround(worm.y));
+        CvSize axes = cvSize((int)lround(12.0 * _scale), std::max((int)lround(4.0 * _scale), 1));
+        cvEllipse(lumaImage, center, axes, worm.heading * 180.0 / M_PI, 0, 360, cvRealScalar(WormLuma), CV_FILLED);
+
+        // Wander, turning back toward the center at the edge of the range
+        worm.heading += (uniform() - 0.5) * 1.0;
+        double x = worm.x + worm.speed * cos(worm.heading);
+        double y = worm.y + worm.speed * sin(worm.heading);
+        if (hypot(x, y) > DefaultWormRangeRadius * _scale) {
+            worm.heading = atan2(-worm.y, -worm.x);
+        } else {
+            worm.x = x;
+            worm.y = y;
+        }
+    }
+
+    IplImage *bgraImage = cvCreateImage(_size, IPL_DEPTH_8U, 4);
+    cvCvtColor(lumaImage, bgraImage, CV_GRAY2BGRA);
+    cvReleaseImage(&lumaImage);
+    presentationTime = _frameNumber++ / frameRate();
+    return bgraImage;
+}
@@ -0,0 +1,61 @@
+//
+//  SyntheticPlate.hpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+#ifndef SyntheticPlate_hpp
+#define SyntheticPlate_hpp
+
+#include <stdint.h>
+#include <random>
+#include <vector>
+#include <opencv2/core/core_c.h>
+#include "WellFinding.hpp"
+
+// Generates a reproducible video of a plate for regression testing and benchmarking, so that the analyzers can be
+// checked without any stored video. Each well but the last holds a worm that wanders at its own speed, and the last is
+// empty. The frames depend only on the seed, well count and size, since the random number engine (unlike the standard
+// distributions) is fully specified. Not thread-safe.
+class SyntheticPlate {
+public:
+    // wellCount is that of a standard plate (1, 6, 12, 24, 48 or 96), laid out in its rows and columns and scaled to fill
+    // the frame. The default is the plate used for golden results.
+    explicit SyntheticPlate(uint32_t seed, int wellCount = 6, CvSize size = cvSize(1280, 720));
+    ~SyntheticPlate();
+
+    static const int FrameCount = 120;
+    static double frameRate() { return 8.0; }
+
+    CvSize size() const { return _size; }
+    // In row major order, as the well finder returns them
+    std::vector<Circle> wellCircles() const;
+
+    // Returns a new BGRA image (owned by the caller) and its presentation time, or NULL after the last frame
+    IplImage *readFrame(double &presentationTime);
+
+private:
+    struct Worm {
+        double x, y;            // relative to the well center
+        double heading;
+        double speed;           // pixels per frame
+    };
+
+    SyntheticPlate(const SyntheticPlate &);
+    SyntheticPlate &operator=(const SyntheticPlate &);
+
+    double uniform();           // in [0, 1)
+
+    std::mt19937 _generator;
+    CvSize _size;
+    double _scale;              // of the wells and worms relative to those of the default plate
+    double _wellRadius;
+    IplImage *_plateImage;      // 8-bit luma of the empty plate
+    std::vector<CvPoint> _wellCenters;
+    std::vector<Worm> _worms;
+    int _frameNumber;
+};
+
+#endif
@@ -0,0 +1,658 @@
+//
+//  benchmark.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+// wormassay-benchmark: measures the cost of analyzing a tracked frame with each analyzer, for each plate format and
+// frame size, on 1 to N cores, to size station hardware (e.g. whether 4K cameras can be analyzed at their frame rate).
+// Synthetic plates (see SyntheticPlate.hpp) are analyzed at their known well positions, so well finding isn't measured.
+// Each configuration is written as a CSV row to stdout, and progress to stderr. With --series, the compression of stored
+// raw values (see SampleSeries.hpp) is measured instead, and with --quantiles, the memory, time and error of the median
+// and percentile sketch (see QuantileSketch.hpp) compared to computing them exactly from the retained values.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <getopt.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SyntheticPlate.hpp"
+#include "PlateResults.hpp"
+#include "PlateAnalyzer.hpp"
+#include "ConsensusLuminancePlateAnalyzer.hpp"
+#include "OpticalFlowPlateAnalyzer.hpp"
+#include "DebugOverlay.hpp"
+#include "QuantileSketch.hpp"
+#include "SampleSeries.hpp"
+
+// Enough frames for the analyzers to begin processing wells: the consensus analyzer's voting frames, and the optical
+// flow analyzer's previous frame at least 100 ms earlier
+static const int WarmupFrameCount = 10;
+
+// Counts the C++ heap allocations made while frames are analyzed. OpenCV's own allocations (e.g. of images and their
+// headers, and of the buffers used within its functions) are counted by cvGetAllocationStatistics(). Once warmed up, the
+// analyzers' own code allocates nothing per well (its temporaries are in the ScratchArena). Those counted per well are
+// made by OpenCV's C++ filters, which build a FilterEngine with its kernels and row buffers on every call: 18 for
+// cvCanny()'s Sobel derivatives and edge stack, and 8 for the luminance analyzer's cvDilate(). The rest are per frame:
+// the same filter construction for each voting band's cvSmooth(), the header and bookkeeping of each image taken from the
+// FrameBufferPool, and e.g. the growth of the results' series.
+static std::atomic<uint64_t> allocationCount(0);
+
+void *operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void *pointer = malloc(size > 0 ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+enum AnalyzerType {
+    AnalyzerTypeConsensusLuminance,
+    AnalyzerTypeOpticalFlow,
+    AnalyzerTypeNull
+};
+
+static const char *const AnalyzerArguments[] = { "luminance", "opticalflow", "null" };
+
+// As the app's NullMotionAnalyzer, except that the wells are visited, so that the cost of scheduling them is measured
+class NullPlateAnalyzer : public PlateAnalyzer {
+public:
+    virtual bool canProcessInParallel() const { return true; }
+    virtual void willBeginPlateTracking(PlateResults &) {}
+    virtual bool willBeginFrameProcessing(const AnalysisFrameRef &, unsigned, DebugOverlay &, PlateResults &) { return true; }
+    virtual void processWell(IplImage *, int, DebugOverlay &, double, PlateResults &) {}
+    virtual void didEndFrameProcessing(const AnalysisFrameRef &, PlateResults &) {}
+    virtual double minimumTimeIntervalProcessedToReportData() const { return FLT_MAX; }
+    virtual size_t minimumSamplesProcessedToReportData() const { return SIZE_MAX; }
+};
+
+// Passes each call to another analyzer, timing each well of the current frame
+class WellTimingPlateAnalyzer : public PlateAnalyzer {
+public:
+    WellTimingPlateAnalyzer(PlateAnalyzer *analyzer, size_t wellCount) : wellSeconds(wellCount, NAN), _analyzer(analyzer) {}
+
+    std::vector<double> wellSeconds;        // NAN for wells not processed in the current frame
+
+    virtual bool canProcessInParallel() const { return _analyzer->canProcessInParallel(); }
+    virtual void willBeginPlateTracking(PlateResults &results) { _analyzer->willBeginPlateTracking(results); }
+
+    virtual bool willBeginFrameProcessing(const AnalysisFrameRef &frame, unsigned maximumConcurrency, DebugOverlay &debugOverlay, PlateResults &results)
+    {
+        std::fill(wellSeconds.begin(), wellSeconds.end(), NAN);
+        return _analyzer->willBeginFrameProcessing(frame, maximumConcurrency, debugOverlay, results);
+    }
+
+    virtual void processWell(IplImage *wellImage, int well, DebugOverlay &debugOverlay, double presentationTime, PlateResults &results)
+    {
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+        _analyzer->processWell(wellImage, well, debugOverlay, presentationTime, results);
+        wellSeconds[std::max(well, 0)] = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    virtual void didEndFrameProcessing(const AnalysisFrameRef &frame, PlateResults &results) { _analyzer->didEndFrameProcessing(frame, results); }
+    virtual void didEndTrackingPlate(PlateResults &results) { _analyzer->didEndTrackingPlate(results); }
+    virtual double minimumTimeIntervalProcessedToReportData() const { return _analyzer->minimumTimeIntervalProcessedToReportData(); }
+    virtual size_t minimumSamplesProcessedToReportData() const { return _analyzer->minimumSamplesProcessedToReportData(); }
+
+private:
+    std::unique_ptr<PlateAnalyzer> _analyzer;
+};
+
+enum BenchmarkMode {
+    BenchmarkModeAnalyzers,
+    BenchmarkModeSeries,
+    BenchmarkModeQuantiles
+};
+
+struct Options {
+    Options() : mode(BenchmarkModeAnalyzers), frameCount(20), seed(1) {}
+
+    BenchmarkMode mode;
+
+    std::vector<AnalyzerType> analyzerTypes;
+    std::vector<int> wellCounts;
+    std::vector<CvSize> sizes;
+    std::vector<unsigned> threadCounts;
+    int frameCount;
+    uint32_t seed;
+};
+
+struct Measurement {
+    double secondsPerFrame;
+    uint64_t wellCount;                 // of wells processed over every frame
+    double wellSecondsMean;
+    double wellSecondsMaximum;
+    QuantileSketch wellSeconds;
+    double allocationsPerFrame;
+    double openCVAllocationsPerFrame;
+};
+
+static PlateAnalyzer *createAnalyzer(AnalyzerType analyzerType, uint32_t seed)
+{
+    PlateAnalyzer *analyzer = NULL;
+    switch (analyzerType) {
+        case AnalyzerTypeConsensusLuminance:
+            analyzer = new ConsensusLuminancePlateAnalyzer(0.0);        // the synthetic plates never move
+            break;
+        case AnalyzerTypeOpticalFlow:
+            analyzer = new OpticalFlowPlateAnalyzer(0.0);
+            break;
+        case AnalyzerTypeNull:
+            analyzer = new NullPlateAnalyzer();
+            break;
+    }
+    analyzer->setRandomSeed(seed);
+    return analyzer;
+}
+
+static Measurement measure(const Options &options, AnalyzerType analyzerType, int wellCount, CvSize size, unsigned threadCount)
+{
+    SyntheticPlate plate(options.seed, wellCount, size);
+    std::vector<Circle> wellCircles = plate.wellCircles();
+    WellTimingPlateAnalyzer analyzer(createAnalyzer(analyzerType, options.seed), wellCircles.size());
+    PlateResults results((int)wellCircles.size(), 0.0);
+    DebugOverlay debugOverlay;          // disabled, as when nothing is displayed
+    analyzer.willBeginPlateTracking(results);
+
+    Measurement measurement;
+    measurement.secondsPerFrame = 0.0;
+    measurement.wellCount = 0;
+    measurement.wellSecondsMean = 0.0;
+    measurement.wellSecondsMaximum = 0.0;
+    uint64_t allocations = 0;
+    uint64_t openCVAllocations = 0;
+    for (int i = 0; i < WarmupFrameCount + options.frameCount; i++) {
+        double presentationTime;
+        IplImage *image = plate.readFrame(presentationTime);
+        AnalysisFrameRef frame(new AnalysisFrame(image, presentationTime), [](const AnalysisFrame *frame) {
+            IplImage *image = frame->image;
+            cvReleaseImage(&image);
+            delete frame;
+        });
+
+        uint64_t startAllocationCount = allocationCount.load();
+        uint64 startOpenCVAllocationCount, endOpenCVAllocationCount;
+        cvGetAllocationStatistics(&startOpenCVAllocationCount, NULL);
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+        analyzePlateFrame(analyzer, frame, wellCircles, threadCount, debugOverlay, results);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        cvGetAllocationStatistics(&endOpenCVAllocationCount, NULL);
+        if (i < WarmupFrameCount) {
+            continue;
+        }
+        allocations += allocationCount.load() - startAllocationCount;
+        openCVAllocations += endOpenCVAllocationCount - startOpenCVAllocationCount;
+        measurement.secondsPerFrame += seconds;
+        for (size_t j = 0; j < analyzer.wellSeconds.size(); j++) {
+            double wellSeconds = analyzer.wellSeconds[j];
+            if (!isnan(wellSeconds)) {
+                measurement.wellSeconds.add(wellSeconds);
+                measurement.wellSecondsMean += wellSeconds;
+                measurement.wellSecondsMaximum = std::max(measurement.wellSecondsMaximum, wellSeconds);
+                measurement.wellCount++;
+            }
+        }
+    }
+    analyzer.didEndTrackingPlate(results);
+
+    measurement.secondsPerFrame /= options.frameCount;
+    measurement.wellSecondsMean = measurement.wellCount > 0 ? measurement.wellSecondsMean / measurement.wellCount : NAN;
+    measurement.allocationsPerFrame = (double)allocations / options.frameCount;
+    measurement.openCVAllocationsPerFrame = (double)openCVAllocations / options.frameCount;
+    return measurement;
+}
+
+// The values series are measured with, cycled through as needed, and the timings are the best of several repetitions
+static const size_t SeriesValueCount = 1 << 20;
+static const int SeriesRepetitionCount = 5;
+static const int SeriesWellCount = 24;
+
+struct NamedValues {
+    const char *name;
+    std::vector<double> values;
+};
+
+// The movement units reported for each well of a synthetic plate in turn, as stored in the results
+static std::vector<double> movementUnitsForAnalyzer(AnalyzerType analyzerType, uint32_t seed)
+{
+    SyntheticPlate plate(seed, SeriesWellCount);
+    std::vector<Circle> wellCircles = plate.wellCircles();
+    std::unique_ptr<PlateAnalyzer> analyzer(createAnalyzer(analyzerType, seed));
+    PlateResults results((int)wellCircles.size(), 0.0);
+    DebugOverlay debugOverlay;
+    analyzer->willBeginPlateTracking(results);
+    for (int i = 0; i < SyntheticPlate::FrameCount; i++) {
+        double presentationTime;
+        IplImage *image = plate.readFrame(presentationTime);
+        AnalysisFrameRef frame(new AnalysisFrame(image, presentationTime), [](const AnalysisFrame *frame) {
+            IplImage *image = frame->image;
+            cvReleaseImage(&image);
+            delete frame;
+        });
+        analyzePlateFrame(*analyzer, frame, wellCircles, std::max(std::thread::hardware_concurrency(), 1U), debugOverlay, results);
+    }
+    analyzer->didEndTrackingPlate(results);
+
+    std::vector<double> movementUnits;
+    for (int well = 0; well < (int)wellCircles.size(); well++) {
+        std::vector<double> wellMovementUnits = results.values("Movement Units", well);
+        movementUnits.insert(movementUnits.end(), wellMovementUnits.begin(), wellMovementUnits.end());
+    }
+    return movementUnits;
+}
+
+static std::vector<NamedValues> seriesToMeasure(uint32_t seed)
+{
+    std::vector<NamedValues> series;
+    fprintf(stderr, "Analyzing a %d well plate for its movement units\n", SeriesWellCount);
+    NamedValues movementUnits = { "opticalflow movement units", movementUnitsForAnalyzer(AnalyzerTypeOpticalFlow, seed) };
+    series.push_back(movementUnits);
+
+    // As when the plate moves now and then, and every well skips a run of frames
+    NamedValues skippedFrames = { "opticalflow movement units with skipped frames", std::vector<double>() };
+    for (size_t i = 0; i < movementUnits.values.size(); i++) {
+        skippedFrames.values.push_back(i % 300 < 30 ? NAN : movementUnits.values[i]);
+    }
+    series.push_back(skippedFrames);
+
+    NamedValues constant = { "constant", std::vector<double>(1, 0.25) };
+    series.push_back(constant);
+
+    // Full precision noise, the worst case
+    std::mt19937_64 generator(seed);
+    std::uniform_real_distribution<double> distribution(0.0, 100.0);
+    NamedValues noise = { "uniform noise", std::vector<double>() };
+    for (size_t i = 0; i < 4096; i++) {
+        noise.values.push_back(distribution(generator));
+    }
+    series.push_back(noise);
+    return series;
+}
+
+template <typename Body>
+static double bestSeconds(const Body &body)
+{
+    double best = INFINITY;
+    for (int i = 0; i < SeriesRepetitionCount; i++) {
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+        body();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+    }
+    return best;
+}
+
+// Returns the sum of the non-NAN values, so that reading them can't be optimized away
+static double sumOfSeries(const SampleSeries &series)
+{
+    double sum = 0.0;
+    for (SampleSeries::const_iterator it = series.begin(); it != series.end(); ++it) {
+        if (!isnan(*it)) {
+            sum += *it;
+        }
+    }
+    return sum;
+}
+
+static void measureSeries(const Options &options)
+{
+    std::vector<NamedValues> series = seriesToMeasure(options.seed);
+    printf("series,values,uncompressed_bytes,compressed_bytes,compression_ratio,encode_mvalues_per_second,"
+           "decode_mvalues_per_second,uncompressed_decode_mvalues_per_second\n");
+    for (size_t s = 0; s < series.size(); s++) {
+        const std::vector<double> &values = series[s].values;
+        if (values.empty()) {
+            continue;
+        }
+        fprintf(stderr, "Measuring %s\n", series[s].name);
+        SampleSeries compressed(true), uncompressed(false);
+        double encodeSeconds = bestSeconds([&]() {
+            compressed = SampleSeries(true);
+            for (size_t i = 0; i < SeriesValueCount; i++) {
+                compressed.push_back(values[i % values.size()]);
+            }
+        });
+        for (size_t i = 0; i < SeriesValueCount; i++) {
+            uncompressed.push_back(values[i % values.size()]);
+        }
+
+        double compressedSum = 0.0, uncompressedSum = 0.0;
+        double decodeSeconds = bestSeconds([&]() { compressedSum = sumOfSeries(compressed); });
+        double uncompressedDecodeSeconds = bestSeconds([&]() { uncompressedSum = sumOfSeries(uncompressed); });
+        if (compressedSum != uncompressedSum) {
+            fprintf(stderr, "The compressed %s series decoded differently\n", series[s].name);
+            exit(1);
+        }
+
+        printf("%s,%zu,%zu,%zu,%.2f,%.1f,%.1f,%.1f\n", series[s].name, (size_t)SeriesValueCount, uncompressed.memoryUsage(),
+               compressed.memoryUsage(), (double)uncompressed.memoryUsage() / compressed.memoryUsage(),
+               SeriesValueCount / encodeSeconds / 1e6, SeriesValueCount / decodeSeconds / 1e6,
+               SeriesValueCount / uncompressedDecodeSeconds / 1e6);
+        fflush(stdout);
+    }
+}
+
+// The value counts the quantiles are measured for, and the quantiles reported (as for ReportingStyleMedian and
+// ReportingStylePercentiles)
+static const size_t QuantileValueCounts[] = { 1000, 10000, 100000, 1000000 };
+static const double MeasuredQuantiles[] = { 0.5, 0.10, 0.25, 0.75, 0.90 };
+
+static void measureQuantiles(const Options &options)
+{
+    std::vector<NamedValues> series = seriesToMeasure(options.seed);
+    printf("series,values,exact_bytes,sketch_bytes,exact_add_ns,sketch_add_ns,exact_query_us,sketch_query_us,"
+           "max_relative_error\n");
+    const size_t quantileCount = sizeof(MeasuredQuantiles) / sizeof(*MeasuredQuantiles);
+    for (size_t s = 0; s < series.size(); s++) {
+        if (series[s].values.empty()) {
+            continue;
+        }
+        // As the sketch, ignore the skipped frames
+        std::vector<double> values;
+        for (size_t i = 0; i < series[s].values.size(); i++) {
+            if (!isnan(series[s].values[i])) {
+                values.push_back(series[s].values[i]);
+            }
+        }
+        for (size_t n = 0; n < sizeof(QuantileValueCounts) / sizeof(*QuantileValueCounts); n++) {
+            size_t valueCount = QuantileValueCounts[n];
+            fprintf(stderr, "Measuring %zu values of %s\n", valueCount, series[s].name);
+
+            // Exactly, the values are retained and sorted when reported
+            std::vector<double> retained;
+            double exactAddSeconds = bestSeconds([&]() {
+                retained = std::vector<double>();
+                for (size_t i = 0; i < valueCount; i++) {
+                    retained.push_back(values[i % values.size()]);
+                }
+            });
+            double exact[quantileCount];
+            double exactQuerySeconds = bestSeconds([&]() {
+                std::vector<double> sorted(retained);
+                std::sort(sorted.begin(), sorted.end());
+                for (size_t q = 0; q < quantileCount; q++) {
+                    exact[q] = sorted[(size_t)(MeasuredQuantiles[q] * (sorted.size() - 1))];
+                }
+            });
+
+            QuantileSketch sketch;
+            double sketchAddSeconds = bestSeconds([&]() {
+                sketch = QuantileSketch();
+                for (size_t i = 0; i < valueCount; i++) {
+                    sketch.add(values[i % values.size()]);
+                }
+            });
+            double estimates[quantileCount];
+            double sketchQuerySeconds = bestSeconds([&]() {
+                for (size_t q = 0; q < quantileCount; q++) {
+                    estimates[q] = sketch.quantile(MeasuredQuantiles[q]);
+                }
+            });
+
+            double maximumRelativeError = 0.0;
+            for (size_t q = 0; q < quantileCount; q++) {
+                double error = fabs(estimates[q] - exact[q]);
+                maximumRelativeError = std::max(maximumRelativeError, exact[q] != 0.0 ? error / fabs(exact[q]) : error);
+            }
+
+            printf("%s,%zu,%zu,%zu,%.2f,%.2f,%.2f,%.2f,%.5f\n", series[s].name, valueCount,
+                   retained.capacity() * sizeof(double), sketch.memoryUsage(), exactAddSeconds / valueCount * 1e9,
+                   sketchAddSeconds / valueCount * 1e9, exactQuerySeconds * 1e6, sketchQuerySeconds * 1e6,
+                   maximumRelativeError);
+            fflush(stdout);
+        }
+    }
+}
+
+static std::vector<std::string> componentsSeparatedByCommas(const std::string &string)
+{
+    std::vector<std::string> components;
+    std::stringstream stream(string);
+    std::string component;
+    while (std::getline(stream, component, ',')) {
+        components.push_back(component);
+    }
+    return components;
+}
+
+static bool parseSize(const std::string &argument, CvSize &size)
+{
+    if (argument == "720p") {
+        size = cvSize(1280, 720);
+    } else if (argument == "1080p") {
+        size = cvSize(1920, 1080);
+    } else if (argument == "4k" || argument == "4K") {
+        size = cvSize(3840, 2160);
+    } else if (sscanf(argument.c_str(), "%dx%d", &size.width, &size.height) != 2 || size.width <= 0 || size.height <= 0) {
+        return false;
+    }
+    return true;
+}
+
+static void printUsage(FILE *file)
+{
+    fprintf(file,
+            "usage: wormassay-benchmark [options]\n"
+            "\n"
+            "Measures the time each analyzer takes per tracked frame of synthetic plates, writing a CSV row per\n"
+            "analyzer, well count, frame size and thread count: the mean ms per frame, the distribution of the\n"
+            "time taken by each well, the C++ and OpenCV heap allocations per frame, and the speedup and scaling\n"
+            "efficiency relative to the fewest threads measured.\n"
+            "\n"
+            "  -a, --analyzers LIST      of luminance, opticalflow and null (default all)\n"
+            "  -w, --wells LIST          well counts of 1, 6, 12, 24, 48 or 96 (default all)\n"
+            "  -s, --sizes LIST          frame sizes, each 720p, 1080p, 4k or WIDTHxHEIGHT (default 720p,1080p,4k)\n"
+            "  -j, --threads LIST        the numbers of threads each frame is analyzed over, as the plate's share of\n"
+            "                            the cores, by its wells and by frame level stages such as the luminance\n"
+            "                            analyzer's voting (default 1 to the number of cores). On macOS, OpenCV's own\n"
+            "                            parallel loops use every core regardless.\n"
+            "  -n, --frames N            frames measured per row, after %d warm up frames (default 20, at most %d)\n"
+            "  -S, --seed N              the seed of the plates and the analyzers' random sampling (default 1)\n"
+            "  -C, --series              instead, measure the compression ratio and the encoding and decoding rates\n"
+            "                            of stored raw values, for the optical flow analyzer's movement units and\n"
+            "                            for constant and noisy values\n"
+            "  -Q, --quantiles           instead, compare the memory, time and error of the estimated median and\n"
+            "                            percentiles to computing them exactly, for the same values\n"
+            "  -h, --help\n",
+            WarmupFrameCount, SyntheticPlate::FrameCount - WarmupFrameCount);
+}
+
+static bool parseOptions(int argc, char **argv, Options &options)
+{
+    static const struct option longOptions[] = {
+        { "analyzers", required_argument, NULL, 'a' },
+        { "wells", required_argument, NULL, 'w' },
+        { "sizes", required_argument, NULL, 's' },
+        { "threads", required_argument, NULL, 'j' },
+        { "frames", required_argument, NULL, 'n' },
+        { "seed", required_argument, NULL, 'S' },
+        { "series", no_argument, NULL, 'C' },
+        { "quantiles", no_argument, NULL, 'Q' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "a:w:s:j:n:S:CQh", longOptions, NULL)) != -1) {
+        std::vector<std::string> arguments = componentsSeparatedByCommas(optarg ? optarg : "");
+        switch (c) {
+            case 'a':
+                for (size_t i = 0; i < arguments.size(); i++) {
+                    const char *const *end = AnalyzerArguments + sizeof(AnalyzerArguments) / sizeof(*AnalyzerArguments);
+                    const char *const *match = std::find_if(AnalyzerArguments, end, [&](const char *name) { return arguments[i] == name; });
+                    if (match == end) {
+                        fprintf(stderr, "Unknown analyzer '%s'\n", arguments[i].c_str());
+                        return false;
+                    }
+                    options.analyzerTypes.push_back((AnalyzerType)(match - AnalyzerArguments));
+                }
+                break;
+            case 'w':
+                for (size_t i = 0; i < arguments.size(); i++) {
+                    int wellCount = atoi(arguments[i].c_str());
+                    int rows, columns;
+                    if (!getPlateConfigurationForWellCount(wellCount, rows, columns)) {
+                        fprintf(stderr, "Unknown well count '%s'\n", arguments[i].c_str());
+                        return false;
+                    }
+                    options.wellCounts.push_back(wellCount);
+                }
+                break;
+            case 's':
+                for (size_t i = 0; i < arguments.size(); i++) {
+                    CvSize size;
+                    if (!parseSize(arguments[i], size)) {
+                        fprintf(stderr, "Invalid size '%s'\n", arguments[i].c_str());
+                        return false;
+                    }
+                    options.sizes.push_back(size);
+                }
+                break;
+            case 'j':
+                for (size_t i = 0; i < arguments.size(); i++) {
+                    int threadCount = atoi(arguments[i].c_str());
+                    if (threadCount <= 0) {
+                        fprintf(stderr, "Invalid thread count '%s'\n", arguments[i].c_str());
+                        return false;
+                    }
+                    options.threadCounts.push_back((unsigned)threadCount);
+                }
+                break;
+            case 'n':
+                options.frameCount = atoi(optarg);
+                if (options.frameCount <= 0 || options.frameCount > SyntheticPlate::FrameCount - WarmupFrameCount) {
+                    fprintf(stderr, "Invalid frame count '%s'\n", optarg);
+                    return false;
+                }
+                break;
+            case 'S':
+                options.seed = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+            case 'C':
+                options.mode = BenchmarkModeSeries;
+                break;
+            case 'Q':
+                options.mode = BenchmarkModeQuantiles;
+                break;
+            case 'h':
+                printUsage(stdout);
+                exit(0);
+            default:
+                return false;
+        }
+    }
+
+    if (options.analyzerTypes.empty()) {
+        options.analyzerTypes.push_back(AnalyzerTypeConsensusLuminance);
+        options.analyzerTypes.push_back(AnalyzerTypeOpticalFlow);
+        options.analyzerTypes.push_back(AnalyzerTypeNull);
+    }
+    if (options.wellCounts.empty()) {
+        int wellCounts[] = { 1, 6, 12, 24, 48, 96 };
+        options.wellCounts.assign(wellCounts, wellCounts + sizeof(wellCounts) / sizeof(*wellCounts));
+    }
+    if (options.sizes.empty()) {
+        options.sizes.push_back(cvSize(1280, 720));
+        options.sizes.push_back(cvSize(1920, 1080));
+        options.sizes.push_back(cvSize(3840, 2160));
+    }
+    if (options.threadCounts.empty()) {
+        for (unsigned i = 1; i <= std::max(std::thread::hardware_concurrency(), 1U); i++) {
+            options.threadCounts.push_back(i);
+        }
+    }
+    std::sort(options.threadCounts.begin(), options.threadCounts.end());
+    return optind == argc;
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(stderr);
+        return 2;
+    }
+    if (options.mode == BenchmarkModeSeries) {
+        measureSeries(options);
+        return 0;
+    }
+    if (options.mode == BenchmarkModeQuantiles) {
+        measureQuantiles(options);
+        return 0;
+    }
+
+    printf("analyzer,wells,width,height,threads,frames,ms_per_frame,frames_per_second,"
+           "well_ms_mean,well_ms_p50,well_ms_p90,well_ms_p99,well_ms_max,allocations_per_frame,opencv_allocations_per_frame,"
+           "speedup,efficiency\n");
+    for (size_t a = 0; a < options.analyzerTypes.size(); a++) {
+        AnalyzerType analyzerType = options.analyzerTypes[a];
+        for (size_t s = 0; s < options.sizes.size(); s++) {
+            CvSize size = options.sizes[s];
+            for (size_t w = 0; w < options.wellCounts.size(); w++) {
+                int wellCount = options.wellCounts[w];
+                double baseSecondsPerFrame = 0.0;
+                for (size_t t = 0; t < options.threadCounts.size(); t++) {
+                    unsigned threadCount = options.threadCounts[t];
+                    fprintf(stderr, "Measuring %s analyzer on %d wells at %dx%d with %u threads\n",
+                            AnalyzerArguments[analyzerType], wellCount, size.width, size.height, threadCount);
+                    Measurement measurement = measure(options, analyzerType, wellCount, size, threadCount);
+
+                    // Speedup and efficiency are relative to the fewest threads measured, e.g. 1
+                    if (t == 0) {
+                        baseSecondsPerFrame = measurement.secondsPerFrame;
+                    }
+                    double speedup = baseSecondsPerFrame / measurement.secondsPerFrame;
+                    double efficiency = speedup * options.threadCounts[0] / threadCount;
+                    printf("%s,%d,%d,%d,%u,%d,%.4f,%.2f,%.4f,%.4f,%.4f,%.4f,%.4f,%.1f,%.1f,%.3f,%.3f\n",
+                           AnalyzerArguments[analyzerType], wellCount, size.width, size.height, threadCount, options.frameCount,
+                           measurement.secondsPerFrame * 1000.0, 1.0 / measurement.secondsPerFrame,
+                           measurement.wellSecondsMean * 1000.0, measurement.wellSeconds.quantile(0.5) * 1000.0,
+                           measurement.wellSeconds.quantile(0.9) * 1000.0, measurement.wellSeconds.quantile(0.99) * 1000.0,
+                           measurement.wellSecondsMaximum * 1000.0, measurement.allocationsPerFrame,
+                           measurement.openCVAllocationsPerFrame, speedup, efficiency);
+                    fflush(stdout);
+                }
+            }
+        }
+    }
+    return 0;
+}
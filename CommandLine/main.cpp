@@ -0,0 +1,690 @@
+//
+//  main.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+// wormassay-cli: analyzes archived plate videos without the app, e.g. in bulk on Linux compute nodes. Each file is
+// treated as a recording of one or more plates, which are found and tracked as the app does in its batch mode, and
+// the results are written to the same Run Output and Raw CSV files. It also serves as the analyzers' regression test:
+// the per-frame results of a run over fixed inputs (e.g. synthetic plates or frame recordings) with a fixed seed can be
+// saved as golden results, and later runs compared to them, so that optimizations can be shown not to change them.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <float.h>
+#include <getopt.h>
+#include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/imgproc/imgproc_c.h>
+#include "FrameReader.hpp"
+#include "WellFinding.hpp"
+#include "PlateTracker.hpp"
+#include "PlateResults.hpp"
+#include "PlateAnalyzer.hpp"
+#include "ConsensusLuminancePlateAnalyzer.hpp"
+#include "OpticalFlowPlateAnalyzer.hpp"
+#include "DebugOverlay.hpp"
+#include "FrameRecording.hpp"
+#include "GoldenResults.hpp"
+#include "CoreBudget.hpp"
+#include "Tracing.hpp"
+
+#ifndef WORMASSAY_VERSION
+#define WORMASSAY_VERSION "unknown"
+#endif
+
+// As in VideoProcessor.mm, except that the search period is in presentation time
+static const double WellDetectingAverageLumaDeltaEndIdleThreshold = 2.0;
+static const double WellDetectingUnconditionalSearchPeriod = 10.0;
+
+// As in VideoProcessorController.m
+static const char *const SortableLoggingFilenameSafeDateFormat = "%Y-%m-%d %H%M %Z";
+static const char *const RunIDDateFormat = "%Y%m%d%H%M";
+static const char *const AssayDateTimeFormat = "%A, %B %d, %Y at %I:%M:%S %p %Z";
+
+static const size_t MaximumReportedGoldenMismatches = 20;
+
+enum AnalyzerType {
+    AnalyzerTypeConsensusLuminance,
+    AnalyzerTypeOpticalFlow
+};
+
+// The analyzer names match the app's so that the output can be compared
+static const char *const AnalyzerNames[] = {
+    "Consensus Voting Luminance Difference (dArea)",
+    "Lucas\xE2\x80\x94Kanade Optical Flow (Velocity, 1 organism per well)"
+};
+
+struct Options {
+    Options()
+        : analyzerType(AnalyzerTypeConsensusLuminance), flipHorizontally(false), flipVertically(false), noWells(false),
+          columnMajorOrder(false), ignoreFramesPostMovementTimeInterval(DefaultIgnoreFramesPostMovementTimeInterval),
+          outputDirectory("."), jobs(1), rawFormat(FrameReader::RawFormatNone), rawSize(cvSize(0, 0)), rawFrameRate(0.0),
+          randomSeed(1), absoluteTolerance(0.0), relativeTolerance(0.0), printTiming(false), cores(0) {}
+
+    AnalyzerType analyzerType;
+    bool flipHorizontally;          // the plate orientation, applied to the well order
+    bool flipVertically;
+    bool noWells;
+    bool columnMajorOrder;
+    double ignoreFramesPostMovementTimeInterval;
+    std::string outputDirectory;
+    unsigned jobs;
+    FrameReader::RawFormat rawFormat;
+    CvSize rawSize;
+    double rawFrameRate;
+    std::string frameRecordingDirectory;        // empty unless frames are recorded
+    uint32_t randomSeed;                        // for the analyzers' random sampling, so that runs are reproducible
+    std::string goldenOutputPath;               // empty unless golden results are written
+    std::string goldenComparisonPath;           // empty unless results are compared to golden results
+    std::string tracePath;                      // empty unless a performance trace is written
+    double absoluteTolerance;
+    double relativeTolerance;
+    bool printTiming;
+    std::vector<double> movementUnitPercentiles;    // empty unless the median and percentiles are reported
+    unsigned cores;                                 // 0 for every core
+};
+
+// A plate tracked long enough to report
+struct PlateReport {
+    std::string plateID;
+    std::shared_ptr<PlateResults> results;
+};
+
+// Wall clock times spent in each stage of analyzing a file, in seconds
+struct StageTimes {
+    StageTimes() : frameCount(0), trackedFrameCount(0), total(0), reading(0), wellFinding(0), analysis(0) {}
+
+    uint64_t frameCount;
+    uint64_t trackedFrameCount;
+    double total;
+    double reading;             // decoding and conversion to BGRA
+    double wellFinding;         // including the luma conversion to decide whether to search
+    double analysis;            // analyzePlateFrame()
+};
+
+struct FileAnalysis {
+    std::string path;
+    std::vector<PlateReport> plates;
+    bool failed;
+    StageTimes times;
+};
+
+static std::mutex logMutex;
+
+static void runLog(const std::string &path, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static void runLog(const std::string &path, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    std::lock_guard<std::mutex> lock(logMutex);
+    fprintf(stderr, "%s: ", path.c_str());
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+static std::string lastPathComponent(const std::string &path)
+{
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+static std::string plateIDForPath(const std::string &path)
+{
+    // The file name without its extension, as the app displays file sources
+    std::string name = lastPathComponent(path);
+    size_t dot = name.find_last_of('.');
+    return dot == std::string::npos || dot == 0 ? name : name.substr(0, dot);
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string formattedTime(const char *format, time_t time)
+{
+    char buffer[256];
+    struct tm localTime;
+    localtime_r(&time, &localTime);
+    size_t length = strftime(buffer, sizeof(buffer), format, &localTime);
+    return std::string(buffer, length);
+}
+
+static PlateAnalyzer *createAnalyzer(const Options &options)
+{
+    PlateAnalyzer *analyzer = NULL;
+    switch (options.analyzerType) {
+        case AnalyzerTypeConsensusLuminance:
+            analyzer = new ConsensusLuminancePlateAnalyzer(options.ignoreFramesPostMovementTimeInterval);
+            break;
+        case AnalyzerTypeOpticalFlow:
+            analyzer = new OpticalFlowPlateAnalyzer(options.ignoreFramesPostMovementTimeInterval);
+            break;
+    }
+    analyzer->setRandomSeed(options.randomSeed);
+    return analyzer;
+}
+
+// Finishes tracking the current plate, keeping its results if it was tracked long enough (as VideoProcessor does)
+static void endTracking(const std::string &path,
+                        std::unique_ptr<PlateAnalyzer> &analyzer,
+                        std::shared_ptr<PlateResults> &results,
+                        FileAnalysis &analysis)
+{
+    if (!analyzer) {
+        return;
+    }
+    analyzer->didEndTrackingPlate(*results);
+    CoreBudget::sharedBudget().removeClient(&analysis);
+
+    double trackingDuration = results->lastPresentationTime() - results->startPresentationTime();
+    bool longEnough = trackingDuration >= analyzer->minimumTimeIntervalProcessedToReportData() &&
+                        results->sampleCount() > analyzer->minimumSamplesProcessedToReportData();
+    if (longEnough) {
+        runLog(path, "Ended tracking after %.3f seconds", trackingDuration);
+        PlateReport report;
+        report.plateID = plateIDForPath(path);
+        report.results = results;
+        analysis.plates.push_back(report);
+    } else {
+        runLog(path, "Plate removed before enough data was collected (%.3f seconds)", trackingDuration);
+    }
+    analyzer.reset();
+    results.reset();
+}
+
+static void printStageTimes(const std::string &path, const StageTimes &times)
+{
+    double frames = std::max<double>(times.frameCount, 1);
+    runLog(path, "%.3f s for %llu frames (%.1f fps): reading %.2f ms, well finding %.2f ms and analysis %.2f ms per frame "
+           "(%.2f ms per tracked frame)",
+           times.total, (unsigned long long)times.frameCount, times.frameCount / std::max(times.total, 1e-9),
+           times.reading / frames * 1000.0, times.wellFinding / frames * 1000.0, times.analysis / frames * 1000.0,
+           times.analysis / std::max<double>(times.trackedFrameCount, 1) * 1000.0);
+}
+
+static void analyzeFile(const Options &options, FileAnalysis &analysis)
+{
+    const std::string &path = analysis.path;
+    std::string error;
+    FrameReader reader;
+    if (!reader.open(path, options.rawFormat, options.rawSize, options.rawFrameRate, error)) {
+        runLog(path, "%s", error.c_str());
+        analysis.failed = true;
+        return;
+    }
+    runLog(path, "Analyzing %ix%i video at %.3f fps", reader.size().width, reader.size().height, reader.frameRate());
+
+    PlateTracker plateTracker;
+    std::unique_ptr<PlateAnalyzer> analyzer;
+    std::shared_ptr<PlateResults> results;
+    DebugOverlay debugOverlay;          // disabled, since nothing is displayed
+    double lastWellAnalysisBeginTime = -DBL_MAX;
+    double lastWellAnalyzedFrameAverageLuma = 0.0;
+    IplImage *lumaImage = cvCreateImage(reader.size(), IPL_DEPTH_8U, 1);
+
+    // Record the frames as analyzed if requested, e.g. to make bit-exact inputs from compressed videos
+    FrameRecordingWriter recordingWriter;
+    if (!options.frameRecordingDirectory.empty()) {
+        std::string recordingPath = options.frameRecordingDirectory + "/" + plateIDForPath(path) + "." + FrameRecordingPathExtension;
+        if (recordingWriter.open(recordingPath, error)) {
+            runLog(path, "Recording frames to '%s'", recordingPath.c_str());
+        } else {
+            runLog(path, "Unable to record frames to '%s': %s", recordingPath.c_str(), error.c_str());
+            error.clear();
+        }
+    }
+
+    StageTimes &times = analysis.times;
+    std::chrono::steady_clock::time_point fileStartTime = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point stageStartTime = fileStartTime;
+    double presentationTime = 0.0;
+    IplImage *image;
+    uint64_t traceStartTime = TraceRecorder::now();
+    while ((image = reader.readFrame(presentationTime, error))) {
+        times.reading += secondsSince(stageStartTime);
+        TraceRecorder::sharedRecorder().addSpan("read frame", traceStartTime, TraceRecorder::now(), presentationTime, NULL, 0);
+        times.frameCount++;
+        AnalysisFrameRef frame(new AnalysisFrame(image, presentationTime), [](const AnalysisFrame *frame) {
+            IplImage *image = frame->image;
+            cvReleaseImage(&image);
+            delete frame;
+        });
+        recordingWriter.appendFrame(image, 0, presentationTime);
+
+        // Search for wells on every frame unless idle, as in the app's batch mode
+        stageStartTime = std::chrono::steady_clock::now();
+        cvCvtColor(image, lumaImage, CV_BGRA2GRAY);
+        double currentAverageLuma = cvAvg(lumaImage).val[0];
+        if (plateTracker.state() != PlateTracker::NoPlate ||
+            fabs(currentAverageLuma - lastWellAnalyzedFrameAverageLuma) > WellDetectingAverageLumaDeltaEndIdleThreshold ||
+            lastWellAnalysisBeginTime + WellDetectingUnconditionalSearchPeriod < presentationTime) {
+            lastWellAnalysisBeginTime = presentationTime;
+            lastWellAnalyzedFrameAverageLuma = currentAverageLuma;
+            TraceSpan span("find wells", presentationTime);
+
+            // Get wells in row major order. The search is done in place of analyzing frames, so it has the plate's share.
+            std::vector<Circle> wellCircles;
+            bool plateFound;
+            unsigned maximumConcurrency = CoreBudget::sharedBudget().shareForClient(&analysis);
+            if (options.noWells) {
+                plateFound = true;
+            } else if (plateTracker.shouldSearchAllPlateSizes()) {
+                plateFound = findWellCircles(image, wellCircles, maximumConcurrency, plateTracker.wellCountHint());
+            } else {
+                plateFound = findWellCirclesForWellCount(image, plateTracker.wellCountHint(), wellCircles, maximumConcurrency);
+            }
+            if (plateFound && (options.flipHorizontally || options.flipVertically)) {
+                orderWellCirclesForFlippedImage(wellCircles, options.flipHorizontally, options.flipVertically);
+            }
+
+            switch (plateTracker.wellsFound(plateFound, wellCircles, presentationTime)) {
+                case PlateTracker::BeganTracking:
+                    if (wellCircles.size() > 0) {
+                        runLog(path, "Began tracking %zu well plate using %s analyzer at %.3f seconds",
+                               wellCircles.size(), AnalyzerNames[options.analyzerType], presentationTime);
+                    } else {
+                        runLog(path, "Began tracking entire plate using %s analyzer at %.3f seconds",
+                               AnalyzerNames[options.analyzerType], presentationTime);
+                    }
+                    results.reset(new PlateResults((int)wellCircles.size(), presentationTime, false,
+                                                   !options.movementUnitPercentiles.empty()));
+                    if (!options.movementUnitPercentiles.empty()) {
+                        results->setReportedPercentiles(options.movementUnitPercentiles, PlateResults::MovementUnitID);
+                    }
+                    analyzer.reset(createAnalyzer(options));
+                    analyzer->willBeginPlateTracking(*results);
+                    // Files analyzed at once share the cores like the plates of a multi-camera station
+                    CoreBudget::sharedBudget().addClient(&analysis);
+                    break;
+
+                case PlateTracker::PlateLost:
+                    endTracking(path, analyzer, results, analysis);
+                    plateTracker.reset();
+                    break;
+
+                case PlateTracker::NoTransition:
+                    break;
+            }
+        }
+
+        times.wellFinding += secondsSince(stageStartTime);
+
+        if (plateTracker.state() == PlateTracker::TrackingMotion) {
+            stageStartTime = std::chrono::steady_clock::now();
+            TraceSpan span("analyze frame", presentationTime);
+            analyzePlateFrame(*analyzer, frame, plateTracker.trackingWellCircles(), CoreBudget::sharedBudget().shareForClient(&analysis),
+                              debugOverlay, *results);
+            times.analysis += secondsSince(stageStartTime);
+            times.trackedFrameCount++;
+        }
+        stageStartTime = std::chrono::steady_clock::now();
+        traceStartTime = TraceRecorder::now();
+    }
+    if (!error.empty()) {
+        runLog(path, "%s; ending analysis at %.3f seconds", error.c_str(), presentationTime);
+    }
+    endTracking(path, analyzer, results, analysis);
+    cvReleaseImage(&lumaImage);
+    times.total = secondsSince(fileStartTime);
+    if (reader.droppedFrameCount() > 0) {
+        runLog(path, "The frame recording noted %llu dropped frames", (unsigned long long)reader.droppedFrameCount());
+    }
+
+    if (analysis.plates.empty()) {
+        runLog(path, "No plate was tracked long enough to report");
+    }
+    if (options.printTiming) {
+        printStageTimes(path, times);
+    }
+}
+
+static bool appendStringToPath(const std::string &string, const std::string &path)
+{
+    FILE *file = fopen(path.c_str(), "ab");
+    if (!file) {
+        fprintf(stderr, "Unable to open file '%s': %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+    bool success = fwrite(string.data(), 1, string.size(), file) == string.size();
+    success = fclose(file) == 0 && success;
+    if (!success) {
+        fprintf(stderr, "Unable to write to file '%s': %s\n", path.c_str(), strerror(errno));
+    }
+    return success;
+}
+
+static void printUsage(FILE *file)
+{
+    fprintf(file,
+            "usage: wormassay-cli [options] file...\n"
+            "\n"
+            "Analyzes plate videos as the WormAssay app would, writing the Run Output and Raw CSV files.\n"
+            "Files are YUV4MPEG2 (.y4m) or frame recordings saved by the app (.waframes) unless --raw-format is given.\n"
+            "\n"
+            "  -a, --analyzer luminance|opticalflow  the assay analyzer (default luminance)\n"
+            "  -r, --orientation top|top-rotated|bottom|bottom-rotated|no-wells\n"
+            "                                        the plate orientation (default top, i.e. A1 at the top left)\n"
+            "  -c, --column-major                    report wells in column major order\n"
+            "  -i, --ignore-after-movement SECONDS   frames ignored after the plate or lighting moves (default %g)\n"
+            "  -o, --output-directory DIRECTORY      where the CSV files are written (default .)\n"
+            "  -j, --jobs N                          the number of files analyzed at once (default 1, 0 for one per core)\n"
+            "  -n, --cores N                         the number of cores shared among the files (default all)\n"
+            "  -f, --raw-format bgra|uyvy|gray       read headerless raw frames of this format\n"
+            "  -s, --size WIDTHxHEIGHT               the raw frame size\n"
+            "  -F, --fps RATE                        the raw frame rate\n"
+            "  -w, --record-frames DIRECTORY         also save each file's frames as a frame recording (.waframes)\n"
+            "  -S, --seed N                          the seed of the analyzers' random sampling (default 1)\n"
+            "  -P, --percentiles P1,P2,...           also report the median and these percentiles of the movement\n"
+            "                                        units (e.g. 10,25,75,90)\n"
+            "  -T, --timing                          print the wall time spent in each stage\n"
+            "  -p, --trace FILE                      save a performance trace of the run (Chrome trace JSON, which\n"
+            "                                        chrome://tracing and ui.perfetto.dev open)\n"
+            "\n"
+            "Regression testing (implies --timing):\n"
+            "  -g, --write-golden FILE               save every per-frame result of the run as golden results\n"
+            "  -G, --compare-golden FILE             compare every per-frame result to golden results, exiting with\n"
+            "                                        status 1 if any differ\n"
+            "  -t, --tolerance ABSOLUTE              the absolute difference allowed from golden values (default 0)\n"
+            "  -e, --relative-tolerance FRACTION     the difference allowed in proportion to golden values (default 0)\n"
+            "\n"
+            "The file name synthetic:SEED analyzes a generated 6 well 720p plate video rather than a file, and\n"
+            "synthetic:SEED:WELLS:WIDTHxHEIGHT one of another well count and size.\n"
+            "  -h, --help\n",
+            DefaultIgnoreFramesPostMovementTimeInterval);
+}
+
+static bool parseOptions(int argc, char **argv, Options &options, std::vector<std::string> &paths)
+{
+    static const struct option longOptions[] = {
+        { "analyzer", required_argument, NULL, 'a' },
+        { "orientation", required_argument, NULL, 'r' },
+        { "column-major", no_argument, NULL, 'c' },
+        { "ignore-after-movement", required_argument, NULL, 'i' },
+        { "output-directory", required_argument, NULL, 'o' },
+        { "jobs", required_argument, NULL, 'j' },
+        { "cores", required_argument, NULL, 'n' },
+        { "raw-format", required_argument, NULL, 'f' },
+        { "size", required_argument, NULL, 's' },
+        { "fps", required_argument, NULL, 'F' },
+        { "record-frames", required_argument, NULL, 'w' },
+        { "seed", required_argument, NULL, 'S' },
+        { "percentiles", required_argument, NULL, 'P' },
+        { "timing", no_argument, NULL, 'T' },
+        { "trace", required_argument, NULL, 'p' },
+        { "write-golden", required_argument, NULL, 'g' },
+        { "compare-golden", required_argument, NULL, 'G' },
+        { "tolerance", required_argument, NULL, 't' },
+        { "relative-tolerance", required_argument, NULL, 'e' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "a:r:ci:o:j:n:f:s:F:w:S:P:Tp:g:G:t:e:h", longOptions, NULL)) != -1) {
+        std::string argument = optarg ? optarg : "";
+        switch (c) {
+            case 'a':
+                if (argument == "luminance") {
+                    options.analyzerType = AnalyzerTypeConsensusLuminance;
+                } else if (argument == "opticalflow") {
+                    options.analyzerType = AnalyzerTypeOpticalFlow;
+                } else {
+                    fprintf(stderr, "Unknown analyzer '%s'\n", optarg);
+                    return false;
+                }
+                break;
+            case 'r':
+                // As FlipForPlateOrientation() in VideoProcessor.mm
+                options.flipHorizontally = argument == "top-rotated" || argument == "bottom";
+                options.flipVertically = argument == "top-rotated" || argument == "bottom-rotated";
+                options.noWells = argument == "no-wells";
+                if (argument != "top" && argument != "top-rotated" && argument != "bottom" &&
+                    argument != "bottom-rotated" && argument != "no-wells") {
+                    fprintf(stderr, "Unknown orientation '%s'\n", optarg);
+                    return false;
+                }
+                break;
+            case 'c':
+                options.columnMajorOrder = true;
+                break;
+            case 'i':
+                options.ignoreFramesPostMovementTimeInterval = atof(optarg);
+                break;
+            case 'o':
+                options.outputDirectory = argument;
+                break;
+            case 'j':
+                options.jobs = (unsigned)atoi(optarg);
+                if (options.jobs == 0) {
+                    options.jobs = std::max(std::thread::hardware_concurrency(), 1U);
+                }
+                break;
+            case 'n':
+                options.cores = (unsigned)atoi(optarg);
+                if (options.cores == 0) {
+                    fprintf(stderr, "Invalid number of cores '%s'\n", optarg);
+                    return false;
+                }
+                break;
+            case 'f':
+                if (argument == "bgra") {
+                    options.rawFormat = FrameReader::RawFormatBGRA;
+                } else if (argument == "uyvy") {
+                    options.rawFormat = FrameReader::RawFormatUYVY;
+                } else if (argument == "gray") {
+                    options.rawFormat = FrameReader::RawFormatGray;
+                } else {
+                    fprintf(stderr, "Unknown raw format '%s'\n", optarg);
+                    return false;
+                }
+                break;
+            case 's':
+                if (sscanf(optarg, "%dx%d", &options.rawSize.width, &options.rawSize.height) != 2) {
+                    fprintf(stderr, "Invalid size '%s'\n", optarg);
+                    return false;
+                }
+                break;
+            case 'F':
+                options.rawFrameRate = atof(optarg);
+                break;
+            case 'w':
+                options.frameRecordingDirectory = argument;
+                break;
+            case 'S':
+                options.randomSeed = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+            case 'P':
+                options.movementUnitPercentiles.clear();
+                for (const char *percent = optarg; *percent; ) {
+                    char *end;
+                    double value = strtod(percent, &end);
+                    if (end == percent || value < 0.0 || value > 100.0 || (*end && *end != ',')) {
+                        fprintf(stderr, "Invalid percentiles '%s'\n", optarg);
+                        return false;
+                    }
+                    options.movementUnitPercentiles.push_back(value / 100.0);
+                    percent = *end ? end + 1 : end;
+                }
+                break;
+            case 'T':
+                options.printTiming = true;
+                break;
+            case 'p':
+                options.tracePath = argument;
+                break;
+            case 'g':
+                options.goldenOutputPath = argument;
+                options.printTiming = true;
+                break;
+            case 'G':
+                options.goldenComparisonPath = argument;
+                options.printTiming = true;
+                break;
+            case 't':
+                options.absoluteTolerance = atof(optarg);
+                break;
+            case 'e':
+                options.relativeTolerance = atof(optarg);
+                break;
+            case 'h':
+                printUsage(stdout);
+                exit(0);
+            default:
+                return false;
+        }
+    }
+
+    for (int i = optind; i < argc; i++) {
+        paths.push_back(argv[i]);
+    }
+    return paths.size() > 0;
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    std::vector<std::string> paths;
+    if (!parseOptions(argc, argv, options, paths)) {
+        printUsage(stderr);
+        return 2;
+    }
+    if (options.cores > 0) {
+        CoreBudget::setSharedBudgetCores(options.cores);
+    }
+
+    // The run is named for when it began, as in the app
+    time_t runStartTime = time(NULL);
+    std::string outputFilenamePrefix = formattedTime(SortableLoggingFilenameSafeDateFormat, runStartTime);
+    std::string runID = formattedTime(RunIDDateFormat, runStartTime);
+    std::string assayDateTime = formattedTime(AssayDateTimeFormat, runStartTime);
+
+    if (!options.frameRecordingDirectory.empty()) {
+        mkdir(options.frameRecordingDirectory.c_str(), 0755);
+    }
+
+    // Analyze the files, several at once if requested
+    std::vector<FileAnalysis> analyses(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) {
+        analyses[i].path = paths[i];
+        analyses[i].failed = false;
+    }
+    std::chrono::steady_clock::time_point runStartClock = std::chrono::steady_clock::now();
+    std::atomic<size_t> nextFile(0);
+    auto worker = [&]() {
+        for (size_t i = nextFile++; i < analyses.size(); i = nextFile++) {
+            analyzeFile(options, analyses[i]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < std::min<size_t>(options.jobs, analyses.size()); i++) {
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    if (options.printTiming && analyses.size() > 1) {
+        fprintf(stderr, "Analyzed %zu files in %.3f s\n", analyses.size(), secondsSince(runStartClock));
+    }
+
+    // Write the results in the order the files were given, so that scan IDs don't depend on scheduling
+    mkdir(options.outputDirectory.c_str(), 0755);
+    std::string runOutputPath = options.outputDirectory + "/" + outputFilenamePrefix + " Run Output.csv";
+    unsigned long long plateInRunNumber = 1;
+    bool success = true;
+    for (size_t i = 0; i < analyses.size(); i++) {
+        success = success && !analyses[i].failed;
+        for (size_t j = 0; j < analyses[i].plates.size(); j++) {
+            const PlateReport &report = analyses[i].plates[j];
+            std::string scanID = runID + "-" + std::to_string(plateInRunNumber++);
+
+            std::map<std::string, std::string> rawOutput;
+            std::string runOutput = report.results->csvOutput(report.plateID,
+                                                              scanID,
+                                                              assayDateTime,
+                                                              AnalyzerNames[options.analyzerType],
+                                                              WORMASSAY_VERSION,
+                                                              options.columnMajorOrder,
+                                                              rawOutput);
+            success = appendStringToPath(runOutput, runOutputPath) && success;
+
+            // Write out the raw values as CSV
+            for (std::map<std::string, std::string>::iterator it = rawOutput.begin(); it != rawOutput.end(); it++) {
+                std::string rawOutputPath = options.outputDirectory + "/" + outputFilenamePrefix + " Raw " + it->first + " Values.csv";
+                success = appendStringToPath(it->second, rawOutputPath) && success;
+            }
+        }
+    }
+
+    if (plateInRunNumber > 1) {
+        fprintf(stderr, "Wrote results for %llu plates to '%s'\n", plateInRunNumber - 1, runOutputPath.c_str());
+    }
+
+    if (!options.tracePath.empty()) {
+        std::string error;
+        if (TraceRecorder::sharedRecorder().writeChromeTrace(options.tracePath, error)) {
+            fprintf(stderr, "Wrote performance trace to '%s'\n", options.tracePath.c_str());
+        } else {
+            fprintf(stderr, "Unable to write performance trace to '%s': %s\n", options.tracePath.c_str(), error.c_str());
+            success = false;
+        }
+    }
+
+    // Save the per-frame results as, or check them against, golden results
+    if (!options.goldenOutputPath.empty() || !options.goldenComparisonPath.empty()) {
+        GoldenResults goldenResults;
+        for (size_t i = 0; i < analyses.size(); i++) {
+            for (size_t j = 0; j < analyses[i].plates.size(); j++) {
+                goldenResults.addPlate(lastPathComponent(analyses[i].path), (int)j + 1, *analyses[i].plates[j].results);
+            }
+        }
+        std::string error;
+        if (!options.goldenOutputPath.empty()) {
+            if (goldenResults.write(options.goldenOutputPath, error)) {
+                fprintf(stderr, "Wrote %zu golden result series to '%s'\n", goldenResults.seriesCount(), options.goldenOutputPath.c_str());
+            } else {
+                fprintf(stderr, "Unable to write golden results to '%s': %s\n", options.goldenOutputPath.c_str(), error.c_str());
+                success = false;
+            }
+        }
+        if (!options.goldenComparisonPath.empty()) {
+            GoldenResults expectedResults;
+            if (expectedResults.read(options.goldenComparisonPath, error)) {
+                std::string report;
+                size_t mismatchCount = goldenResults.compare(expectedResults, options.absoluteTolerance, options.relativeTolerance,
+                                                             MaximumReportedGoldenMismatches, report);
+                if (mismatchCount == 0) {
+                    fprintf(stderr, "All %zu result series match the golden results in '%s'\n",
+                            expectedResults.seriesCount(), options.goldenComparisonPath.c_str());
+                } else {
+                    fprintf(stderr, "%s%zu results differ from the golden results in '%s'\n",
+                            report.c_str(), mismatchCount, options.goldenComparisonPath.c_str());
+                    success = false;
+                }
+            } else {
+                fprintf(stderr, "Unable to read golden results from '%s': %s\n", options.goldenComparisonPath.c_str(), error.c_str());
+                success = false;
+            }
+        }
+    }
+    return success ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+//
+//  FrameIngestTest.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+// Checks that ingestImageRows() writes exactly the bytes of the separate steps it replaces (see VideoFrame.mm): converting
+// UYVY to BGRA, resizing with cvResize(CV_INTER_AREA) and then flipping with cvFlip(), or for a UYVY frame that isn't
+// resized, mirroring it with flipYpCbCr422Horizontally() and cvFlip(). Every combination of source format, flip,
+// anamorphic width change and height (around the row chunk size) is ingested in random row stripes in a random order.
+// Run by `make check`; exits with status 1 on failure.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <opencv2/imgproc/imgproc_c.h>
+#include "FrameIngest.hpp"
+#include "YpCbCrConversion.hpp"
+
+// Source and destination widths: unchanged, the usual anamorphic ratios of narrower and wider pixels, an integer
+// reduction and an odd ratio
+static const int Widths[][2] = { { 64, 64 }, { 90, 80 }, { 80, 90 }, { 120, 60 }, { 70, 52 } };
+static const int Heights[] = { 1, 15, 16, 17, 53 };
+static const int StripeSplitsPerCase = 4;
+
+static void fillRandomly(IplImage *image, std::mt19937 &generator)
+{
+    for (int row = 0; row < image->height; row++) {
+        uint8_t *bytes = (uint8_t *)image->imageData + row * image->widthStep;
+        for (int i = 0; i < image->width * image->nChannels; i++) {
+            bytes[i] = (uint8_t)generator();
+        }
+    }
+}
+
+static bool imagesMatch(const IplImage *actual, const IplImage *expected)
+{
+    for (int row = 0; row < expected->height; row++) {
+        if (memcmp(actual->imageData + row * actual->widthStep, expected->imageData + row * expected->widthStep,
+                   expected->width * expected->nChannels) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The frame the separate steps produce
+static IplImage *createExpectedImage(const IplImage *src, CvSize destSize, bool flipHorizontally, bool flipVertically)
+{
+    IplImage *expected;
+    if (src->width == destSize.width) {
+        expected = cvCloneImage(src);
+        if (flipHorizontally && src->nChannels == 2) {
+            flipYpCbCr422Horizontally(expected);
+            flipHorizontally = false;
+        }
+    } else {
+        IplImage *converted = (IplImage *)src;
+        if (src->nChannels == 2) {
+            converted = cvCreateImage(cvGetSize(src), IPL_DEPTH_8U, 4);
+            convertYpCbCr422ToBGRA8(src, converted, 0, src->height);
+        }
+        expected = cvCreateImage(destSize, IPL_DEPTH_8U, 4);
+        cvResize(converted, expected, CV_INTER_AREA);
+        if (converted != src) {
+            cvReleaseImage(&converted);
+        }
+    }
+    if (flipHorizontally || flipVertically) {
+        cvFlip(expected, NULL, flipHorizontally && flipVertically ? -1 : (flipHorizontally ? 1 : 0));
+    }
+    return expected;
+}
+
+// Ingests the rows in between 1 and 4 stripes of random heights, in a random order
+static void ingestInStripes(const IplImage *src, IplImage *dest, bool flipHorizontally, bool flipVertically,
+                            std::mt19937 &generator)
+{
+    std::vector<int> boundaries(1, 0);
+    int stripeCount = 1 + (int)(generator() % 4);
+    for (int i = 1; i < stripeCount; i++) {
+        boundaries.push_back((int)(generator() % (src->height + 1)));
+    }
+    boundaries.push_back(src->height);
+    std::sort(boundaries.begin(), boundaries.end());
+
+    std::vector<int> order;
+    for (int i = 0; i < stripeCount; i++) {
+        order.push_back(i);
+    }
+    std::shuffle(order.begin(), order.end(), generator);
+    for (size_t i = 0; i < order.size(); i++) {
+        int firstRow = boundaries[order[i]];
+        ingestImageRows(src, dest, flipHorizontally, flipVertically, firstRow, boundaries[order[i] + 1] - firstRow);
+    }
+}
+
+int main()
+{
+    std::mt19937 generator(1);
+    int caseCount = 0, failureCount = 0;
+    for (int channels = 2; channels <= 4; channels += 2) {
+        for (size_t w = 0; w < sizeof(Widths) / sizeof(*Widths); w++) {
+            for (size_t h = 0; h < sizeof(Heights) / sizeof(*Heights); h++) {
+                CvSize srcSize = cvSize(Widths[w][0], Heights[h]);
+                CvSize destSize = cvSize(Widths[w][1], Heights[h]);
+                IplImage *src = cvCreateImage(srcSize, IPL_DEPTH_8U, channels);
+                fillRandomly(src, generator);
+                int destChannels = srcSize.width == destSize.width ? channels : 4;
+                IplImage *dest = cvCreateImage(destSize, IPL_DEPTH_8U, destChannels);
+
+                for (int flip = 0; flip < 4; flip++) {
+                    bool flipHorizontally = flip & 1, flipVertically = flip & 2;
+                    IplImage *expected = createExpectedImage(src, destSize, flipHorizontally, flipVertically);
+                    for (int split = 0; split < StripeSplitsPerCase; split++) {
+                        cvSet(dest, cvScalarAll(0xA5));
+                        ingestInStripes(src, dest, flipHorizontally, flipVertically, generator);
+                        caseCount++;
+                        if (!imagesMatch(dest, expected)) {
+                            failureCount++;
+                            fprintf(stderr, "Ingesting a %dx%d %s image to %dx%d with %s flip differs from the separate steps\n",
+                                    srcSize.width, srcSize.height, channels == 2 ? "UYVY" : "BGRA", destSize.width,
+                                    destSize.height, flip == 0 ? "no" : (flip == 1 ? "a horizontal" : (flip == 2 ? "a vertical" : "both a horizontal and vertical")));
+                            break;
+                        }
+                    }
+                    cvReleaseImage(&expected);
+                }
+                cvReleaseImage(&src);
+                cvReleaseImage(&dest);
+            }
+        }
+    }
+
+    if (failureCount > 0) {
+        printf("%d of %d ingested frames differ from the separate steps\n", failureCount, caseCount);
+        return 1;
+    }
+    printf("All %d ingested frames match the separate steps\n", caseCount);
+    return 0;
+}
@@ -0,0 +1,176 @@
+//
+//  YpCbCrConversionTest.cpp
+//  WormAssay
+//
+//  Created by Chris Marcellino on 10/19/26.
+//  Copyright 2026 Chris Marcellino. All rights reserved.
+//
+
+// Checks that each vector path of convertYpCbCr422ToBGRA8() that this CPU supports writes exactly the bytes of the scalar
+// reference: for every (Y', Cb, Cr) triple, for row lengths that leave each possible tail of pairs after the vector
+// loop, for row strides with padding, and for partial row ranges, which must leave every other byte untouched. Run by
+// `make check`; exits with status 1 on failure.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "YpCbCrConversion.hpp"
+
+static const char *const PathNames[] = { "scalar", "SSE2", "AVX2", "NEON" };
+
+// Written to the destination beforehand, to detect writes outside the converted rows and pixels
+static const uint8_t SentinelByte = 0xA5;
+
+static bool pathIsSupported(YpCbCrConversionPath path)
+{
+    switch (path) {
+        case YpCbCrConversionPathScalar:
+            return true;
+#if defined(__SSE2__)
+        case YpCbCrConversionPathSSE2:
+            return true;
+        case YpCbCrConversionPathAVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+#if defined(__ARM_NEON)
+        case YpCbCrConversionPathNEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+// An image over its own buffer, with padding bytes at the end of each row
+class PaddedImage {
+public:
+    PaddedImage(CvSize size, int channels, int padding, uint8_t fill)
+        : _buffer((size_t)(size.width * channels + padding) * size.height, fill)
+    {
+        _header = cvCreateImageHeader(size, IPL_DEPTH_8U, channels);
+        _header->widthStep = size.width * channels + padding;
+        _header->imageSize = _header->widthStep * size.height;
+        _header->imageData = _header->imageDataOrigin = (char *)_buffer.data();
+    }
+
+    ~PaddedImage()
+    {
+        cvReleaseImageHeader(&_header);
+    }
+
+    IplImage *image() { return _header; }
+    const std::vector<uint8_t> &bytes() const { return _buffer; }
+    std::vector<uint8_t> &bytes() { return _buffer; }
+
+private:
+    PaddedImage(const PaddedImage &);
+    PaddedImage &operator=(const PaddedImage &);
+
+    std::vector<uint8_t> _buffer;
+    IplImage *_header;
+};
+
+// Converts the rows with the path and the scalar reference into destinations filled with the sentinel, and compares
+// every byte, including the padding and the rows that weren't converted
+static bool convertedBytesMatch(PaddedImage &src, int destPadding, int firstRow, int rowCount, YpCbCrConversionPath path,
+                                const char *description)
+{
+    CvSize size = cvGetSize(src.image());
+    PaddedImage expected(size, 4, destPadding, SentinelByte), actual(size, 4, destPadding, SentinelByte);
+    convertYpCbCr422ToBGRA8(src.image(), expected.image(), firstRow, rowCount, YpCbCrConversionPathScalar);
+    convertYpCbCr422ToBGRA8(src.image(), actual.image(), firstRow, rowCount, path);
+    if (actual.bytes() == expected.bytes()) {
+        return true;
+    }
+    size_t offset = std::mismatch(actual.bytes().begin(), actual.bytes().end(), expected.bytes().begin()).first - actual.bytes().begin();
+    int widthStep = expected.image()->widthStep;
+    fprintf(stderr, "The %s path differs from the scalar path for %s: %dx%d, rows %d to %d, at row %zu byte %zu (%d, not %d)\n",
+            PathNames[path], description, size.width, size.height, firstRow, firstRow + rowCount - 1,
+            offset / widthStep, offset % widthStep, actual.bytes()[offset], expected.bytes()[offset]);
+    return false;
+}
+
+// Every Cb and Cr with every Y' in both luma positions of a pair: an image per Cr, with a row per Cb, whose pair k has
+// luma k then 255 - k
+static bool checkEveryTriple(YpCbCrConversionPath path)
+{
+    PaddedImage src(cvSize(512, 256), 2, 0, 0);
+    for (int cr = 0; cr < 256; cr++) {
+        for (int cb = 0; cb < 256; cb++) {
+            uint8_t *row = src.bytes().data() + cb * src.image()->widthStep;
+            for (int k = 0; k < 256; k++) {
+                row[k * 4] = (uint8_t)cb;
+                row[k * 4 + 1] = (uint8_t)k;
+                row[k * 4 + 2] = (uint8_t)cr;
+                row[k * 4 + 3] = (uint8_t)(255 - k);
+            }
+        }
+        if (!convertedBytesMatch(src, 0, 0, 256, path, "every triple")) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void fillRandomly(PaddedImage &image, std::mt19937 &generator)
+{
+    for (size_t i = 0; i < image.bytes().size(); i++) {
+        image.bytes()[i] = (uint8_t)generator();
+    }
+}
+
+// Each count of pairs from 1 to 40 leaves every tail after the 4 and 8 pair vector loops, with and without padding of
+// the source and destination rows (of any alignment)
+static bool checkRowLengthsAndStrides(YpCbCrConversionPath path, std::mt19937 &generator)
+{
+    static const int Paddings[] = { 0, 2, 6, 36, 64 };
+    for (int pairCount = 1; pairCount <= 40; pairCount++) {
+        for (size_t s = 0; s < sizeof(Paddings) / sizeof(*Paddings); s++) {
+            for (size_t d = 0; d < sizeof(Paddings) / sizeof(*Paddings); d++) {
+                PaddedImage src(cvSize(pairCount * 2, 7), 2, Paddings[s], 0);
+                fillRandomly(src, generator);
+                if (!convertedBytesMatch(src, Paddings[d], 0, 7, path, "random pairs")) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Every range of rows, as the stripes converted in parallel
+static bool checkRowRanges(YpCbCrConversionPath path, std::mt19937 &generator)
+{
+    static const int Height = 12;
+    PaddedImage src(cvSize(46, Height), 2, 10, 0);
+    fillRandomly(src, generator);
+    for (int firstRow = 0; firstRow < Height; firstRow++) {
+        for (int rowCount = 0; firstRow + rowCount <= Height; rowCount++) {
+            if (!convertedBytesMatch(src, 12, firstRow, rowCount, path, "a row range")) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    bool success = true;
+    std::mt19937 generator(1);
+    for (int path = YpCbCrConversionPathSSE2; path <= YpCbCrConversionPathNEON; path++) {
+        if (!pathIsSupported((YpCbCrConversionPath)path)) {
+            printf("Skipped the %s path, which this CPU doesn't support\n", PathNames[path]);
+            continue;
+        }
+        bool pathMatches = checkEveryTriple((YpCbCrConversionPath)path) &&
+                           checkRowLengthsAndStrides((YpCbCrConversionPath)path, generator) &&
+                           checkRowRanges((YpCbCrConversionPath)path, generator);
+        printf("The %s path %s the scalar path\n", PathNames[path], pathMatches ? "matches" : "DIFFERS FROM");
+        success = success && pathMatches;
+    }
+    return success ? 0 : 1;
+}
@@ -69,6 +69,10 @@ CVAPI(void*)  cvAlloc( size_t size );
 CVAPI(void)   cvFree_( void* ptr );
 #define cvFree(ptr) (cvFree_(*(ptr)), *(ptr)=0)
 
+/* WormAssay: returns the number of allocations made by cvAlloc() and cv::fastMalloc() (which allocate all
+   arrays, images and their headers) and the bytes requested, since the process began. Either pointer may be NULL. */
+CVAPI(void)   cvGetAllocationStatistics( uint64* allocationCount, uint64* allocatedBytes );
+
 /* Allocates and initializes IplImage header */
 CVAPI(IplImage*)  cvCreateImageHeader( CvSize size, int depth, int channels );
 
@@ -41,10 +41,15 @@
 //M*/
 
 #include "precomp.hpp"
+#include <atomic>
 
 namespace cv
 {
 
+/* WormAssay: counts of every allocation made by fastMalloc() (and so cvAlloc()), see cvGetAllocationStatistics() */
+static std::atomic<uint64> allocationCount(0);
+static std::atomic<uint64> allocatedBytes(0);
+
 static void* OutOfMemoryError(size_t size)
 {
     CV_Error_(CV_StsNoMem, ("Failed to allocate %lu bytes", (unsigned long)size));
@@ -53,6 +58,8 @@ static void* OutOfMemoryError(size_t size)
 
 void* fastMalloc( size_t size )
 {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
     uchar* udata = (uchar*)malloc(size + sizeof(void*) + CV_MALLOC_ALIGN);
     if(!udata)
         return OutOfMemoryError(size);
@@ -84,5 +91,13 @@ CV_IMPL void cvFree_( void* ptr )
     cv::fastFree( ptr );
 }
 
+CV_IMPL void cvGetAllocationStatistics( uint64* allocationCount, uint64* allocatedBytes )
+{
+    if( allocationCount )
+        *allocationCount = cv::allocationCount.load(std::memory_order_relaxed);
+    if( allocatedBytes )
+        *allocatedBytes = cv::allocatedBytes.load(std::memory_order_relaxed);
+}
+
 
 /* End of file. */